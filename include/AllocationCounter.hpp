@@ -0,0 +1,34 @@
+//------------------------------------------------------------------------------
+//
+// File:        AllocationCounter.hpp
+// Description: Definition of the heap allocation counter (--bench-allocations)
+//
+//------------------------------------------------------------------------------
+#ifndef ALLOCATION_COUNTER_HPP
+#define ALLOCATION_COUNTER_HPP
+
+#include <cstdint>
+
+namespace idl
+{
+    /**
+     * Count of the heap allocations made through operator new, by thread.
+     * The counting replaces the global operator new and is only built with the CMake option
+     * IDL_COUNT_ALLOCATIONS (off by default), so that the other builds keep the standard allocator.
+     * The OpenCV image buffers have their own allocator and are never counted.
+     */
+    namespace allocations
+    {
+        /**
+         * @return if the allocations are counted in this build
+         */
+        bool isCounted();
+
+        /**
+         * @return the number of allocations made by the calling thread, 0 if they are not counted
+         */
+        uint64_t count();
+    }
+}
+
+#endif // ALLOCATION_COUNTER_HPP
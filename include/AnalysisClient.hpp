@@ -0,0 +1,70 @@
+//------------------------------------------------------------------------------
+//
+// File:        AnalysisClient.hpp
+// Description: Definition of AnalysisClient (requests to the AnalysisServer)
+//
+//------------------------------------------------------------------------------
+#ifndef ANALYSIS_CLIENT_HPP
+#define ANALYSIS_CLIENT_HPP
+
+#include <opencv2/opencv.hpp>
+#include <string>
+
+namespace idl
+{
+    /**
+     * Client of the AnalysisServer. 
+     * @see AnalysisServer for the protocol
+     */
+    class AnalysisClient
+    {
+    public:
+        // Disallow copy
+        AnalysisClient(const AnalysisClient&) = delete;
+        AnalysisClient& operator =(const AnalysisClient&) = delete;
+
+        AnalysisClient() = default;
+
+        /**
+         * Disconnect and release the shared memory frame.
+         */
+        ~AnalysisClient();
+
+        /**
+         * Connect to a server.
+         * @param iSocketPath the path of the server socket
+         * @return false if the server cannot be reached
+         */
+        bool connect(const std::string& iSocketPath);
+
+        /**
+         * Ask for the analysis of a png file.
+         * @param iFileName the file, as seen by the server
+         * @param oReply the JSON reply line
+         * @return false if the server cannot be reached
+         */
+        bool analyseFile(const std::string& iFileName, std::string& oReply);
+
+        /**
+         * Ask for the analysis of a decoded frame, handed over in shared memory without encoding.
+         * @param iFrame the BGR frame
+         * @param oReply the JSON reply line
+         * @return false if the frame cannot be shared or the server cannot be reached
+         */
+        bool analyseFrame(const cv::Mat& iFrame, std::string& oReply);
+
+    private:
+        /**
+         * Send a request line and wait for its reply line.
+         */
+        bool request(const std::string& iRequest, std::string& oReply);
+
+        int _fd = -1;               //< connected socket
+        std::string _buffer;        //< received bytes not yet returned
+        std::string _shmName;       //< shared memory object of the frames
+        void* _shmData = nullptr;   //< mapping of the shared memory object
+        size_t _shmSize = 0;        //< size of the shared memory object
+    };
+}
+
+#endif // ANALYSIS_CLIENT_HPP
@@ -0,0 +1,75 @@
+//------------------------------------------------------------------------------
+//
+// File:        AnalysisServer.hpp
+// Description: Definition of AnalysisServer (warm pipeline behind a local socket)
+//
+//------------------------------------------------------------------------------
+#ifndef ANALYSIS_SERVER_HPP
+#define ANALYSIS_SERVER_HPP
+
+#include "ProcessingFactory.hpp"
+#include "ProcessingOptions.hpp"
+#include <csignal>
+#include <string>
+
+namespace idl
+{
+    /**
+     * Serve image analysis requests over a Unix domain socket, keeping the pipeline warm. 
+     * 
+     * Requests and replies are single lines:
+     * - "FILE <path>": analyse a png file
+     * - "SHM <name> <rows> <cols> <step>": analyse a BGR frame held in a POSIX shared memory object
+     * - "PING": check the server is alive, replied by "PONG"
+     * 
+     * The reply to an analysis is the JSON line of ImageProcessing::writeJson(), 
+     * or {"error": message} if the request failed. 
+     * Requests are processed one at a time, in their arrival order.
+     */
+    class AnalysisServer
+    {
+    public:
+        // Disallow copy
+        AnalysisServer(const AnalysisServer&) = delete;
+        AnalysisServer& operator =(const AnalysisServer&) = delete;
+
+        /**
+         * Create the server.
+         * @param iSocketPath the path of the Unix domain socket
+         * @param iOptions the processing settings
+         */
+        AnalysisServer(const std::string& iSocketPath, const ProcessingOptions& iOptions);
+
+        /**
+         * Close the socket and remove its file.
+         */
+        ~AnalysisServer();
+
+        /**
+         * Bind the socket and warm the pipeline up.
+         * @return false if the socket cannot be bound
+         */
+        bool open();
+
+        /**
+         * Serve the requests until stopped.
+         * @param iStop set asynchronously (signal handler) to stop serving
+         * @return the number of requests served
+         */
+        size_t run(const volatile std::sig_atomic_t& iStop);
+
+    private:
+        /**
+         * Process a request.
+         * @param iRequest the request line, without its end of line
+         * @return the reply line, with its end of line
+         */
+        std::string handle(const std::string& iRequest);
+
+        std::string _socketPath;
+        ProcessingFactory _factory;
+        int _fd = -1;   //< listening socket
+    };
+}
+
+#endif // ANALYSIS_SERVER_HPP
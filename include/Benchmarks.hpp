@@ -0,0 +1,74 @@
+//------------------------------------------------------------------------------
+//
+// File:        Benchmarks.hpp
+// Description: Definition of the benchmarks and checks of the command line
+//
+//------------------------------------------------------------------------------
+#ifndef BENCHMARKS_HPP
+#define BENCHMARKS_HPP
+
+#include "PreprocessingPipeline.hpp"
+#include <string>
+
+namespace idl
+{
+    /**
+     * Compare the laser locators on every image of a directory. 
+     * Print for each image the time spent by each backend and the distance between 
+     * the intersections they found, the hough backend being the reference. 
+     * @param imageDirectory the directory containing the png images
+     */
+    void benchmarkLaserLocators(const std::string& imageDirectory);
+
+    /**
+     * Check every kernel variant supported by the CPU against the scalar reference, on random 
+     * pixels around random targets, for lengths exercising the vector tails and thresholds 
+     * covering the saturated range and its bounds. Print the mismatches and the time per frame.
+     * @return the exit code, 1 if a variant differs from the reference
+     */
+    int checkKernels();
+
+    /**
+     * Compare the morphology operators with OpenCV on a Full HD mask, for growing kernel sizes.
+     * Print for each shape, operation and size both times and whether the masks are identical.
+     * @return 0 if every result matches OpenCV, 1 otherwise
+     */
+    int benchmarkMorphology();
+
+    /**
+     * Compare the coarse-to-fine plant detection with the full resolution one on every image of a directory.
+     * Print for each image and reduction factor the detection time, the number of plants, the share of 
+     * full resolution plants retrieved (bounding box overlap above 50%), their mean overlap and species agreement.
+     * @param imageDirectory the directory containing the png images
+     */
+    void benchmarkPyramid(const std::string& imageDirectory);
+
+    /**
+     * Compare a preprocessing chain applied step by step and fused on every image of a directory.
+     * Print for each image the passes of the fused chain, both times and the largest difference
+     * between both results (-1 if their sizes or types differ).
+     * @param imageDirectory the directory containing the png images
+     * @param reference the preprocessing chain
+     */
+    void benchmarkPreprocessing(const std::string& imageDirectory, const PreprocessingPipeline& reference);
+
+    /**
+     * Count the heap allocations of the plant detection on every image of a directory, once 
+     * the buffers kept from one frame to the next are warm.
+     * Print for each image the number of plants and the allocations per frame and per plant.
+     * Requires a build with the CMake option IDL_COUNT_ALLOCATIONS.
+     * @param imageDirectory the directory containing the png images
+     * @return the exit code
+     */
+    int benchmarkAllocations(const std::string& imageDirectory);
+
+    /**
+     * Compare the fast noise correction with the NL-means one on every image of a directory.
+     * Print for each image both times and the PSNR and SSIM of the fast correction against the 
+     * NL-means result, and of the uncorrected image against it as a baseline.
+     * @param imageDirectory the directory containing the png images
+     */
+    void benchmarkDenoise(const std::string& imageDirectory);
+}
+
+#endif // BENCHMARKS_HPP
@@ -0,0 +1,171 @@
+//------------------------------------------------------------------------------
+//
+// File:        BoundedQueue.hpp
+// Description: Definition of BoundedQueue (lock-free queue between pipeline stages)
+//
+//------------------------------------------------------------------------------
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace idl
+{
+    /**
+     * Bounded multi-producer multi-consumer lock-free queue.
+     * Each cell carries a sequence number telling whether it is free for the producer
+     * of a given position or filled for its consumer, so that producers and consumers
+     * only contend on their own position counter (Vyukov's bounded queue).
+     * A full or empty queue is reported to the caller, which decides how to wait.
+     */
+    template <typename T>
+    class BoundedQueue
+    {
+    public:
+        // Disallow copy
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator =(const BoundedQueue&) = delete;
+
+        /**
+         * Create a queue.
+         * @param iCapacity the number of elements the queue holds, rounded up to a power of two
+         */
+        explicit BoundedQueue(size_t iCapacity)
+        {
+            size_t capacity = 2;
+            while (capacity < iCapacity)
+            {
+                capacity *= 2;
+            }
+            _mask = capacity - 1;
+            _cells.reset(new Cell[capacity]);
+            for (size_t i = 0; i < capacity; ++i)
+            {
+                _cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * Append an element if the queue is not full.
+         * @param iValue the element, moved from on success only
+         * @return false if the queue is full
+         */
+        bool tryPush(T& iValue)
+        {
+            size_t pos = _pushPos.load(std::memory_order_relaxed);
+            Cell* cell;
+            while (true)
+            {
+                cell = &_cells[pos & _mask];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+                if (0 == diff)
+                {
+                    // Free cell: claim the position
+                    if (_pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    // The cell still holds the element of the previous lap
+                    return false;
+                }
+                else
+                {
+                    pos = _pushPos.load(std::memory_order_relaxed);
+                }
+            }
+
+            cell->value = std::move(iValue);
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * Remove the oldest element if the queue is not empty.
+         * @param oValue the element
+         * @return false if the queue is empty
+         */
+        bool tryPop(T& oValue)
+        {
+            size_t pos = _popPos.load(std::memory_order_relaxed);
+            Cell* cell;
+            while (true)
+            {
+                cell = &_cells[pos & _mask];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+                if (0 == diff)
+                {
+                    // Filled cell: claim the position
+                    if (_popPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    // The cell has not been filled yet
+                    return false;
+                }
+                else
+                {
+                    pos = _popPos.load(std::memory_order_relaxed);
+                }
+            }
+
+            oValue = std::move(cell->value);
+            // Free the cell for the producer of the next lap
+            cell->sequence.store(pos + _mask + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @return the number of elements in the queue, approximate while it is used
+         */
+        size_t size() const
+        {
+            size_t pushPos = _pushPos.load(std::memory_order_relaxed);
+            size_t popPos  = _popPos.load(std::memory_order_relaxed);
+            return pushPos > popPos ? pushPos - popPos : 0;
+        }
+
+        /**
+         * @return the number of elements the queue holds
+         */
+        size_t capacity() const { return _mask + 1; }
+
+        /**
+         * Tell the consumers that no element will be pushed anymore.
+         * Every element pushed before is still delivered.
+         */
+        void close() { _isClosed.store(true, std::memory_order_release); }
+
+        /**
+         * @return if no element will be pushed anymore
+         */
+        bool isClosed() const { return _isClosed.load(std::memory_order_acquire); }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+
+        std::unique_ptr<Cell[]> _cells;
+        size_t _mask;
+
+        // Producers and consumers positions on their own cache line
+        alignas(64) std::atomic<size_t> _pushPos {0};
+        alignas(64) std::atomic<size_t> _popPos {0};
+        alignas(64) std::atomic<bool> _isClosed {false};
+    };
+}
+
+#endif // BOUNDED_QUEUE_HPP
@@ -0,0 +1,67 @@
+//------------------------------------------------------------------------------
+//
+// File:        DirectoryWatcher.hpp
+// Description: Definition of DirectoryWatcher (new files of a spool directory)
+//
+//------------------------------------------------------------------------------
+#ifndef DIRECTORY_WATCHER_HPP
+#define DIRECTORY_WATCHER_HPP
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace idl
+{
+    /**
+     * Watch a directory for newly completed files, using inotify. 
+     * A file is reported once its writer has closed it, or once it has been 
+     * renamed into the directory, so partially written files are never returned.
+     */
+    class DirectoryWatcher
+    {
+    public:
+        /**
+         * A completed file.
+         */
+        struct File
+        {
+            std::string path;                                   //< path of the file
+            std::chrono::system_clock::time_point completed;    //< last modification of the file
+        };
+
+        // Disallow copy
+        DirectoryWatcher(const DirectoryWatcher&) = delete;
+        DirectoryWatcher& operator =(const DirectoryWatcher&) = delete;
+
+        DirectoryWatcher() = default;
+
+        /**
+         * Stop watching.
+         */
+        ~DirectoryWatcher();
+
+        /**
+         * Start watching a directory. 
+         * @param iDirectory the directory to watch
+         * @param iExtension the extension of the files to report
+         * @return false if the directory cannot be watched
+         */
+        bool open(const std::string& iDirectory, const std::string& iExtension = ".png");
+
+        /**
+         * Wait for newly completed files. 
+         * @param oFiles the completed files, appended in their completion order
+         * @param iTimeoutMs the maximal waiting time, 0 to only collect the pending events
+         * @return false if the watch failed
+         */
+        bool wait(std::vector<File>& oFiles, int iTimeoutMs);
+
+    private:
+        int _fd = -1;           //< inotify instance
+        std::string _directory;
+        std::string _extension;
+    };
+}
+
+#endif // DIRECTORY_WATCHER_HPP
@@ -0,0 +1,127 @@
+//------------------------------------------------------------------------------
+//
+// File:        FrameArchive.hpp
+// Description: Definition of FrameArchive (memory-mapped raw frame recordings)
+//
+//------------------------------------------------------------------------------
+#ifndef FRAME_ARCHIVE_HPP
+#define FRAME_ARCHIVE_HPP
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <string>
+
+namespace idl
+{
+    /**
+     * Recording of raw BGR frames in a single file, read through a memory mapping. 
+     * 
+     * The file holds a header, an index of the frames then the frames pixels:
+     * - header: magic "IDLFRAME", version, number of frames, reduction factor of the frames
+     * - index: for each frame its name, size, row step and offset in the file
+     * - frames: the uncompressed pixels, each frame aligned on 64 bytes
+     * 
+     * The frames are handed out as cv::Mat views of the mapping, without any decoding nor copy. 
+     */
+    class FrameArchive
+    {
+    public:
+        static constexpr const char* extension = ".idlf";   //< extension of the archive files
+
+        // Disallow copy
+        FrameArchive(const FrameArchive&) = delete;
+        FrameArchive& operator =(const FrameArchive&) = delete;
+
+        FrameArchive() = default;
+
+        /**
+         * Unmap the archive, the frames views are no longer valid. 
+         */
+        ~FrameArchive();
+
+        /**
+         * Convert a directory of png images into an archive. 
+         * @param iImgDirectory the directory containing the png images
+         * @param iArchivePath the archive file to create
+         * @param iReduction the reduction factor the images are decoded with (1, 2, 4 or 8)
+         * @return the number of frames written, -1 on error
+         */
+        static int convert(const std::string& iImgDirectory, const std::string& iArchivePath, int iReduction = 1);
+
+        /**
+         * @param iPath a file path
+         * @return if the path names an archive file
+         */
+        static bool isArchive(const std::string& iPath);
+
+        /**
+         * Map an archive file in memory. 
+         * @param iArchivePath the archive file
+         * @return false if the file cannot be mapped or is not a valid archive
+         */
+        bool open(const std::string& iArchivePath);
+
+        /**
+         * Unmap the archive. 
+         */
+        void close();
+
+        /**
+         * @return the number of frames of the archive
+         */
+        size_t size() const { return _nbFrames; }
+
+        /**
+         * @return the reduction factor the frames have been decoded with
+         */
+        int getReduction() const { return _reduction; }
+
+        /**
+         * Get a frame of the archive, as a view of the mapping. 
+         * The mapping is private: writing into a frame never modifies the file. 
+         * @param iIndex the index of the frame
+         * @return the frame, valid as long as the archive stays open
+         */
+        cv::Mat getFrame(size_t iIndex) const;
+
+        /**
+         * @param iIndex the index of the frame
+         * @return the name of the image the frame comes from
+         */
+        std::string getName(size_t iIndex) const;
+
+    private:
+        /**
+         * Index entry of a frame.
+         */
+        struct FrameEntry
+        {
+            char name[64];      //< name of the source image, null terminated
+            uint32_t rows;
+            uint32_t cols;
+            uint32_t type;      //< OpenCV type of the pixels
+            uint32_t step;      //< bytes per row
+            uint64_t offset;    //< offset of the pixels in the file
+        };
+
+        /**
+         * Header of the file.
+         */
+        struct Header
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t nbFrames;
+            uint32_t reduction;
+            uint32_t reserved;
+        };
+
+        void* _data = nullptr;      //< start of the mapping
+        size_t _length = 0;         //< length of the mapping
+        size_t _nbFrames = 0;
+        int _reduction = 1;
+        const FrameEntry* _index = nullptr;
+    };
+}
+
+#endif // FRAME_ARCHIVE_HPP
@@ -0,0 +1,126 @@
+//------------------------------------------------------------------------------
+//
+// File:        FrameRing.hpp
+// Description: Definition of FrameRing (shared memory ring of raw frames)
+//
+//------------------------------------------------------------------------------
+#ifndef FRAME_RING_HPP
+#define FRAME_RING_HPP
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace idl
+{
+    /**
+     * Ring buffer of raw BGR frames in a POSIX shared memory object, between a single 
+     * producer (the capture process) and a single consumer (the analyser). 
+     * 
+     * The producer and the consumer each own one index of the ring, published with 
+     * release/acquire atomics: no lock nor system call is needed to exchange a frame. 
+     * The producer never waits: a frame pushed while the ring is full is dropped and counted. 
+     * The consumer processes the frames in place, as views of the shared memory.
+     */
+    class FrameRing
+    {
+    public:
+        /**
+         * A frame of the ring, valid until it is released.
+         */
+        struct Frame
+        {
+            cv::Mat image;          //< view of the frame pixels in the ring
+            std::string name;       //< name given by the producer
+            uint64_t sequence;      //< index of the frame in the producer stream
+            int64_t timestamp;      //< capture time, in ns since the system clock epoch
+        };
+
+        // Disallow copy
+        FrameRing(const FrameRing&) = delete;
+        FrameRing& operator =(const FrameRing&) = delete;
+
+        FrameRing() = default;
+
+        /**
+         * Unmap the ring, and remove it if created by this instance.
+         */
+        ~FrameRing();
+
+        /**
+         * Create the ring, as the producer. An existing ring is only replaced when its producer has ended.
+         * @param iName the name of the shared memory object, starting with '/'
+         * @param iNbSlots the number of frames the ring holds
+         * @param iMaxSize the largest frame size
+         * @return false if the shared memory object cannot be created or already exists
+         */
+        bool create(const std::string& iName, uint32_t iNbSlots, const cv::Size& iMaxSize);
+
+        /**
+         * Open an existing ring, as the consumer. 
+         * @param iName the name of the shared memory object
+         * @return false if the ring does not exist (yet) or is invalid
+         */
+        bool open(const std::string& iName);
+
+        /**
+         * Copy a frame into the ring and publish it. 
+         * @param iFrame the BGR frame
+         * @param iName the name of the frame
+         * @return false if the frame has been dropped (ring full or frame too large)
+         */
+        bool push(const cv::Mat& iFrame, const std::string& iName);
+
+        /**
+         * Signal the consumer that no more frames will be pushed.
+         */
+        void close();
+
+        /**
+         * Get the oldest frame not processed yet, without copy. 
+         * @param oFrame the frame, valid until release()
+         * @return false if the ring is empty
+         */
+        bool peek(Frame& oFrame) const;
+
+        /**
+         * Give the oldest frame slot back to the producer.
+         */
+        void release();
+
+        /**
+         * @return if the producer has finished and every frame has been consumed
+         */
+        bool isFinished() const;
+
+        /**
+         * @return the number of frames dropped by the producer
+         */
+        uint64_t getNbDropped() const;
+
+    private:
+        struct Header;
+        struct Slot;
+
+        /**
+         * @param iIndex the index of a frame
+         * @return the slot holding the frame
+         */
+        Slot* slot(uint64_t iIndex) const;
+
+        /**
+         * @param iName the name of an existing shared memory object
+         * @return if it is a ring whose producer process does not exist anymore
+         */
+        static bool isStale(const std::string& iName);
+
+        std::string _name;
+        bool _isOwner = false;      //< created by this instance, removed on destruction
+        void* _data = nullptr;      //< start of the mapping
+        size_t _length = 0;         //< length of the mapping
+        Header* _header = nullptr;
+    };
+}
+
+#endif // FRAME_RING_HPP
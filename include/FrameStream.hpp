@@ -0,0 +1,129 @@
+//------------------------------------------------------------------------------
+//
+// File:        FrameStream.hpp
+// Description: Definition of FrameStream (video file or camera input)
+//
+//------------------------------------------------------------------------------
+#ifndef FRAME_STREAM_HPP
+#define FRAME_STREAM_HPP
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace idl
+{
+    /**
+     * Policy applied when the processing is slower than the stream.
+     */
+    enum class DropPolicy
+    {
+        latestWins, // the frames are captured continuously, only the latest one is processed
+        everyNth    // only one frame out of N is processed, the others are skipped without decoding
+    };
+
+    /**
+     * Frames of a video file or a camera (V4L2 device), read with cv::VideoCapture. 
+     * Video files are paced at their frame rate, as a camera would deliver them, 
+     * so that the stream never waits for the processing: late frames are dropped by policy.
+     */
+    class FrameStream
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // Disallow copy
+        FrameStream(const FrameStream&) = delete;
+        FrameStream& operator =(const FrameStream&) = delete;
+
+        /**
+         * Create a stream.
+         * @param iPolicy the policy applied when the processing falls behind
+         * @param iEveryN the number of frames per processed frame, for the everyNth policy
+         */
+        FrameStream(DropPolicy iPolicy = DropPolicy::latestWins, int iEveryN = 2);
+
+        /**
+         * Stop the capture.
+         */
+        ~FrameStream();
+
+        /**
+         * Open a video source.
+         * @param iSource a video file, a V4L2 device (/dev/videoN) or a camera index
+         * @param iFps the frame rate of a video file, 0 to use the one of the file
+         * @return false if the source cannot be opened
+         */
+        bool open(const std::string& iSource, double iFps = 0.0);
+
+        /**
+         * Wait for the next frame to process.
+         * @param oFrame the frame
+         * @param oCaptured the capture time of the frame
+         * @param oIndex the index of the frame in the stream
+         * @return false at the end of the stream
+         */
+        bool next(cv::Mat& oFrame, Clock::time_point& oCaptured, uint64_t& oIndex);
+
+        /**
+         * @return the frame rate of the stream
+         */
+        double getFps() const { return _fps; }
+
+        /**
+         * @return the number of frames delivered by the source
+         */
+        uint64_t getNbCaptured() const;
+
+        /**
+         * @return the number of frames dropped or skipped
+         */
+        uint64_t getNbDropped() const;
+
+    private:
+        /**
+         * Wait for the delivery time of the next frame of a video file. The frames whose 
+         * delivery time has already passed are dropped, as they would be by a camera.
+         * @return false at the end of the stream
+         */
+        bool waitFrame();
+
+        /**
+         * Read a frame, paced at the frame rate for a video file.
+         */
+        bool read(cv::Mat& oFrame);
+
+        /**
+         * Capture loop of the latestWins policy, run by its own thread.
+         */
+        void capture();
+
+        DropPolicy _policy;
+        int _everyN;
+        cv::VideoCapture _capture;
+        bool _isFile = false;
+        double _fps = 0.0;
+        Clock::duration _period {};     //< time between two frames
+        Clock::time_point _nextFrame;   //< delivery time of the next frame of a video file
+
+        // Latest frame, shared with the capture thread
+        mutable std::mutex _mutex;
+        std::condition_variable _condition;
+        std::thread _thread;
+        cv::Mat _latest;
+        Clock::time_point _latestCaptured;
+        uint64_t _latestIndex = 0;
+        bool _hasLatest = false;
+        bool _isFinished = false;
+        bool _isStopped = false;
+
+        uint64_t _nbCaptured = 0;
+        uint64_t _nbDropped = 0;
+    };
+}
+
+#endif // FRAME_STREAM_HPP
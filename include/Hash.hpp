@@ -0,0 +1,86 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace idl
+{
+    /**
+     * Non-cryptographic 64 bits hashing, to detect changed images and settings. 
+     * The data is consumed 8 bytes at a time (FNV-1a on words then a final avalanche).
+     */
+    namespace hash
+    {
+        constexpr uint64_t seed  = 0xcbf29ce484222325ULL;  // FNV offset basis
+        constexpr uint64_t prime = 0x100000001b3ULL;       // FNV prime
+
+        /**
+         * Mix a 64 bits value into a hash.
+         * @param iHash the current hash
+         * @param iValue the value to mix
+         * @return the updated hash
+         */
+        inline uint64_t combine(uint64_t iHash, uint64_t iValue)
+        {
+            iHash = (iHash ^ iValue) * prime;
+            return iHash ^ (iHash >> 29);
+        }
+
+        /**
+         * Hash a memory block.
+         * @param iData the block
+         * @param iSize the size of the block, in bytes
+         * @param iHash the hash to continue
+         * @return the updated hash
+         */
+        inline uint64_t bytes(const void* iData, size_t iSize, uint64_t iHash = seed)
+        {
+            const unsigned char* data = static_cast<const unsigned char*>(iData);
+            size_t i = 0;
+            for (; i + 8 <= iSize; i += 8)
+            {
+                uint64_t word;
+                std::memcpy(&word, data + i, 8);
+                iHash = combine(iHash, word);
+            }
+
+            uint64_t tail = 0;
+            std::memcpy(&tail, data + i, iSize - i);
+            return combine(iHash, tail ^ (static_cast<uint64_t>(iSize) << 56));
+        }
+
+        /**
+         * Hash an arithmetic value, by value so that the struct padding never matters.
+         * @param iValue the value
+         * @param iHash the hash to continue
+         * @return the updated hash
+         */
+        template<typename T>
+        inline uint64_t value(T iValue, uint64_t iHash = seed)
+        {
+            static_assert(std::is_arithmetic<T>::value, "hash::value only hashes arithmetic types");
+            return bytes(&iValue, sizeof(T), iHash);
+        }
+
+        /**
+         * Hash the pixels of an image, row by row so that views are supported.
+         * @param iImage the image
+         * @return the hash of the image size, type and pixels
+         */
+        inline uint64_t image(const cv::Mat& iImage)
+        {
+            uint64_t oHash = value(iImage.rows, value(iImage.cols, value(iImage.type())));
+            size_t rowSize = iImage.cols * iImage.elemSize();
+            for (int y = 0; y < iImage.rows; y++)
+            {
+                oHash = bytes(iImage.ptr(y), rowSize, oHash);
+            }
+            return oHash;
+        }
+    }
+}
+
+#endif // HASH_HPP
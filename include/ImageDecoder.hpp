@@ -0,0 +1,80 @@
+//------------------------------------------------------------------------------
+//
+// File:        ImageDecoder.hpp
+// Description: Definition of ImageDecoder (image decoding ahead of the processing)
+//
+//------------------------------------------------------------------------------
+#ifndef IMAGE_DECODER_HPP
+#define IMAGE_DECODER_HPP
+
+#include <opencv2/opencv.hpp>
+#include <deque>
+#include <future>
+#include <string>
+#include <vector>
+
+namespace idl
+{
+    /**
+     * Decode a list of image files in order. 
+     * The images can be decoded at a reduced resolution, and ahead of their processing 
+     * by worker threads so that reading and decompressing overlap with the computation. 
+     */
+    class ImageDecoder
+    {
+    public:
+        // Disallow copy
+        ImageDecoder(const ImageDecoder&) = delete;
+        ImageDecoder& operator =(const ImageDecoder&) = delete;
+
+        /**
+         * Create an image decoder.
+         * @param iFileNames the image files, decoded in this order
+         * @param iReduction the reduction factor of the decoded images (1, 2, 4 or 8)
+         * @param iNbThreads the number of images decoded ahead in parallel, 0 to decode on request
+         */
+        ImageDecoder(std::vector<cv::String> iFileNames, int iReduction = 1, int iNbThreads = 0);
+
+        /**
+         * Wait for the images still being decoded.
+         */
+        ~ImageDecoder();
+
+        /**
+         * Get the next image of the list. 
+         * @param oImage the decoded image, empty if the file could not be decoded
+         * @param oFileName the file of the image
+         * @return false when every image has been returned
+         */
+        bool next(cv::Mat& oImage, cv::String& oFileName);
+
+        /**
+         * @return the reduction factor of the decoded images
+         */
+        int getReduction() const { return _reduction; }
+
+        /**
+         * Get the imread flags decoding a color image reduced by a factor. 
+         * PNG files are decoded at full resolution then resized by OpenCV, 
+         * JPEG files are directly decoded at the reduced resolution. 
+         * @param iReduction the reduction factor (1, 2, 4 or 8)
+         * @return the flags, IMREAD_COLOR for an unsupported factor
+         */
+        static int readFlags(int iReduction);
+    private:
+        /**
+         * Start decoding the next images until the worker threads are busy.
+         */
+        void prefetch();
+
+        std::vector<cv::String> _fileNames;
+        int _reduction;
+        int _flags;
+        int _nbThreads;
+        size_t _nextRequested = 0;  //< next image to start decoding
+        size_t _nextReturned  = 0;  //< next image to return
+        std::deque<std::future<cv::Mat>> _pending;  //< images being decoded, in order
+    };
+}
+
+#endif // IMAGE_DECODER_HPP
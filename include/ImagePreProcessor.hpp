@@ -21,10 +21,14 @@ namespace idl
         Thresholding,
         HistogramEqualization,
         NoiseCorrection,
-        Grayscale
+        Grayscale,
+        FastNoiseCorrection
     };
 
     class ImagePreProcessor {
+        // Runs the steps one by one as the reference of its fused passes
+        friend class PreprocessingPipeline;
+
     private:
         /**
          * Apply Gaussian blur to an image
@@ -67,6 +71,19 @@ namespace idl
          */
         static cv::Mat applyNoiseCorrection(const cv::Mat& img, float h = 30.0f);
 
+        /**
+         * Apply an edge-preserving noise correction in linear time (fast guided filter),
+         * each channel being its own guide. The filter coefficients are computed on the image
+         * reduced by subsample then enlarged, so the cost does not depend on the radius.
+         * @param img the 8-bit input image
+         * @param radius the radius of the filter window, in pixels of the full image
+         * @param eps the regularization, in squared normalized intensity: the variance under
+         * which a window is smoothed and above which its edges are kept
+         * @param subsample the reduction factor of the coefficients
+         * @return the image after
+         */
+        static cv::Mat applyFastNoiseCorrection(const cv::Mat& img, int radius = 8, double eps = 0.01, int subsample = 4);
+
         /**
          * Convert an image to grayscale
          * @param img the input image
@@ -85,6 +102,7 @@ namespace idl
 
         /**
          * Apply a predefined series of preprocessing steps to an image
+         * (grayscale, median blur and equalization, fused with buffers reused by each thread)
          * @param img the input image to process
          * @return the image after
          */
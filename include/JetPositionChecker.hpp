@@ -49,10 +49,11 @@ namespace idl
          * 
          * @param iPlant the plant to test with the laser
          * @param iJet the laser location point
+         * @param iReduction the reduction factor the image has been decoded with, scales the tolerance
          * 
          * @return the laser behavior relatively of the provided plant.
          */
-        static LaserBehavior isOnPlant(const Plant& iPlant, const cv::Point& iJet); 
+        static LaserBehavior isOnPlant(const Plant& iPlant, const cv::Point& iJet, int iReduction = 1); 
     private:
         const LineDetector& _lineDetector;
         const std::vector<Plant>& _plants;
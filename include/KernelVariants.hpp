@@ -0,0 +1,59 @@
+//------------------------------------------------------------------------------
+//
+// File:        KernelVariants.hpp
+// Description: Declaration of the kernel variants of each instruction set
+//
+//------------------------------------------------------------------------------
+#ifndef KERNEL_VARIANTS_HPP
+#define KERNEL_VARIANTS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace idl
+{
+    namespace kernels
+    {
+        /**
+         * Byte shuffles gathering one channel of 16 interleaved 3 channels pixels (48 bytes, 
+         * 3 registers of 16 bytes): shuffle[c][r] moves the bytes of channel c held by 
+         * register r to the position of their pixel, the other bytes being cleared (-128).
+         */
+        struct DeinterleaveTable
+        {
+            int8_t shuffle[3][3][16];
+        };
+
+        constexpr DeinterleaveTable makeDeinterleaveTable()
+        {
+            DeinterleaveTable oTable {};
+            for (int c = 0; c < 3; ++c)
+            {
+                for (int r = 0; r < 3; ++r)
+                {
+                    for (int i = 0; i < 16; ++i)
+                    {
+                        int source = 3 * i + c - 16 * r;
+                        oTable.shuffle[c][r][i] = (source >= 0 && source < 16) ? static_cast<int8_t>(source) : -128;
+                    }
+                }
+            }
+            return oTable;
+        }
+
+        constexpr DeinterleaveTable deinterleaveTable = makeDeinterleaveTable();
+
+        // Variants, each one built with the flags of its instruction set. 
+        // The vector variants fall back to the scalar one for thresholds outside [1, 255].
+        void colorDistanceMaskScalar(const uint8_t* iPixels, uint8_t* oMask, size_t iCount, 
+                                     const uint8_t iTarget[3], int iThreshold);
+        void colorDistanceMaskSse4(const uint8_t* iPixels, uint8_t* oMask, size_t iCount, 
+                                   const uint8_t iTarget[3], int iThreshold);
+        void colorDistanceMaskAvx2(const uint8_t* iPixels, uint8_t* oMask, size_t iCount, 
+                                   const uint8_t iTarget[3], int iThreshold);
+        void colorDistanceMaskAvx512(const uint8_t* iPixels, uint8_t* oMask, size_t iCount, 
+                                     const uint8_t iTarget[3], int iThreshold);
+    }
+}
+
+#endif // KERNEL_VARIANTS_HPP
@@ -0,0 +1,98 @@
+//------------------------------------------------------------------------------
+//
+// File:        Kernels.hpp
+// Description: Definition of the pixel kernels (runtime instruction set dispatch)
+//
+//------------------------------------------------------------------------------
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace idl
+{
+    /**
+     * Hand-written loops over the pixels, each one built for several instruction sets. 
+     * The best variant supported by the CPU is selected on first use, unless the 
+     * IDL_KERNEL_ISA environment variable or setIsa() forces one. 
+     * The scalar variant is the reference every other variant must match exactly.
+     */
+    namespace kernels
+    {
+        /**
+         * Instruction sets a kernel is built for.
+         */
+        enum class Isa
+        {
+            scalar, // portable C++
+            sse4,   // SSE4.1
+            avx2,   // AVX2
+            avx512  // AVX-512 F and BW
+        };
+
+        /**
+         * Threshold the L1 distance of 3 channels pixels to a target color.
+         * @param iPixels the interleaved 3 channels pixels
+         * @param oMask 255 where the distance is below the threshold, 0 elsewhere, one byte per pixel
+         * @param iCount the number of pixels
+         * @param iTarget the target color
+         * @param iThreshold the exclusive distance threshold
+         */
+        using ColorDistanceMaskFn = void (*)(const uint8_t* iPixels, uint8_t* oMask, size_t iCount, 
+                                             const uint8_t iTarget[3], int iThreshold);
+
+        /**
+         * @param iIsa an instruction set
+         * @return the name of the instruction set, as accepted by parseIsa()
+         */
+        const char* isaName(Isa iIsa);
+
+        /**
+         * @param iName the name of an instruction set (scalar, sse4, avx2, avx512)
+         * @param oIsa the instruction set
+         * @return false if the name is unknown
+         */
+        bool parseIsa(const std::string& iName, Isa& oIsa);
+
+        /**
+         * @param iIsa an instruction set
+         * @return if the kernels are built for the instruction set and the CPU supports it
+         */
+        bool isSupported(Isa iIsa);
+
+        /**
+         * @return the best instruction set supported by the CPU
+         */
+        Isa detectIsa();
+
+        /**
+         * Force the instruction set of the kernels.
+         * @param iIsa the instruction set
+         * @return false if it is not supported, the selection is then unchanged
+         */
+        bool setIsa(Isa iIsa);
+
+        /**
+         * @return the instruction set of the kernels
+         */
+        Isa getIsa();
+
+        /**
+         * @param iIsa an instruction set
+         * @return the variant of the kernel for the instruction set, nullptr if it is not built
+         */
+        ColorDistanceMaskFn colorDistanceMaskVariant(Isa iIsa);
+
+        /**
+         * Threshold the L1 distance of 3 channels pixels to a target color, 
+         * with the selected instruction set. 
+         * @see ColorDistanceMaskFn
+         */
+        void colorDistanceMask(const uint8_t* iPixels, uint8_t* oMask, size_t iCount, 
+                               const uint8_t iTarget[3], int iThreshold);
+    }
+}
+
+#endif // KERNELS_HPP
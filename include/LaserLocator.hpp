@@ -0,0 +1,16 @@
+#ifndef LASER_LOCATOR_HPP
+#define LASER_LOCATOR_HPP
+
+namespace idl
+{
+    /**
+     * Backend used by the LineDetector to locate the laser lines.
+     */
+    enum class LaserLocator
+    {
+        hough,      // Canny edges + probabilistic hough transform
+        projection  // robust line fitting directly on the laser color mask
+    };
+}
+
+#endif // LASER_LOCATOR_HPP
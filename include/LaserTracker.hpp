@@ -0,0 +1,76 @@
+//------------------------------------------------------------------------------
+//
+// File:        LaserTracker.hpp
+// Description: Definition of LaserTracker (laser tracking across frames)
+//
+//------------------------------------------------------------------------------
+#ifndef LASER_TRACKER_HPP
+#define LASER_TRACKER_HPP
+
+#include "LineDetector.hpp"
+#include <opencv2/opencv.hpp>
+
+namespace idl
+{
+    /**
+     * Track the laser intersection across consecutive frames. 
+     * The next intersection is predicted from the previous ones (constant velocity) 
+     * so that the line detection only runs in a window around the prediction. 
+     * The tracker falls back to a whole frame search when the track is lost.
+     */
+    class LaserTracker
+    {
+    public:
+        /**
+         * Create a laser tracker.
+         * @param iWindowSize the side of the square search window, in px
+         * @param iMinConfidence the intersection confidence required to keep tracking
+         */
+        LaserTracker(int iWindowSize = 512, float iMinConfidence = 0.5f);
+
+        /**
+         * Get the area where to look for the laser in the next frame. 
+         * @param iFrameSize the size of the next frame
+         * @return the window around the predicted intersection, empty to search the whole frame
+         */
+        cv::Rect getSearchArea(const cv::Size& iFrameSize) const;
+
+        /**
+         * Check if a detection can be trusted to follow the laser. 
+         * @param iDetector the line detector run on the current frame
+         * @return if an intersection has been found with enough confidence
+         */
+        bool isReliable(const LineDetector& iDetector) const;
+
+        /**
+         * Update the track with the detection of the current frame. 
+         * An unreliable detection loses the track.
+         * @param iDetector the line detector run on the current frame
+         */
+        void update(const LineDetector& iDetector);
+
+        /**
+         * @return the predicted intersection for the next frame, (-1, -1) if not tracking
+         */
+        cv::Point predict() const;
+
+        /**
+         * @return if the laser is currently tracked
+         */
+        bool isTracking() const { return _nbTracked > 0; }
+
+        /**
+         * Lose the track, the next frame will be searched entirely.
+         */
+        void reset();
+
+    private:
+        int _windowSize;        //< side of the search window, in px
+        float _minConfidence;   //< confidence required to keep tracking
+        cv::Point _last {-1, -1};   //< last tracked intersection
+        cv::Point _velocity {0, 0}; //< intersection motion between the two last frames
+        int _nbTracked = 0;         //< number of consecutive tracked frames
+    };
+}
+
+#endif // LASER_TRACKER_HPP
@@ -10,8 +10,10 @@
 #ifndef LINE_DETECTOR_HPP
 #define LINE_DETECTOR_HPP
 
+#include <cstdint>
 #include <vector>
 #include <opencv2/opencv.hpp>
+#include "LaserLocator.hpp"
 
 namespace idl // Images Development Library 
 {
@@ -24,6 +26,17 @@ namespace idl // Images Development Library
     class LineDetector 
     {
     public:
+        /**
+         * Results of the detection, as cached across runs.
+         */
+        struct Results
+        {
+            std::vector<cv::Vec4i> lines;           //< detected segments
+            std::vector<cv::Point> intersections;   //< intersections between line families
+            cv::Point intersection;                 //< retained intersection, (-1, -1) if none
+            float confidence;                       //< confidence in the retained intersection
+        };
+
         // Disallow copy
         LineDetector(const LineDetector&) = delete;
         LineDetector& operator =(const LineDetector&) = delete;
@@ -37,32 +50,77 @@ namespace idl // Images Development Library
         /**
          * Create a line detector from an image to analyze. 
          * @param iImgSrc the image to detect lines from. 
+         * @param iLocator the backend used to locate the laser lines
+         * @param iSearchArea the area where to look for the laser, the whole image if empty. 
+         *                    Results are still expressed in the image coordinates.
+         * @param iReduction the reduction factor the image has been decoded with (1, 2, 4 or 8), 
+         *                   the pixel constants of the detection are scaled accordingly
          */
-        LineDetector(const cv::Mat& iImgSrc);
+        LineDetector(const cv::Mat& iImgSrc, LaserLocator iLocator = LaserLocator::hough,
+            const cv::Rect& iSearchArea = cv::Rect(), int iReduction = 1);
     
         /** 
-         * Get detected lines using hough transformation.
+         * Get detected lines using the selected laser locator.
          * @return a list of vec4i (x0, y0, x1, y1) 
          */
         std::vector<cv::Vec4i> getCurLines() const;  
 
         /**
-         * Computes intersection between lines.
+         * @return the backend used to locate the laser lines
+         */
+        LaserLocator getLocator() const { return _locator; }
+
+        /**
+         * @return the area where the laser is looked for, empty for the whole image
+         */
+        const cv::Rect& getSearchArea() const { return _searchArea; }
+
+        /**
+         * @return the reduction factor the image has been decoded with
+         */
+        int getReduction() const { return _reduction; }
+
+        /**
+         * Computes intersection between lines. 
+         * Lines are first clustered into line families (segments lying on the same line), 
+         * then one intersection is computed between every pair of non-parallel families.
          * @return a list of points representing the detected intersections
          */
         std::vector<cv::Point> getIntersections() const;   
 
         /**
-         * Get the intersection by computing the mean points between every detect intersections
+         * Get the intersection as the weighted median of every detected intersections. 
+         * Each intersection is weighted by the length of the crossing families and their angle.
          * @see LineDetector::getIntersections()
+         * @return the intersection, or (-1, -1) if none has been found
          */
         cv::Point getIntersection() const;
 
+        /**
+         * Get the confidence in the retrieved intersection: the share of the intersections 
+         * weight agreeing with it, times the share of the detected lines length supporting it.
+         * @return the confidence in [0, 1], 0 if no intersection has been found
+         */
+        float getIntersectionConfidence() const;
+
         /**
          * @return if the line detector has retrieved an intersection. 
          */
         bool hasIntersection() const;
 
+        /**
+         * @return the results of the detection, computed if not done yet
+         */
+        Results getResults() const;
+
+        /**
+         * Hash the settings the detection results depend on. 
+         * @param iLocator the backend used to locate the laser lines
+         * @param iReduction the reduction factor the image has been decoded with
+         * @return the hash of the laser color, the backend and the detector version
+         */
+        static uint64_t parametersHash(LaserLocator iLocator, int iReduction);
+
         /**
          * Draw detected laser and the intersection.
          */
@@ -77,28 +135,72 @@ namespace idl // Images Development Library
         // Internal functions
 
         /**
-         * Transform a vectorial line description (x1,y1,x2,y2) to a linear equation under the form
-         * of ax+by+c with returned result a vec3 (a, b, c)
-         * 
-         * @param iLine the line to convert to its linear equation
-         * @return the constant expression of the linear equation (a, b, c) 
+         * A set of detected segments lying on the same line. 
+         */
+        struct LineFamily
+        {
+            cv::Point2f point;      //< length-weighted center of the segments
+            cv::Point2f direction;  //< unit direction of the line
+            float weight;           //< cumulated length of the segments
+        };
+
+        /**
+         * Cluster segments into line families according to their direction and offset. 
+         * Directions are compared with a cosine threshold, no trigonometric call is made.
+         * @param iLines the segments to cluster
+         * @param iReduction the reduction factor of the image
+         * @return the line families, each one being the representative of its segments
+         */
+        static std::vector<LineFamily> clusterLines(const std::vector<cv::Vec4i>& iLines, int iReduction);
+
+        /**
+         * Detect the lines then solve and cache the intersections, only once.
          */
-        static cv::Vec3f toLinearEquation(const cv::Vec4i& iLine);
+        void computeIntersections() const;
+
         /**
-         * Compute the angle between two lines.
-         * @param iLine1 the first line to compare
-         * @param iLine2 the second line to compare
-         * @return the angle between the provided lines, in radian. 
+         * Use results computed beforehand instead of running the detection.
+         * @param iResults the results of a detection on the same image with the same settings
          */
-        static float computeAngle(const cv::Vec4i& iLine1, const cv::Vec4i& iLine2);
+        void setResults(const Results& iResults);
+
         /**
          * Filter the color using the LA method to improve line detection. 
          * Replace the simple color to gray convertion to use in a Canny edge transform.
          */
         static cv::Mat filterLinesColor(const cv::Mat& iImg);
 
+        /**
+         * Locate the laser lines using Canny edges and a probabilistic hough transform.
+         * @param iMask the laser color mask
+         * @param iReduction the reduction factor of the image
+         * @return a list of vec4i (x0, y0, x1, y1)
+         */
+        static std::vector<cv::Vec4i> houghLines(const cv::Mat& iMask, int iReduction);
+
+        /**
+         * Locate the laser lines by fitting them directly onto the laser color mask. 
+         * Rows without laser pixels are skipped using the row projection profile, the 
+         * remaining pixels are sampled and each line is found by RANSAC then refined 
+         * with a robust least-squares fit. No edge detection nor hough accumulator is used.
+         * @param iMask the laser color mask
+         * @param iReduction the reduction factor of the image
+         * @return a list of vec4i (x0, y0, x1, y1), one per fitted line
+         */
+        static std::vector<cv::Vec4i> projectionLines(const cv::Mat& iMask, int iReduction);
+
         // Attributes
-        const cv::Mat& _img; //< reference image to analyze
+        const cv::Mat& _img;    //< reference image to analyze
+        LaserLocator _locator;  //< backend used to locate the laser lines
+        cv::Rect _searchArea;   //< area to analyze, the whole image if empty
+        int _reduction;         //< reduction factor the image has been decoded with
+
+        // Results, computed on first request
+        mutable bool _isComputed = false;
+        mutable std::vector<cv::Vec4i> _lines;          //< detected segments
+        mutable std::vector<cv::Point> _intersections;  //< intersections between line families
+        mutable cv::Point _intersection {-1, -1};       //< retained intersection
+        mutable float _confidence = 0.0f;               //< confidence in the retained intersection
 
         // Factory
         friend class idl::ProcessingFactory;
@@ -0,0 +1,64 @@
+//------------------------------------------------------------------------------
+//
+// File:        MaskIntegral.hpp
+// Description: Definition of MaskIntegral (box statistics of a mask in constant time)
+//
+//------------------------------------------------------------------------------
+#ifndef MASK_INTEGRAL_HPP
+#define MASK_INTEGRAL_HPP
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+
+namespace idl
+{
+    /**
+     * Summed-area table of the non-zero pixels of a mask. Once built, the number of
+     * non-zero pixels in any box is read from the 4 corners of the box, whatever its size.
+     */
+    class MaskIntegral
+    {
+    public:
+        MaskIntegral() = default;
+
+        /**
+         * Build the table of a mask.
+         * @param iMask an 8-bit single channel mask
+         */
+        explicit MaskIntegral(const cv::Mat& iMask) { build(iMask); }
+
+        /**
+         * Build the table of a mask, reusing the memory of the previous one.
+         * @param iMask an 8-bit single channel mask
+         */
+        void build(const cv::Mat& iMask);
+
+        /**
+         * @param iBox a box, clipped to the mask
+         * @return the number of non-zero pixels in the box, as cv::countNonZero
+         */
+        int count(const cv::Rect& iBox) const;
+
+        /**
+         * @param iBox a box, clipped to the mask
+         * @return the share of non-zero pixels in the box, 0 if it is outside the mask
+         */
+        double density(const cv::Rect& iBox) const;
+
+        /**
+         * @param iBox a box, clipped to the mask
+         * @return if the box holds a non-zero pixel
+         */
+        bool any(const cv::Rect& iBox) const { return count(iBox) > 0; }
+
+        /**
+         * @return the size of the mask
+         */
+        cv::Size size() const { return cv::Size(std::max(0, _sums.cols - 1), std::max(0, _sums.rows - 1)); }
+
+    private:
+        cv::Mat _sums;  //< non-zero pixels above and left of each pixel, one row and column larger than the mask
+    };
+}
+
+#endif // MASK_INTEGRAL_HPP
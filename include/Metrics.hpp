@@ -0,0 +1,124 @@
+//------------------------------------------------------------------------------
+//
+// File:        Metrics.hpp
+// Description: Definition of Metrics (live counters of the processing)
+//
+//------------------------------------------------------------------------------
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include "Species.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace idl
+{
+    /**
+     * Live counters of a long-running analysis: frames processed and dropped, latency of each
+     * stage, queue depths, plants per frame by species and laser detection rate, exported in
+     * the Prometheus text format (@see MetricsExporter).
+     * Each thread records into its own counters, only written by that thread, so recording is
+     * a few relaxed stores without lock nor shared cache line; the export sums the threads.
+     * The counts of an ended thread are added to a shared total, its counters going to the next thread.
+     * Disabled by default, recording then costs a test.
+     */
+    class Metrics
+    {
+    public:
+        /**
+         * Stages with a latency histogram.
+         */
+        enum class Stage
+        {
+            decode,     //< decoding of an image, the wait for it when decoded ahead
+            detect,     //< plant detection
+            laser,      //< laser detection
+            write,      //< result row and overlays written
+            frame,      //< end to end, from the capture of a frame to its results being written
+            nbStages
+        };
+
+        /**
+         * Queues with a depth gauge.
+         */
+        enum class Queue
+        {
+            decoded,    //< pipeline, decoded frames waiting for the detection
+            detected,   //< pipeline, processed frames waiting for the rendering
+            rendered,   //< pipeline, rendered frames waiting for the writing
+            pending,    //< watched directory, completed files waiting for the processing
+            nbQueues
+        };
+
+        /**
+         * Measure the enclosing block as the latency of a stage.
+         */
+        class StageTimer
+        {
+        public:
+            /**
+             * @param iStage the stage
+             */
+            explicit StageTimer(Stage iStage);
+            ~StageTimer();
+
+            StageTimer(const StageTimer&) = delete;
+            StageTimer& operator =(const StageTimer&) = delete;
+
+        private:
+            Stage _stage;
+            int64_t _startNs = -1;   //< negative when the metrics are disabled
+        };
+
+        /**
+         * Enable the recording, for every thread.
+         */
+        static void enable();
+
+        /**
+         * @return if the metrics are recorded
+         */
+        static bool isEnabled();
+
+        /**
+         * Count a processed frame and its plants.
+         * @param iNbPlants the number of plants of each species, indexed by Species
+         */
+        static void addFrame(const int iNbPlants[3]);
+
+        /**
+         * Count the frames dropped before their processing.
+         * @param iNbFrames the number of dropped frames
+         */
+        static void addDropped(uint64_t iNbFrames = 1);
+
+        /**
+         * Count a laser detection.
+         * @param iFound if the laser intersection has been found
+         */
+        static void addLaser(bool iFound);
+
+        /**
+         * Record the latency of a stage.
+         * @param iStage the stage
+         * @param iMs the latency in ms
+         */
+        static void observeLatency(Stage iStage, double iMs);
+
+        /**
+         * Set the number of frames waiting in a queue.
+         * @param iQueue the queue
+         * @param iDepth the number of frames
+         */
+        static void setQueueDepth(Queue iQueue, size_t iDepth);
+
+        /**
+         * Format the metrics, summed over the threads, with the resident memory of the process.
+         * @param oText the metrics in the Prometheus text exposition format
+         */
+        static void format(std::string& oText);
+    };
+}
+
+#endif // METRICS_HPP
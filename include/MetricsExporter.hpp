@@ -0,0 +1,77 @@
+//------------------------------------------------------------------------------
+//
+// File:        MetricsExporter.hpp
+// Description: Definition of MetricsExporter (metrics served over HTTP or written to a file)
+//
+//------------------------------------------------------------------------------
+#ifndef METRICS_EXPORTER_HPP
+#define METRICS_EXPORTER_HPP
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+namespace idl
+{
+    /**
+     * Export the Metrics in the Prometheus text format, from a background thread: served over
+     * HTTP on the loopback interface (GET /metrics), and/or written to a file at a regular
+     * interval, replaced atomically (node exporter textfile collector).
+     * Exporting enables the recording of the metrics.
+     */
+    class MetricsExporter
+    {
+    public:
+        // Disallow copy
+        MetricsExporter(const MetricsExporter&) = delete;
+        MetricsExporter& operator =(const MetricsExporter&) = delete;
+
+        MetricsExporter() = default;
+
+        /**
+         * Stop the exports.
+         */
+        ~MetricsExporter();
+
+        /**
+         * Serve the metrics over HTTP on 127.0.0.1.
+         * @param iPort the TCP port
+         * @return false if the port cannot be bound
+         */
+        bool listen(int iPort);
+
+        /**
+         * Write the metrics to a file at a regular interval, and once more when stopped.
+         * @param iPath the file
+         * @param iPeriodS the interval between two writes in s
+         * @return false if the file cannot be written
+         */
+        bool writeFile(const std::string& iPath, double iPeriodS);
+
+        /**
+         * Stop the exports and wait for their threads.
+         */
+        void stop();
+
+    private:
+        /**
+         * Answer the HTTP requests until stopped.
+         */
+        void serve();
+
+        /**
+         * Write the metrics to the file.
+         * @return false if the file cannot be written
+         */
+        bool write() const;
+
+        std::atomic<bool> _isStopped {false};
+        int _fd = -1;               //< listening socket
+        std::thread _server;
+        std::string _path;
+        double _periodS = 10.0;
+        std::thread _writer;
+    };
+}
+
+#endif // METRICS_EXPORTER_HPP
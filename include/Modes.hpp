@@ -0,0 +1,128 @@
+//------------------------------------------------------------------------------
+//
+// File:        Modes.hpp
+// Description: Definition of the run modes of the command line
+//
+//------------------------------------------------------------------------------
+#ifndef MODES_HPP
+#define MODES_HPP
+
+#include "FrameStream.hpp"
+#include "ProcessingOptions.hpp"
+#include "ProcessingPipeline.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace idl
+{
+    /**
+     * Process the images of a directory, writing each result row as soon as its image is processed, 
+     * then save and display the overlays of every image (Esc to stop).
+     * @param imageDirectory the directory containing the png images, or a frame archive
+     * @param options the processing settings
+     * @return the exit code
+     */
+    int processDirectory(const std::string& imageDirectory, const ProcessingOptions& options);
+
+    /**
+     * Process the images as they land in a spool directory, until interrupted. 
+     * The result rows and overlays are written as soon as each image is processed. When the 
+     * processing falls behind, the oldest pending images are dropped so that the latency stays 
+     * bounded. The end-to-end latency of each image, from the completion of its file to its 
+     * results being written, is reported.
+     * @param imageDirectory the spool directory
+     * @param options the processing settings
+     * @param maxPending the number of images waiting to be processed above which the oldest are dropped
+     * @return the exit code
+     */
+    int watchDirectory(const std::string& imageDirectory, const ProcessingOptions& options, size_t maxPending);
+
+    /**
+     * Replay the images of a directory into a shared memory frame ring, at a given rate. 
+     * @param imageDirectory the directory containing the png images
+     * @param ringName the name of the ring to create
+     * @param nbSlots the number of frames the ring holds
+     * @param fps the number of frames pushed per second
+     * @return the exit code
+     */
+    int produceFrames(const std::string& imageDirectory, const std::string& ringName, uint32_t nbSlots, double fps);
+
+    /**
+     * Process the frames of a shared memory frame ring as they are pushed, until the producer 
+     * finishes or the process is interrupted. The frames are processed in place, without copy. 
+     * The result rows and overlays are written as the frames are processed and the end-to-end 
+     * latency, from the capture of each frame to its results being written, is reported.
+     * @param ringName the name of the ring
+     * @param options the processing settings
+     * @return the exit code
+     */
+    int consumeFrames(const std::string& ringName, const ProcessingOptions& options);
+
+    /**
+     * Process the images of a directory with the staged pipeline, then print the time spent 
+     * and the activity of each stage: the bottleneck is the stage that is never starved, 
+     * the stages before it being blocked on its queue.
+     * @param imageDirectory the directory containing the png images, or a frame archive
+     * @param options the processing settings
+     * @param settings the threads of each stage
+     * @return the exit code
+     */
+    int runPipeline(const std::string& imageDirectory, const ProcessingOptions& options, 
+                    const ProcessingPipeline::Settings& settings);
+
+    /**
+     * Process a video file or a camera as a live stream, until its end or an interruption. 
+     * Frames are dropped following the policy when the processing falls behind the source. 
+     * Only the result rows are written, so that the throughput is the one of the analysis. 
+     * The achieved frame rate, the drop rate and the latency percentiles, from the capture 
+     * of each frame to its results being written, are reported.
+     * @param source the video file, the camera index or the video device
+     * @param options the processing settings
+     * @param policy the frame dropping policy
+     * @param everyN the frames kept with the everyNth policy
+     * @param deadlineMs the latency budget of a frame in ms, the frame period if not positive
+     * @param fps the frame rate of the source, the one of the video if not positive
+     * @return the exit code
+     */
+    int streamVideo(const std::string& source, const ProcessingOptions& options, 
+                    DropPolicy policy, int everyN, double deadlineMs, double fps);
+
+    /**
+     * Decode the images of a directory once and write them to a frame archive.
+     * @param imageDirectory the directory containing the png images
+     * @param archivePath the archive to write
+     * @param reduction the reduction factor of the stored frames (1, 2, 4 or 8)
+     * @return the exit code
+     */
+    int convertFrames(const std::string& imageDirectory, const std::string& archivePath, int reduction);
+
+    /**
+     * Serve analysis requests on a Unix domain socket until interrupted.
+     * @param socketPath the path of the socket
+     * @param options the processing settings
+     * @return the exit code
+     */
+    int serve(const std::string& socketPath, const ProcessingOptions& options);
+
+    /**
+     * Send the analysis of an image file to a running server and print its reply.
+     * @param socketPath the path of the server socket
+     * @param requestFile the image file
+     * @return the exit code
+     */
+    int requestAnalysis(const std::string& socketPath, const std::string& requestFile);
+
+    /**
+     * Measure the latency of the requests to a running server. Every image of a directory is 
+     * sent several times, as a file then as a shared memory frame, and the latency percentiles 
+     * of both kinds of requests are printed. 
+     * @param socketPath the path of the server socket
+     * @param imageDirectory the directory containing the png images
+     * @param nbRounds the number of times each image is sent
+     * @return the exit code
+     */
+    int benchmarkServer(const std::string& socketPath, const std::string& imageDirectory, int nbRounds);
+}
+
+#endif // MODES_HPP
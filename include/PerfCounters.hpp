@@ -0,0 +1,152 @@
+//------------------------------------------------------------------------------
+//
+// File:        PerfCounters.hpp
+// Description: Definition of PerfCounters (hardware counters of the pipeline stages)
+//
+//------------------------------------------------------------------------------
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace idl
+{
+    /**
+     * Hardware performance counters (cycles, instructions, cache and branch misses, page faults)
+     * of the named stages of the processing, read with Linux perf_event_open.
+     * A stage is measured by a Scope around its code: the counters of the calling thread are read
+     * when the scope opens and closes, and the difference is added to the totals of the stage and
+     * to the row of the current frame of the thread. Nested stages are counted in their parent too.
+     * The work handed to other threads (OpenCV parallel loops) is not counted.
+     * Disabled by default, a Scope then costs a test. Events the system does not expose
+     * (virtual machines, perf_event_paranoid) are reported as unavailable.
+     */
+    class PerfCounters
+    {
+    public:
+        enum Event
+        {
+            cycles,
+            instructions,
+            cacheMisses,
+            branchMisses,
+            pageFaults,
+            nbEvents
+        };
+
+        using Values = std::array<double, nbEvents>;
+
+        /**
+         * Totals of a stage over a run.
+         */
+        struct StageTotals
+        {
+            std::string name;
+            uint64_t nbCalls = 0;
+            double elapsedMs = 0.0;
+            Values values = {};         //< counts, scaled when the events have been multiplexed
+        };
+
+        /**
+         * Counts of a stage on one frame.
+         */
+        struct FrameRow
+        {
+            std::string frame;          //< name of the frame, empty outside of a frame
+            std::string stage;
+            double elapsedMs = 0.0;
+            Values values = {};
+        };
+
+        /**
+         * Measure the enclosing block as a stage, on the calling thread.
+         */
+        class Scope
+        {
+        public:
+            /**
+             * @param iStage the name of the stage, a string literal
+             */
+            explicit Scope(const char* iStage);
+            ~Scope();
+
+            Scope(const Scope&) = delete;
+            Scope& operator =(const Scope&) = delete;
+
+        private:
+            const char* _stage = nullptr;   //< nullptr when the counters are disabled
+            int64_t _startNs = 0;
+            Values _start = {};
+        };
+
+        /**
+         * Attribute the stages measured by the calling thread in the enclosing block to a frame.
+         */
+        class FrameScope
+        {
+        public:
+            /**
+             * @param iFrame the name of the frame
+             */
+            explicit FrameScope(const std::string& iFrame);
+            ~FrameScope();
+
+            FrameScope(const FrameScope&) = delete;
+            FrameScope& operator =(const FrameScope&) = delete;
+
+        private:
+            bool _enabled = false;
+            std::string _previous;
+        };
+
+        /**
+         * Enable the counters, for every thread.
+         * @return false if perf_event_open is not supported, the counters stay disabled
+         */
+        static bool enable();
+
+        /**
+         * @return if the counters are enabled
+         */
+        static bool isEnabled();
+
+        /**
+         * @param iEvent an event
+         * @return if the event has been counted by at least one thread
+         */
+        static bool isAvailable(Event iEvent);
+
+        /**
+         * @return the totals of each stage, in the order of their first measure
+         */
+        static std::vector<StageTotals> getTotals();
+
+        /**
+         * Print the totals of each stage with the derived ratios: instructions per cycle,
+         * cache misses per thousand instructions and branch misses per thousand instructions.
+         * @param oStream the output stream
+         */
+        static void printReport(std::ostream& oStream);
+
+        /**
+         * Write the counts of each stage on each frame as CSV: the rows measured so far, then each row 
+         * as its stage completes, so that a long run does not keep them in memory. 
+         * Until then, the rows are kept up to a limit, the next ones being dropped.
+         * @param iPath the CSV file
+         * @return false if the file cannot be written
+         */
+        static bool openFrames(const std::string& iPath);
+
+        /**
+         * Flush and close the CSV of the frames.
+         * @return false if it was not open or a row could not be written
+         */
+        static bool closeFrames();
+    };
+}
+
+#endif // PERF_COUNTERS_HPP
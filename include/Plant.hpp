@@ -14,8 +14,8 @@ namespace idl
         cv::Mat plantImg;       // Image de la plante
         cv::Mat mask;           // Masque de la plante
         Species plantSpecies;   // Espèce de la plante (wheat, advantis, etc.)
-        float area;
-        float score;
+        float area = 0.0f;      // Surface de la plante, en pixels de l'image comme le centre et la boîte
+        float score = 0.0f;     // Score blé de la plante, moyenne de ses contours pondérée par leur surface
     };
 }
 
@@ -2,8 +2,10 @@
 #define PLANT_DETECTOR_HPP
 
 #include <opencv2/opencv.hpp>
+#include <cstdint>
 #include <vector>
 #include "Plant.hpp"
+#include "PlantTracker.hpp"
 
 namespace idl 
 {
@@ -11,6 +13,36 @@ namespace idl
     {
     public:
         static std::vector<Plant> detectPlants(const cv::Mat& img, bool enableSliders = false);
+
+        /**
+         * Detect the plants of the next image of a sequence, reusing the classification
+         * of the plants already seen in the previous image.
+         * @param img the input image
+         * @param tracker the plant tracker of the sequence, updated with the detected plants
+         * @param downscale the reduction factor for the coarse-to-fine detection (1, 2 or 4), 1 for full resolution
+         * @param reduction the reduction factor the image has been decoded with (1, 2, 4 or 8)
+         */
+        static std::vector<Plant> detectPlants(const cv::Mat& img, PlantTracker& tracker, int downscale = 1, int reduction = 1);
+
+        /**
+         * Detect the plants of an area of the image only. The plants are scored
+         * according to the whole image and returned in the image coordinates.
+         * @param img the input image
+         * @param area the area of the image to analyze
+         * @param downscale the reduction factor for the coarse-to-fine detection (1, 2 or 4), 1 for full resolution.
+         *                  Segmentation and grouping run at the reduced scale, the plant masks are refined at full resolution.
+         * @param reduction the reduction factor the image has been decoded with (1, 2, 4 or 8), 
+         *                  the pixel constants of the detection are scaled accordingly
+         */
+        static std::vector<Plant> detectPlants(const cv::Mat& img, const cv::Rect& area, int downscale = 1, int reduction = 1);
+
+        /**
+         * Hash the settings the detected plants depend on.
+         * @param downscale the reduction factor for the coarse-to-fine detection
+         * @param reduction the reduction factor the image has been decoded with
+         * @return the hash of the filter settings, the scoring threshold and the detector version
+         */
+        static uint64_t parametersHash(int downscale, int reduction);
     };
 }
 
@@ -0,0 +1,79 @@
+//------------------------------------------------------------------------------
+//
+// File:        PlantTracker.hpp
+// Description: Definition of PlantTracker (plant classification across frames)
+//
+//------------------------------------------------------------------------------
+#ifndef PLANT_TRACKER_HPP
+#define PLANT_TRACKER_HPP
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "Species.hpp"
+
+namespace idl
+{
+    /**
+     * Associate the plants of consecutive frames to reuse their classification. 
+     * A plant blob matching a blob of the previous frame (bounding box overlap) 
+     * with a similar area keeps its score and species, only new or significantly 
+     * changed blobs are classified again. This also stabilises the species labels.
+     */
+    class PlantTracker
+    {
+    public:
+        /**
+         * A classified plant blob of the previous frame.
+         */
+        struct Track
+        {
+            cv::Rect boundingBox;   // bounding box of the blob
+            double area;            // contour area of the blob
+            double score;           // classification score
+            Species species;        // retained species
+        };
+
+        /**
+         * Create a plant tracker.
+         * @param iMinOverlap the minimal intersection over union of the bounding boxes to match a blob
+         * @param iMaxAreaChange the maximal relative area change of a matched blob
+         */
+        PlantTracker(double iMinOverlap = 0.5, double iMaxAreaChange = 0.2);
+
+        /**
+         * Find the blob of the previous frame matching a blob of the current frame. 
+         * A blob of the previous frame can only be matched once.
+         * @param iBoundingBox the bounding box of the current blob
+         * @param iArea the area of the current blob
+         * @return the matched blob, nullptr if the blob is new or has changed
+         */
+        const Track* match(const cv::Rect& iBoundingBox, double iArea);
+
+        /**
+         * Replace the tracked blobs with the ones of the current frame.
+         * @param iTracks the classified blobs of the current frame
+         */
+        void update(std::vector<Track>&& iTracks);
+
+        /**
+         * Forget every tracked blob, the next frame is classified entirely.
+         */
+        void reset();
+
+        // @return the number of blobs whose classification has been reused
+        size_t getNbReused() const { return _nbReused; }
+
+        // @return the number of blobs which had to be classified
+        size_t getNbClassified() const { return _nbClassified; }
+
+    private:
+        double _minOverlap;
+        double _maxAreaChange;
+        std::vector<Track> _tracks;     //< blobs of the previous frame
+        std::vector<bool> _isMatched;   //< blobs of the previous frame already matched
+        size_t _nbReused = 0;
+        size_t _nbClassified = 0;
+    };
+}
+
+#endif // PLANT_TRACKER_HPP
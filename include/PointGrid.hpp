@@ -0,0 +1,143 @@
+//------------------------------------------------------------------------------
+//
+// File:        PointGrid.hpp
+// Description: Definition of PointGrid (uniform grid of points for proximity queries)
+//
+//------------------------------------------------------------------------------
+#ifndef POINT_GRID_HPP
+#define POINT_GRID_HPP
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace idl
+{
+    /**
+     * Uniform grid of points, bucketed by cell. A query visits the points of the cells
+     * overlapping the bounding box of a disc only, so with cells about the query radius,
+     * n queries on m points cost about n + m instead of n * m.
+     * The caller tests the exact distance of each visited point: the visited points
+     * are a superset of the points inside the disc.
+     */
+    class PointGrid
+    {
+    public:
+        /**
+         * Bucket points into cells.
+         * @param iPoints the points, referred to by their index in the queries
+         * @param iCellSize the side of a cell, ideally the usual query radius, enlarged for sparse points
+         */
+        void build(const std::vector<cv::Point2f>& iPoints, float iCellSize)
+        {
+            _cellSize = std::max(iCellSize, 1.0f);
+            _cols = _rows = 0;
+            _cellStart.clear();
+            _indices.clear();
+            if (iPoints.empty())
+            {
+                return;
+            }
+
+            _origin = iPoints[0];
+            cv::Point2f corner = iPoints[0];
+            for (const auto& point : iPoints)
+            {
+                _origin.x = std::min(_origin.x, point.x);
+                _origin.y = std::min(_origin.y, point.y);
+                corner.x = std::max(corner.x, point.x);
+                corner.y = std::max(corner.y, point.y);
+            }
+            // Larger cells for sparse points, the grid stays in proportion to the number of points
+            size_t maxCells = std::max<size_t>(1024, 4 * iPoints.size());
+            while (true)
+            {
+                _cols = cellOf(corner.x - _origin.x) + 1;
+                _rows = cellOf(corner.y - _origin.y) + 1;
+                if (static_cast<size_t>(_cols) * _rows <= maxCells)
+                {
+                    break;
+                }
+                _cellSize *= 2.0f;
+            }
+
+            // Counting sort of the points by cell
+            _cellStart.assign(static_cast<size_t>(_cols) * _rows + 1, 0);
+            std::vector<int> cells(iPoints.size());
+            for (size_t i = 0; i < iPoints.size(); ++i)
+            {
+                cells[i] = cellOf(iPoints[i].y - _origin.y) * _cols + cellOf(iPoints[i].x - _origin.x);
+                _cellStart[cells[i] + 1]++;
+            }
+            for (size_t c = 1; c < _cellStart.size(); ++c)
+            {
+                _cellStart[c] += _cellStart[c - 1];
+            }
+            _indices.resize(iPoints.size());
+            std::vector<int> next(_cellStart.begin(), _cellStart.end() - 1);
+            for (size_t i = 0; i < iPoints.size(); ++i)
+            {
+                _indices[next[cells[i]]++] = static_cast<int>(i);
+            }
+        }
+
+        /**
+         * Visit the points which may lie within a distance of a center.
+         * @param iCenter the center of the query
+         * @param iRadius the distance, a margin of one pixel is added for the rounding of the caller's test
+         * @param iVisit called with the index of each point, in increasing index order within a cell;
+         * returning true stops the query
+         * @return true if the query has been stopped
+         */
+        template <typename Visit>
+        bool visit(const cv::Point2f& iCenter, float iRadius, Visit&& iVisit) const
+        {
+            if (_indices.empty())
+            {
+                return false;
+            }
+
+            float reach = iRadius + 1.0f;
+            int firstCol = std::max(0, cellOf(iCenter.x - reach - _origin.x));
+            int lastCol  = std::min(_cols - 1, cellOf(iCenter.x + reach - _origin.x));
+            int firstRow = std::max(0, cellOf(iCenter.y - reach - _origin.y));
+            int lastRow  = std::min(_rows - 1, cellOf(iCenter.y + reach - _origin.y));
+            for (int row = firstRow; row <= lastRow; ++row)
+            {
+                for (int col = firstCol; col <= lastCol; ++col)
+                {
+                    int cell = row * _cols + col;
+                    for (int k = _cellStart[cell]; k < _cellStart[cell + 1]; ++k)
+                    {
+                        if (iVisit(_indices[k]))
+                        {
+                            return true;
+                        }
+                    }
+                }
+            }
+            return false;
+        }
+
+    private:
+        /**
+         * @param iOffset a coordinate relative to the grid origin
+         * @return the cell of the coordinate, clamped to the int range
+         */
+        int cellOf(float iOffset) const
+        {
+            float cell = std::floor(iOffset / _cellSize);
+            return static_cast<int>(std::max(-1.0f, std::min(cell, 1e8f)));
+        }
+
+        float _cellSize = 1.0f;
+        cv::Point2f _origin;
+        int _cols = 0;
+        int _rows = 0;
+        std::vector<int> _cellStart;    //< first point of each cell in _indices, and the total count last
+        std::vector<int> _indices;      //< points sorted by cell
+    };
+}
+
+#endif // POINT_GRID_HPP
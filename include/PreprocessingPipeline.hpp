@@ -0,0 +1,160 @@
+//------------------------------------------------------------------------------
+//
+// File:        PreprocessingPipeline.hpp
+// Description: Definition of PreprocessingPipeline (fused preprocessing steps)
+//
+//------------------------------------------------------------------------------
+#ifndef PREPROCESSING_PIPELINE_HPP
+#define PREPROCESSING_PIPELINE_HPP
+
+#include <opencv2/opencv.hpp>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace idl
+{
+    /**
+     * Chain of preprocessing steps applied to 8-bit images.
+     * Consecutive pointwise steps (grayscale, threshold, lookup table) are composed into
+     * a single lookup table and applied in one pass over the image; an equalization
+     * is computed on its input histogram and fused with the pointwise steps following it.
+     * The neighbourhood steps (median and Gaussian blurs) write into buffers kept from
+     * one image to the next, so a chain only allocates its output once the buffers are warm.
+     * The buffers make a pipeline usable by one thread at a time.
+     */
+    class PreprocessingPipeline
+    {
+    public:
+        using Table = std::array<uint8_t, 256>;
+
+        /**
+         * Append a conversion to grayscale, ignored on a gray image.
+         * @return the pipeline
+         */
+        PreprocessingPipeline& grayscale();
+
+        /**
+         * Append a binary thresholding, after a conversion to grayscale of a color image.
+         * @param iThresh the threshold value
+         * @param iMaxVal the value assigned to pixels exceeding the threshold
+         * @return the pipeline
+         */
+        PreprocessingPipeline& threshold(double iThresh, double iMaxVal);
+
+        /**
+         * Append a lookup table, applied to every channel.
+         * @param iTable the new value of each pixel value
+         * @return the pipeline
+         */
+        PreprocessingPipeline& lut(const Table& iTable);
+
+        /**
+         * Append a median blur.
+         * @param iKernelSize the size of the kernel, the step is ignored if it is not odd
+         * @return the pipeline
+         */
+        PreprocessingPipeline& medianBlur(int iKernelSize);
+
+        /**
+         * Append a Gaussian blur.
+         * @param iKernelSize the size of the kernel, the step is ignored if it is not odd
+         * @param iSigma the standard deviation of the kernel
+         * @return the pipeline
+         */
+        PreprocessingPipeline& gaussianBlur(int iKernelSize, double iSigma);
+
+        /**
+         * Append a histogram equalization, of each channel of a color image.
+         * @return the pipeline
+         */
+        PreprocessingPipeline& equalize();
+
+        /**
+         * Build a pipeline from a comma separated list of steps:
+         * gray, threshold:<t>[:<max>], invert, gamma:<g>, median:<k>, gaussian:<k>[:<sigma>], equalize.
+         * @param iConfig the steps, in order (ex. "gray,median:5,equalize")
+         * @param oPipeline the pipeline
+         * @return false if a step is unknown or malformed
+         */
+        static bool parse(const std::string& iConfig, PreprocessingPipeline& oPipeline);
+
+        /**
+         * Apply the steps, fused.
+         * @param iImg the 8-bit input image, gray or BGR
+         * @param oImg the image after, reallocated when it shares its data with the input
+         */
+        void apply(const cv::Mat& iImg, cv::Mat& oImg);
+
+        /**
+         * Apply the steps one after the other with the ImagePreProcessor functions, each
+         * one allocating its result. Reference for the fused version.
+         * @param iImg the input image
+         * @return the image after
+         */
+        cv::Mat applyStepByStep(const cv::Mat& iImg) const;
+
+        /**
+         * @param iChannels the number of channels of the input images
+         * @return the passes over the image, ex. "gray+lut | median5 | equalize+lut"
+         */
+        std::string describe(int iChannels) const;
+
+        /**
+         * @return if the pipeline has no step
+         */
+        bool empty() const { return _steps.empty(); }
+
+    private:
+        enum class StepType
+        {
+            grayscale,
+            threshold,
+            lut,
+            median,
+            gaussian,
+            equalize
+        };
+
+        struct Step
+        {
+            StepType type;
+            int kernelSize = 0;
+            double sigma = 0.0;
+            double thresh = 0.0;
+            double maxVal = 0.0;
+            Table table;        //< lut and threshold
+        };
+
+        enum class PassType
+        {
+            pointwise,          //< optional grayscale conversion, then a lookup table
+            equalized,          //< equalization of each channel, then a lookup table
+            median,
+            gaussian
+        };
+
+        struct Pass
+        {
+            PassType type;
+            bool toGray = false;
+            int kernelSize = 0;
+            double sigma = 0.0;
+            Table table;
+        };
+
+        /**
+         * Group the steps into passes over the image.
+         * @param iChannels the number of channels of the input image
+         * @param oPasses the passes, in order
+         */
+        void plan(int iChannels, std::vector<Pass>& oPasses) const;
+
+        std::vector<Step> _steps;
+        std::vector<Pass> _passes;  //< plan of the last image, kept with its allocation
+        cv::Mat _buffers[2];        //< intermediate images, reused from one image to the next
+    };
+}
+
+#endif // PREPROCESSING_PIPELINE_HPP
@@ -13,6 +13,13 @@
 #include "PlantDetector.hpp"
 #include "ImagePreProcessor.hpp"
 #include "JetPositionChecker.hpp"
+#include "LaserTracker.hpp"
+#include "PlantTracker.hpp"
+#include "StripDetector.hpp"
+#include "ProcessingOptions.hpp"
+#include "ImageDecoder.hpp"
+#include "FrameArchive.hpp"
+#include "ResultCache.hpp"
 // OpenCV
 #include <opencv2/opencv.hpp>
 // STL
@@ -20,6 +27,7 @@
 #include <vector>
 #include <iostream>
 #include <fstream>
+#include <functional>
 
 namespace idl
 {
@@ -30,20 +38,44 @@ namespace idl
         {
             friend class ProcessingFactory;
         protected:
-            ImageProcessing(cv::Mat&& iImage, std::string&& nImage);
+            /**
+             * Process an image.
+             * @param iImage the image to process
+             * @param nImage the name of the image
+             * @param iPlants the plants detected in the image
+             * @param iLocator the backend used to locate the laser lines
+             * @param iTracker the laser tracker of the image sequence, nullptr to search the whole image
+             * @param iReduction the reduction factor the image has been decoded with, 
+             *                   the results are written in the original image coordinates
+             */
+            ImageProcessing(cv::Mat&& iImage, std::string&& nImage, std::vector<Plant>&& iPlants,
+                LaserLocator iLocator = LaserLocator::hough, LaserTracker* iTracker = nullptr, int iReduction = 1);
         public:
             ImageProcessing() = default;
 
             ImageProcessing(const ImageProcessing&);
+            ImageProcessing(ImageProcessing&&);
             ImageProcessing& operator =(const ImageProcessing&);
 
             ~ImageProcessing();
 
             /**
-             * Write results to CSV in an output stream. 
+             * Write results to CSV in an output stream, in the original image coordinates. 
              */
             void write(std::ostream&) const;
 
+            /**
+             * Write results as a single line JSON object in an output stream, 
+             * in the original image coordinates. 
+             * @see ResultSink::appendJson()
+             */
+            void writeJson(std::ostream&) const;
+
+            /**
+             * @return the laser intersection in the original image coordinates, (-1, -1) if not found
+             */
+            cv::Point getIntersection() const;
+
             /**
              * @return the original image
              */
@@ -68,10 +100,18 @@ namespace idl
             // @return the name of the image
             std::string getImageName() const { return _nameImg; }
 
+            // @return the detected plants, in the processed image coordinates
+            const std::vector<Plant>& getPlants() const { return _plants; }
+
+            // @return the reduction factor the image has been decoded with
+            int getReduction() const { return _reduction; }
+
         private:
             std::string _nameImg;
             cv::Mat _img;
             std::vector<Plant>  _plants;
+            LaserLocator        _locator      = LaserLocator::hough;
+            int                 _reduction    = 1;
             LineDetector*       _lineDetector = nullptr;    
             JetPositionChecker* _jetChecker   = nullptr;
         };
@@ -86,9 +126,48 @@ namespace idl
          * Create a new image processing pipeline. 
          * 
          * @param iImgDirectory a directory containing png file label as img###.png 
-         *                      with ### the number of the file from 000 to 100 (in order)
+         *                      with ### the number of the file from 000 to 100 (in order), 
+         *                      or a frame archive (.idlf) whose frames are used without decoding
+         * @param iOptions the processing settings
+         * @param iOnProcessed called as soon as each image is processed, in order
+         */
+        ProcessingFactory(const std::string& iImgDirectory, 
+            const ProcessingOptions& iOptions = ProcessingOptions(),
+            const std::function<void(const ImageProcessing&)>& iOnProcessed = nullptr);
+
+        /**
+         * Create an empty image processing pipeline, the images are then processed one by one. 
+         * @param iOptions the processing settings
+         * @see ProcessingFactory::process()
+         */
+        explicit ProcessingFactory(const ProcessingOptions& iOptions);
+
+        /**
+         * Decode and process the next image of the sequence. 
+         * @param iFileName the png file of the image
+         * @return the processing of the image, valid until the next call, nullptr if the image cannot be decoded
+         */
+        const ImageProcessing* process(const std::string& iFileName);
+
+        /**
+         * Process the next image of the sequence, already decoded. 
+         * @param iImage the BGR image, decoded with the reduction of the settings. It is not copied 
+         *               and must stay valid as long as its processing is kept.
+         * @param iName the name of the image
+         * @return the processing of the image, valid until the next call, nullptr if the image is empty
          */
-        ProcessingFactory(const std::string& iImgDirectory);
+        const ImageProcessing* process(const cv::Mat& iImage, const std::string& iName);
+
+        /**
+         * Drop the processing done so far. The state of the sequence (trackers, cache) is kept.
+         */
+        void clear();
+
+        /**
+         * Move the processing done so far out of the factory. The state of the sequence is kept.
+         * @return the processing, in order
+         */
+        std::vector<ImageProcessing> takeProcessing();
 
         /**
          * List each process create for every image
@@ -97,8 +176,39 @@ namespace idl
         { return _listOfProcess; }
 
         const ImageProcessing& operator[](size_t index) const;
+
+        /**
+         * @return the plant tracker of the image sequence
+         */
+        const PlantTracker& getPlantTracker() const { return _plantTracker; }
+
+        /**
+         * @return the results cache across runs
+         */
+        const ResultCache& getResultCache() const { return _cache; }
     private:
+        /**
+         * Detect the plants of the next image according to the processing settings.
+         * @param iImage the image to analyze
+         * @return the detected plants
+         */
+        std::vector<Plant> detectPlants(const cv::Mat& iImage);
+
+        /**
+         * Process the next image of the sequence and append it to the list of processing. 
+         * The results of an unchanged image are loaded from the cache when enabled.
+         * @param iImage the image to process
+         * @param iName the name of the image
+         */
+        void processImage(cv::Mat&& iImage, std::string&& iName);
+
+        FrameArchive _archive;  //< mapped frames, must outlive the processing viewing them
         std::vector<ImageProcessing> _listOfProcess;
+        ProcessingOptions _options;
+        LaserTracker _laserTracker;
+        PlantTracker _plantTracker;
+        StripDetector _stripDetector;
+        ResultCache _cache;
     };
 }
 
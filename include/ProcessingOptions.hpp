@@ -0,0 +1,27 @@
+#ifndef PROCESSING_OPTIONS_HPP
+#define PROCESSING_OPTIONS_HPP
+
+#include "LaserLocator.hpp"
+#include "ResultFormat.hpp"
+#include <string>
+
+namespace idl
+{
+    /**
+     * Settings of the image processing pipeline.
+     */
+    struct ProcessingOptions
+    {
+        LaserLocator laserLocator = LaserLocator::hough; //< backend used to locate the laser lines
+        bool trackLaser = false;    //< track the laser across consecutive images (sequential input)
+        bool trackPlants = false;   //< reuse plant classifications across consecutive images
+        bool stripMode = false;     //< only detect plants on the newly exposed strip (forward-moving camera)
+        int plantDownscale = 1;     //< coarse-to-fine plant detection reduction factor (1, 2 or 4)
+        int decodeReduction = 1;    //< decode the images reduced by 1, 2, 4 or 8, results are written in the original coordinates
+        int decodeThreads = 0;      //< number of images decoded ahead in parallel, 0 to decode before each processing
+        std::string cacheDirectory; //< directory of the results cache across runs, empty to disable it
+        ResultFormat resultFormat = ResultFormat::csv; //< format of the results file
+    };
+}
+
+#endif // PROCESSING_OPTIONS_HPP
@@ -0,0 +1,89 @@
+//------------------------------------------------------------------------------
+//
+// File:        ProcessingPipeline.hpp
+// Description: Definition of ProcessingPipeline (staged and overlapped processing)
+//
+//------------------------------------------------------------------------------
+#ifndef PROCESSING_PIPELINE_HPP
+#define PROCESSING_PIPELINE_HPP
+
+#include "ProcessingFactory.hpp"
+#include "ProcessingOptions.hpp"
+#include "ResultSink.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace idl
+{
+    /**
+     * Process a directory of images (or a frame archive) as four stages: decode, detect,
+     * render the overlays and write the results. Each stage runs on its own threads and
+     * hands the frames to the next one through a bounded lock-free queue, so that the PNG
+     * decoding and encoding overlap with the detection.
+     * The detection stays sequential, in the order of the images, when it depends on the
+     * previous image (tracking or strip mode). The result rows are written in the order of the images.
+     */
+    class ProcessingPipeline
+    {
+    public:
+        /**
+         * Threads of each stage and size of the queues between them.
+         */
+        struct Settings
+        {
+            int decodeThreads = 1;      //< threads decoding the images
+            int detectThreads = 1;      //< threads detecting the laser and plants, 1 when tracking
+            int renderThreads = 1;      //< threads drawing the overlays
+            int writeThreads  = 1;      //< threads encoding the overlays and writing the results
+            size_t queueCapacity = 8;   //< frames held between two stages
+        };
+
+        /**
+         * Activity of a stage over a run.
+         */
+        struct StageStats
+        {
+            std::string name;
+            int nbThreads = 0;
+            uint64_t nbFrames = 0;      //< frames handled
+            double busyMs = 0.0;        //< time spent working, summed over the threads
+            double starvedMs = 0.0;     //< time spent waiting for a frame from the previous stage
+            double blockedMs = 0.0;     //< time spent waiting for room in the next stage queue
+            double meanDepth = 0.0;     //< mean number of frames waiting in the input queue
+            size_t maxDepth = 0;        //< maximal number of frames waiting in the input queue
+        };
+
+        // Disallow copy
+        ProcessingPipeline(const ProcessingPipeline&) = delete;
+        ProcessingPipeline& operator =(const ProcessingPipeline&) = delete;
+
+        /**
+         * Create a pipeline.
+         * @param iOptions the processing settings
+         * @param iSettings the threads of each stage
+         */
+        ProcessingPipeline(const ProcessingOptions& iOptions, const Settings& iSettings);
+
+        /**
+         * Process every image of a directory, until all results are written.
+         * @param iImgDirectory a directory containing png files, or a frame archive (.idlf)
+         * @param iOutputDirectory the directory where the overlays are written
+         * @param oSink the results file, each row being written as soon as the previous ones are
+         * @return the number of processed images, -1 if the input cannot be read
+         */
+        int run(const std::string& iImgDirectory, const std::string& iOutputDirectory, ResultSink& oSink);
+
+        /**
+         * @return the activity of each stage over the last run, in the order of the stages
+         */
+        const std::vector<StageStats>& getStats() const { return _stats; }
+
+    private:
+        ProcessingOptions _options;
+        Settings _settings;
+        std::vector<StageStats> _stats;
+    };
+}
+
+#endif // PROCESSING_PIPELINE_HPP
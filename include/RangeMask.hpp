@@ -0,0 +1,93 @@
+//------------------------------------------------------------------------------
+//
+// File:        RangeMask.hpp
+// Description: Definition of the compile-time color range masks
+//
+//------------------------------------------------------------------------------
+#ifndef RANGE_MASK_HPP
+#define RANGE_MASK_HPP
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+
+namespace idl
+{
+    /**
+     * Inclusive range of 3 channels colors known at compile time, as given to cv::inRange. 
+     * The bounds of a channel covering the whole [0, 255] range are not tested, 
+     * and a channel whose minimum exceeds its maximum matches no value, as with cv::inRange.
+     */
+    template <int Min0, int Min1, int Min2, int Max0, int Max1, int Max2>
+    struct ColorRange
+    {
+        /**
+         * @param iValue a channel value
+         * @return if the value lies in [Min, Max], only testing the bounds excluding values
+         */
+        template <int Min, int Max>
+        static inline bool inChannel(uint8_t iValue)
+        {
+            if constexpr (Min > Max)
+            {
+                // Empty range, the unsigned comparison below would wrap and accept every value
+                return false;
+            }
+            else if constexpr (Min <= 0 && Max >= 255)
+            {
+                return true;
+            }
+            else if constexpr (Min <= 0)
+            {
+                return iValue <= Max;
+            }
+            else if constexpr (Max >= 255)
+            {
+                return iValue >= Min;
+            }
+            else
+            {
+                // One unsigned comparison for both bounds
+                return static_cast<unsigned>(iValue - Min) <= static_cast<unsigned>(Max - Min);
+            }
+        }
+
+        /**
+         * @param iPixel the 3 channels of a pixel
+         * @return if the pixel lies in the range
+         */
+        static inline bool contains(const uint8_t* iPixel)
+        {
+            // Bitwise and: no branch, the loop over the pixels can be vectorized
+            return inChannel<Min0, Max0>(iPixel[0]) & inChannel<Min1, Max1>(iPixel[1]) & inChannel<Min2, Max2>(iPixel[2]);
+        }
+    };
+
+    /**
+     * Build the mask of the pixels lying in any of several color ranges, in a single pass. 
+     * Equivalent to cv::inRange on each range then cv::bitwise_or of the masks.
+     * @tparam Ranges the ColorRange types
+     * @param iImage the 3 channels 8 bits image
+     * @param oMask the mask, 255 in the ranges and 0 elsewhere (reversed if inverted)
+     * @param iInvert whether to invert the mask in the same pass
+     */
+    template <typename... Ranges>
+    void rangeMask(const cv::Mat& iImage, cv::Mat& oMask, bool iInvert = false)
+    {
+        CV_Assert(CV_8UC3 == iImage.type());
+        oMask.create(iImage.rows, iImage.cols, CV_8UC1);
+
+        const uint8_t flip = iInvert ? 255 : 0;
+        for (int j = 0; j < iImage.rows; ++j)
+        {
+            const uint8_t* pixel = iImage.ptr<uint8_t>(j);
+            uint8_t* mask = oMask.ptr<uint8_t>(j);
+            for (int i = 0; i < iImage.cols; ++i, pixel += 3)
+            {
+                bool isInside = (Ranges::contains(pixel) | ...);
+                mask[i] = static_cast<uint8_t>(-static_cast<int>(isInside)) ^ flip;
+            }
+        }
+    }
+}
+
+#endif // RANGE_MASK_HPP
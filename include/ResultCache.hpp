@@ -0,0 +1,100 @@
+//------------------------------------------------------------------------------
+//
+// File:        ResultCache.hpp
+// Description: Definition of ResultCache (on-disk detection results across runs)
+//
+//------------------------------------------------------------------------------
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+
+#include "Plant.hpp"
+#include "LineDetector.hpp"
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace idl
+{
+    /**
+     * Cache of the detection results on disk, to skip the unchanged images across runs. 
+     * 
+     * An entry is keyed by the hash of the image pixels combined with the hash of the 
+     * settings the results depend on: changing the plant settings only invalidates the 
+     * plants, changing the laser settings only invalidates the laser results. 
+     * Each entry is stored in its own file, named after its key. Plant masks are stored 
+     * png-compressed.
+     */
+    class ResultCache
+    {
+    public:
+        ResultCache() = default;
+
+        /**
+         * Use a directory as cache, created if needed.
+         * @param iDirectory the cache directory
+         * @return false if the directory cannot be used
+         */
+        bool open(const std::string& iDirectory);
+
+        /**
+         * @return if a cache directory is used
+         */
+        bool isOpen() const { return !_directory.empty(); }
+
+        /**
+         * Load the plants of an image.
+         * @param iKey the key of the entry
+         * @param iImage the image the plants were detected on
+         * @param oPlants the cached plants
+         * @return false if the entry does not exist or is invalid
+         */
+        bool loadPlants(uint64_t iKey, const cv::Mat& iImage, std::vector<Plant>& oPlants);
+
+        /**
+         * Store the plants of an image.
+         * @param iKey the key of the entry
+         * @param iPlants the detected plants
+         */
+        void storePlants(uint64_t iKey, const std::vector<Plant>& iPlants) const;
+
+        /**
+         * Load the laser detection results of an image.
+         * @param iKey the key of the entry
+         * @param oResults the cached results
+         * @return false if the entry does not exist or is invalid
+         */
+        bool loadLaser(uint64_t iKey, LineDetector::Results& oResults);
+
+        /**
+         * Store the laser detection results of an image.
+         * @param iKey the key of the entry
+         * @param iResults the detection results
+         */
+        void storeLaser(uint64_t iKey, const LineDetector::Results& iResults) const;
+
+        /**
+         * @return the number of entries loaded from the cache
+         */
+        size_t getNbHits() const { return _nbHits; }
+
+        /**
+         * @return the number of entries missing from the cache
+         */
+        size_t getNbMisses() const { return _nbMisses; }
+
+    private:
+        /**
+         * @param iKey the key of an entry
+         * @param iKind the kind of results of the entry
+         * @return the file of the entry
+         */
+        std::string entryPath(uint64_t iKey, const char* iKind) const;
+
+        std::string _directory;
+        size_t _nbHits = 0;
+        size_t _nbMisses = 0;
+    };
+}
+
+#endif // RESULT_CACHE_HPP
@@ -0,0 +1,16 @@
+#ifndef RESULT_FORMAT_HPP
+#define RESULT_FORMAT_HPP
+
+namespace idl
+{
+    /**
+     * Format of the results file written by the ResultSink.
+     */
+    enum class ResultFormat
+    {
+        csv,    // one row per image: intersection, laser state and plant centers
+        jsonl   // one JSON object per line with the full plant data
+    };
+}
+
+#endif // RESULT_FORMAT_HPP
@@ -0,0 +1,112 @@
+//------------------------------------------------------------------------------
+//
+// File:        ResultSink.hpp
+// Description: Definition of ResultSink (results written as the images complete)
+//
+//------------------------------------------------------------------------------
+#ifndef RESULT_SINK_HPP
+#define RESULT_SINK_HPP
+
+#include "ProcessingFactory.hpp"
+#include "ResultFormat.hpp"
+#include <cstddef>
+#include <string>
+
+namespace idl
+{
+    /**
+     * Results file written one row per image, as soon as the image is processed. 
+     * Each row is formatted in a reused buffer, numbers being converted with std::to_chars, 
+     * then handed to the system with a single write: the completed rows are kept even if 
+     * the process crashes afterwards.
+     */
+    class ResultSink
+    {
+    public:
+        // Disallow copy
+        ResultSink(const ResultSink&) = delete;
+        ResultSink& operator =(const ResultSink&) = delete;
+
+        ResultSink() = default;
+
+        /**
+         * Close the file.
+         */
+        ~ResultSink();
+
+        /**
+         * Create the results file, or append to it, and write the CSV header to a new file.
+         * @param iPath the path of the file
+         * @param iFormat the format of the rows
+         * @return false if the file cannot be opened
+         */
+        bool open(const std::string& iPath, ResultFormat iFormat);
+
+        /**
+         * @return if the results file is open
+         */
+        bool isOpen() const { return _fd >= 0; }
+
+        /**
+         * @return the format of the rows
+         */
+        ResultFormat getFormat() const { return _format; }
+
+        /**
+         * Format the results of an image and write them to the file.
+         * @param iProcessing the processed image
+         * @return false if the row cannot be written
+         */
+        bool write(const ProcessingFactory::ImageProcessing& iProcessing);
+
+        /**
+         * Format the results of an image in the format of the file. 
+         * Can be called concurrently, the rows being then written with writeRow().
+         * @param iProcessing the processed image
+         * @param oRow the formatted row, replaced
+         */
+        void format(const ProcessingFactory::ImageProcessing& iProcessing, std::string& oRow) const;
+
+        /**
+         * Write a formatted row to the file.
+         * @param iRow the row, ending with a new line
+         * @return false if the row cannot be written
+         */
+        bool writeRow(const std::string& iRow);
+
+        /**
+         * @return the number of rows written
+         */
+        size_t getNbRows() const { return _nbRows; }
+
+        /**
+         * Append the results of an image as a CSV row, in the original image coordinates: 
+         * name, (x; y), laser state, "(x; y)/ ... , (x; y)/ ..." (advantis then wheat centers).
+         * @param iProcessing the processed image
+         * @param ioRow the row to append to
+         */
+        static void appendCsv(const ProcessingFactory::ImageProcessing& iProcessing, std::string& ioRow);
+
+        /**
+         * Append the results of an image as a single line JSON object, in the original image coordinates: 
+         * {"image": name, "laser": state, "intersection": [x, y], "plants": [{"species": name, 
+         *  "center": [x, y], "box": [x, y, w, h], "area": a, "score": s}, ...]}
+         * @param iProcessing the processed image
+         * @param ioRow the row to append to
+         */
+        static void appendJson(const ProcessingFactory::ImageProcessing& iProcessing, std::string& ioRow);
+
+        /**
+         * The header line of the CSV format.
+         */
+        static const char* const csvHeader;
+
+    private:
+        int _fd = -1;
+        ResultFormat _format = ResultFormat::csv;
+        std::string _buffer;    //< row being written, its capacity is kept between rows
+        size_t _nbRows = 0;
+    };
+}
+
+#endif // RESULT_SINK_HPP
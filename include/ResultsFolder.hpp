@@ -0,0 +1,65 @@
+//------------------------------------------------------------------------------
+//
+// File:        ResultsFolder.hpp
+// Description: Definition of the results folder of a run (results file, overlays, counters)
+//
+//------------------------------------------------------------------------------
+#ifndef RESULTS_FOLDER_HPP
+#define RESULTS_FOLDER_HPP
+
+#include "ProcessingFactory.hpp"
+#include "ResultFormat.hpp"
+#include "ResultSink.hpp"
+#include <opencv2/opencv.hpp>
+#include <filesystem>
+#include <string>
+
+namespace idl
+{
+#ifdef __APPLE__
+    namespace fs = std::__fs::filesystem;  // Sur macOS, utilisez __fs::filesystem
+#else
+    namespace fs = std::filesystem;  // Sur les autres systèmes, utilisez std::filesystem
+#endif
+
+    /**
+     * Get the current date and time as a formatted string.
+     * The date and time format is: YYYY-MM-DD_HH-MM-SS
+     * @return string representing date and time
+     */
+    std::string getCurrentDateTime();
+
+    /**
+     * Create the results file with the name format "YYYY-MM-DD_HH-MM-SS_plantCheck.csv"
+     * (".jsonl" for JSON Lines), the rows being written as the images are processed.
+     * The counters of each frame are written next to it, when enabled.
+     * @param results the results file to open
+     * @param pathFolder the folder of the results file
+     * @param format the format of the rows
+     * @return false if the file cannot be created
+     */
+    bool openResults(ResultSink& results, const fs::path& pathFolder, ResultFormat format);
+
+    /**
+     * Create the results folder named "YYYY-MM-DD_HH-MM-SSWeedProj_Results".
+     * @return the absolute path of the folder, empty on error
+     */
+    fs::path createResultsFolder();
+
+    /**
+     * Print the hardware counters of each stage and close their counts on each frame
+     * in the results folder, when the counters are enabled.
+     * @param savedPath the results folder
+     */
+    void reportPerfCounters(const fs::path& savedPath);
+
+    /**
+     * Save the detail and mask overlays of a processed image.
+     * @param processing the processed image
+     * @param savedPath the results folder
+     * @param imgs the overlays, returned for display
+     */
+    void saveOverlays(const ProcessingFactory::ImageProcessing& processing, const fs::path& savedPath, cv::Mat imgs[2]);
+}
+
+#endif // RESULTS_FOLDER_HPP
@@ -0,0 +1,85 @@
+//------------------------------------------------------------------------------
+//
+// File:        StripDetector.hpp
+// Description: Definition of StripDetector (incremental plant detection)
+//
+//------------------------------------------------------------------------------
+#ifndef STRIP_DETECTOR_HPP
+#define STRIP_DETECTOR_HPP
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "Plant.hpp"
+
+namespace idl
+{
+    /**
+     * Incremental plant detection for a camera moving forward along the row. 
+     * The shift between consecutive frames is estimated by phase correlation on a 
+     * downsampled gray frame. Plants are only detected on the newly exposed strip 
+     * (plus a margin), the plants of the overlap being moved from the previous frame. 
+     * The whole frame is processed when the shift cannot be trusted. 
+     */
+    class StripDetector
+    {
+    public:
+        /**
+         * Create a strip detector.
+         * @param iMargin the overlap analyzed with the new strip, in px, must exceed half a plant
+         * @param iScale the downsampling factor of the frames used for the shift estimation
+         * @param iMinResponse the minimal phase correlation response to trust the shift
+         * @param iRefreshPeriod the number of frames between two whole frame detections, 0 to never refresh
+         */
+        StripDetector(int iMargin = 200, double iScale = 0.25, double iMinResponse = 0.05, 
+            int iRefreshPeriod = 50);
+
+        /**
+         * Detect the plants of the next frame of the sequence.
+         * @param iImage the next frame
+         * @param iDownscale the reduction factor for the coarse-to-fine detection, 1 for full resolution
+         * @param iReduction the reduction factor the frame has been decoded with, 1 for full resolution
+         * @return the plants of the frame, in the frame coordinates
+         */
+        std::vector<Plant> detectPlants(const cv::Mat& iImage, int iDownscale = 1, int iReduction = 1);
+
+        /**
+         * @return the shift estimated between the two last frames, in px
+         */
+        const cv::Point& getLastShift() const { return _shift; }
+
+        /**
+         * @return the area of the last frame where the plants have been detected
+         */
+        const cv::Rect& getLastArea() const { return _area; }
+
+        /**
+         * Forget the previous frame, the next one is processed entirely.
+         */
+        void reset();
+
+    private:
+        /**
+         * Move a plant of the previous frame into the current one. 
+         * @param iPlant the plant of the previous frame
+         * @param iShift the shift between the two frames
+         * @param iImage the current frame
+         * @param oPlant the moved plant, cropped to its visible part
+         * @return if the plant is still visible in the current frame
+         */
+        static bool shiftPlant(const Plant& iPlant, const cv::Point& iShift, const cv::Mat& iImage, Plant& oPlant);
+
+        int _margin;
+        double _scale;
+        double _minResponse;
+        int _refreshPeriod;
+
+        cv::Mat _prevGray;              //< downsampled gray previous frame
+        cv::Mat _window;                //< hanning window of the phase correlation
+        std::vector<Plant> _plants;     //< plants of the previous frame
+        cv::Point _shift {0, 0};        //< shift between the two last frames
+        cv::Rect _area;                 //< area processed in the last frame
+        int _nbFrames = 0;              //< frames since the last whole frame detection
+    };
+}
+
+#endif // STRIP_DETECTOR_HPP
@@ -0,0 +1,78 @@
+#include "AllocationCounter.hpp"
+#include <cstdlib>
+#include <new>
+
+#ifdef IDL_COUNT_ALLOCATIONS
+
+namespace
+{
+    thread_local uint64_t nbAllocations = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    nbAllocations++;
+    if (0 == size)
+    {
+        size = 1;
+    }
+
+    // Same contract as the standard operator new: the new handler is called until it gives up
+    void* ptr;
+    while (!(ptr = std::malloc(size)))
+    {
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+        {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace idl
+{
+    namespace allocations
+    {
+        bool isCounted()
+        {
+            return true;
+        }
+
+        uint64_t count()
+        {
+            return nbAllocations;
+        }
+    }
+}
+
+#else
+
+namespace idl
+{
+    namespace allocations
+    {
+        bool isCounted()
+        {
+            return false;
+        }
+
+        uint64_t count()
+        {
+            return 0;
+        }
+    }
+}
+
+#endif
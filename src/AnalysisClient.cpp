@@ -0,0 +1,148 @@
+#include "AnalysisClient.hpp"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace idl
+{
+    AnalysisClient::~AnalysisClient()
+    {
+        if (_shmData)
+        {
+            munmap(_shmData, _shmSize);
+            shm_unlink(_shmName.c_str());
+        }
+        if (_fd >= 0)
+        {
+            close(_fd);
+        }
+    }
+
+    bool AnalysisClient::connect(const std::string& iSocketPath)
+    {
+        struct sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (iSocketPath.size() >= sizeof(address.sun_path))
+        {
+            std::cerr << "Error: Socket path too long " << iSocketPath << std::endl;
+            return false;
+        }
+        std::strncpy(address.sun_path, iSocketPath.c_str(), sizeof(address.sun_path) - 1);
+
+        _fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (_fd < 0 || ::connect(_fd, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            std::cerr << "Error: Unable to reach the server " << iSocketPath << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool AnalysisClient::request(const std::string& iRequest, std::string& oReply)
+    {
+        std::string line = iRequest + "\n";
+        size_t sent = 0;
+        while (sent < line.size())
+        {
+            ssize_t n = send(_fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && EINTR == errno)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+
+        // Wait for the whole reply line
+        size_t end;
+        while ((end = _buffer.find('\n')) == std::string::npos)
+        {
+            char chunk[4096];
+            ssize_t n = recv(_fd, chunk, sizeof(chunk), 0);
+            if (n < 0 && EINTR == errno)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                return false;
+            }
+            _buffer.append(chunk, static_cast<size_t>(n));
+        }
+
+        oReply = _buffer.substr(0, end);
+        _buffer.erase(0, end + 1);
+        return true;
+    }
+
+    bool AnalysisClient::analyseFile(const std::string& iFileName, std::string& oReply)
+    {
+        return request("FILE " + iFileName, oReply);
+    }
+
+    bool AnalysisClient::analyseFrame(const cv::Mat& iFrame, std::string& oReply)
+    {
+        if (iFrame.empty() || CV_8UC3 != iFrame.type())
+        {
+            std::cerr << "Error: Only BGR frames can be shared" << std::endl;
+            return false;
+        }
+
+        size_t step = iFrame.cols * iFrame.elemSize();
+        size_t size = step * iFrame.rows;
+
+        // One shared memory object per client, grown when needed
+        if (size > _shmSize)
+        {
+            if (_shmData)
+            {
+                munmap(_shmData, _shmSize);
+                _shmData = nullptr;
+                _shmSize = 0;
+            }
+
+            _shmName = "/idl-client-" + std::to_string(getpid());
+            int fd = shm_open(_shmName.c_str(), O_CREAT | O_RDWR, 0600);
+            if (fd < 0 || ftruncate(fd, static_cast<off_t>(size)) != 0)
+            {
+                std::cerr << "Error: Unable to create the shared memory frame" << std::endl;
+                if (fd >= 0)
+                {
+                    close(fd);
+                }
+                return false;
+            }
+
+            void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (MAP_FAILED == data)
+            {
+                std::cerr << "Error: Unable to map the shared memory frame" << std::endl;
+                return false;
+            }
+            _shmData = data;
+            _shmSize = size;
+        }
+
+        // The request is synchronous: the frame is not overwritten before the reply
+        cv::Mat shared(iFrame.rows, iFrame.cols, CV_8UC3, _shmData, step);
+        iFrame.copyTo(shared);
+
+        return request("SHM " + _shmName + " " + std::to_string(iFrame.rows) + " " + std::to_string(iFrame.cols) 
+                       + " " + std::to_string(step), oReply);
+    }
+}
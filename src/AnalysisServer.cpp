@@ -0,0 +1,306 @@
+#include "AnalysisServer.hpp"
+#include "LineDetector.hpp"
+#include "PlantDetector.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <vector>
+// POSIX
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace idl
+{
+    namespace
+    {
+        const size_t maxRequestSize = 4096;   // bytes, a longer line closes the connection
+        const int    maxPendingClients = 16;
+
+        /**
+         * Send a whole buffer, a closed peer is not a fatal error.
+         */
+        bool sendAll(int fd, const std::string& data)
+        {
+            size_t sent = 0;
+            while (sent < data.size())
+            {
+                ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+                if (n < 0 && EINTR == errno)
+                {
+                    continue;
+                }
+                if (n <= 0)
+                {
+                    return false;
+                }
+                sent += static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        std::string errorReply(const char* message)
+        {
+            return std::string("{\"error\":\"") + message + "\"}\n";
+        }
+
+        /**
+         * Check that a path can be bound: free, or a socket left by a server that has ended.
+         * @param address the address of the socket
+         * @return false if the path is another file or the socket of a running server
+         */
+        bool isFree(const struct sockaddr_un& address)
+        {
+            struct stat status;
+            if (lstat(address.sun_path, &status) != 0)
+            {
+                return ENOENT == errno;
+            }
+            if (!S_ISSOCK(status.st_mode))
+            {
+                return false;
+            }
+
+            // Nobody listening anymore: the socket of a previous run
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0)
+            {
+                return false;
+            }
+            bool isStale = connect(fd, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address)) != 0 
+                        && ECONNREFUSED == errno;
+            close(fd);
+            return isStale && 0 == unlink(address.sun_path);
+        }
+    }
+
+    AnalysisServer::AnalysisServer(const std::string& iSocketPath, const ProcessingOptions& iOptions):
+        _socketPath(iSocketPath), _factory(iOptions)
+    {
+    }
+
+    AnalysisServer::~AnalysisServer()
+    {
+        if (_fd >= 0)
+        {
+            close(_fd);
+            unlink(_socketPath.c_str());
+        }
+    }
+
+    bool AnalysisServer::open()
+    {
+        struct sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (_socketPath.size() >= sizeof(address.sun_path))
+        {
+            std::cerr << "Error: Socket path too long " << _socketPath << std::endl;
+            return false;
+        }
+        std::strncpy(address.sun_path, _socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+        // Only the socket left by a previous run is removed
+        if (!isFree(address))
+        {
+            std::cerr << "Error: " << _socketPath << " already exists and is not the socket of an ended server" << std::endl;
+            return false;
+        }
+
+        _fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (_fd < 0)
+        {
+            std::cerr << "Error: Unable to create the socket" << std::endl;
+            return false;
+        }
+        fcntl(_fd, F_SETFD, FD_CLOEXEC);
+
+        if (bind(_fd, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address)) != 0 
+            || listen(_fd, maxPendingClients) != 0)
+        {
+            std::cerr << "Error: Unable to listen on " << _socketPath << std::endl;
+            close(_fd);
+            _fd = -1;
+            return false;
+        }
+
+        // Warm up: OpenCV initialisation, thread pool and first allocations, before the first request
+        cv::Mat frame(480, 640, CV_8UC3, cv::Scalar(40, 90, 60));
+        PlantDetector::detectPlants(frame);
+        LineDetector(frame).getIntersection();
+
+        return true;
+    }
+
+    size_t AnalysisServer::run(const volatile std::sig_atomic_t& iStop)
+    {
+        // Entry 0 is the listening socket, the others are the connected clients
+        std::vector<struct pollfd> fds = {{_fd, POLLIN, 0}};
+        std::vector<std::string> buffers(1);
+        size_t nbServed = 0;
+
+        while (!iStop)
+        {
+            int ready = poll(fds.data(), fds.size(), 200);
+            if (ready < 0 && EINTR != errno)
+            {
+                std::cerr << "Error: Failed to wait for the requests" << std::endl;
+                break;
+            }
+            if (ready <= 0)
+            {
+                continue;
+            }
+
+            // Serve the connected clients, in reverse order to erase the closed ones
+            for (size_t i = fds.size() - 1; i > 0; --i)
+            {
+                if (0 == fds[i].revents)
+                {
+                    continue;
+                }
+
+                char chunk[1024];
+                ssize_t length = recv(fds[i].fd, chunk, sizeof(chunk), 0);
+                bool isClosed = length <= 0 && !(length < 0 && EINTR == errno);
+
+                if (length > 0)
+                {
+                    buffers[i].append(chunk, static_cast<size_t>(length));
+
+                    size_t end;
+                    while (!isClosed && (end = buffers[i].find('\n')) != std::string::npos)
+                    {
+                        std::string request = buffers[i].substr(0, end);
+                        buffers[i].erase(0, end + 1);
+                        isClosed = !sendAll(fds[i].fd, handle(request));
+                        nbServed++;
+                    }
+                    isClosed = isClosed || buffers[i].size() > maxRequestSize;
+                }
+
+                if (isClosed)
+                {
+                    close(fds[i].fd);
+                    fds.erase(fds.begin() + i);
+                    buffers.erase(buffers.begin() + i);
+                }
+            }
+
+            // New clients
+            if (fds[0].revents & POLLIN)
+            {
+                int client = accept(_fd, nullptr, nullptr);
+                if (client >= 0)
+                {
+                    fcntl(client, F_SETFD, FD_CLOEXEC);
+                    fds.push_back({client, POLLIN, 0});
+                    buffers.emplace_back();
+                }
+            }
+        }
+
+        for (size_t i = 1; i < fds.size(); ++i)
+        {
+            close(fds[i].fd);
+        }
+
+        return nbServed;
+    }
+
+    std::string AnalysisServer::handle(const std::string& iRequest)
+    {
+        std::istringstream stream(iRequest);
+        std::string command;
+        stream >> command;
+
+        const ProcessingFactory::ImageProcessing* processing = nullptr;
+        std::string reply;
+        void* mapping = nullptr;
+        size_t mappingSize = 0;
+
+        if ("PING" == command)
+        {
+            return "PONG\n";
+        }
+        else if ("FILE" == command)
+        {
+            std::string fileName;
+            std::getline(stream >> std::ws, fileName);
+            processing = _factory.process(fileName);
+            if (!processing)
+            {
+                reply = errorReply("cannot decode the image");
+            }
+        }
+        else if ("SHM" == command)
+        {
+            std::string name;
+            int rows = 0, cols = 0;
+            size_t step = 0;
+            stream >> name >> rows >> cols >> step;
+
+            int fd = -1;
+            struct stat status;
+
+            // The row length may only be padded up to a cache line, and the frame must fit the object: 
+            // the size is compared by division, the product of client values could wrap
+            const size_t rowSize = static_cast<size_t>(std::max(cols, 0)) * 3;
+            const size_t maxStep = (rowSize + 63) / 64 * 64;
+            mappingSize = step * static_cast<size_t>(std::max(rows, 0));   // used once step and rows are checked
+            if (!stream || rows <= 0 || cols <= 0 || step < rowSize || step > maxStep)
+            {
+                reply = errorReply("invalid frame");
+            }
+            else if ((fd = shm_open(name.c_str(), O_RDONLY, 0)) < 0 || fstat(fd, &status) != 0 
+                     || step > static_cast<size_t>(status.st_size) / static_cast<size_t>(rows))
+            {
+                reply = errorReply("cannot open the shared memory frame");
+            }
+            else if (MAP_FAILED == (mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0)))
+            {
+                mapping = nullptr;
+                reply = errorReply("cannot map the shared memory frame");
+            }
+            else
+            {
+                // Zero-copy view of the client frame
+                processing = _factory.process(cv::Mat(rows, cols, CV_8UC3, mapping, step), name);
+            }
+
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+        else
+        {
+            reply = errorReply("unknown request");
+        }
+
+        if (processing)
+        {
+            std::ostringstream json;
+            processing->writeJson(json);
+            reply = json.str();
+        }
+
+        // The processing views the frame: drop it before unmapping
+        _factory.clear();
+        if (mapping)
+        {
+            munmap(mapping, mappingSize);
+        }
+
+        return reply;
+    }
+}
@@ -0,0 +1,494 @@
+#include "Benchmarks.hpp"
+#include "AllocationCounter.hpp"
+#include "ImagePreProcessor.hpp"
+#include "KernelVariants.hpp"
+#include "Kernels.hpp"
+#include "LaserLocator.hpp"
+#include "LineDetector.hpp"
+#include "Morphology.hpp"
+#include "Plant.hpp"
+#include "PlantDetector.hpp"
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace idl
+{
+    namespace
+    {
+        /**
+         * Structural similarity of two images of the same size, on their grayscale versions
+         * (11x11 Gaussian window of standard deviation 1.5).
+         * @param img1 the first 8-bit image
+         * @param img2 the second 8-bit image
+         * @return the mean similarity, 1 for identical images
+         */
+        double computeSSIM(const cv::Mat& img1, const cv::Mat& img2)
+        {
+            const double c1 = (0.01 * 255) * (0.01 * 255);
+            const double c2 = (0.03 * 255) * (0.03 * 255);
+
+            cv::Mat gray[2];
+            const cv::Mat* imgs[2] = {&img1, &img2};
+            for (int k = 0; k < 2; ++k)
+            {
+                cv::Mat img = imgs[k]->channels() == 3 ? ImagePreProcessor::process(*imgs[k], PreprocessingType::Grayscale) : *imgs[k];
+                img.convertTo(gray[k], CV_32F);
+            }
+
+            cv::Mat products[3] = {cv::Mat(gray[0].size(), CV_32F), cv::Mat(gray[0].size(), CV_32F), cv::Mat(gray[0].size(), CV_32F)};
+            for (int y = 0; y < gray[0].rows; ++y)
+            {
+                const float* a = gray[0].ptr<float>(y);
+                const float* b = gray[1].ptr<float>(y);
+                for (int x = 0; x < gray[0].cols; ++x)
+                {
+                    products[0].ptr<float>(y)[x] = a[x] * a[x];
+                    products[1].ptr<float>(y)[x] = b[x] * b[x];
+                    products[2].ptr<float>(y)[x] = a[x] * b[x];
+                }
+            }
+
+            cv::Mat mu[2], sigma[3];
+            for (int k = 0; k < 2; ++k)
+            {
+                cv::GaussianBlur(gray[k], mu[k], cv::Size(11, 11), 1.5);
+            }
+            for (int k = 0; k < 3; ++k)
+            {
+                cv::GaussianBlur(products[k], sigma[k], cv::Size(11, 11), 1.5);
+            }
+
+            double sum = 0.0;
+            for (int y = 0; y < gray[0].rows; ++y)
+            {
+                for (int x = 0; x < gray[0].cols; ++x)
+                {
+                    double mu1 = mu[0].ptr<float>(y)[x], mu2 = mu[1].ptr<float>(y)[x];
+                    double sigma1 = sigma[0].ptr<float>(y)[x] - mu1 * mu1;
+                    double sigma2 = sigma[1].ptr<float>(y)[x] - mu2 * mu2;
+                    double sigma12 = sigma[2].ptr<float>(y)[x] - mu1 * mu2;
+                    sum += ((2 * mu1 * mu2 + c1) * (2 * sigma12 + c2)) / ((mu1 * mu1 + mu2 * mu2 + c1) * (sigma1 + sigma2 + c2));
+                }
+            }
+            return gray[0].total() > 0 ? sum / gray[0].total() : 1.0;
+        }
+    }
+
+    void benchmarkLaserLocators(const std::string& imageDirectory)
+    {
+        std::vector<cv::String> fileNames;
+        cv::glob(imageDirectory + "/*.png", fileNames, false);
+
+        const LaserLocator locators[2] = {LaserLocator::hough, LaserLocator::projection};
+        double totalTimes[2] = {0.0, 0.0};
+        double totalError = 0.0;
+        int nbCompared = 0;
+
+        std::cout << "Image, Hough (ms), Projection (ms), Intersection error (px)" << std::endl;
+        for (const auto& fileName : fileNames)
+        {
+            cv::Mat img = cv::imread(fileName, cv::IMREAD_COLOR);
+            if (img.empty())
+            {
+                std::cerr << "Error: Could not load image " << fileName << std::endl;
+                continue;
+            }
+
+            cv::Point points[2];
+            double times[2];
+            for (int k = 0; k < 2; ++k)
+            {
+                LineDetector detector(img, locators[k]);
+                int64 start = cv::getTickCount();
+                points[k] = detector.getIntersection();
+                times[k] = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+                totalTimes[k] += times[k];
+            }
+
+            std::cout << fileName.substr(fileName.find_last_of("/") + 1) << ", " 
+                      << times[0] << ", " << times[1] << ", ";
+
+            // (-1, -1) is returned when no intersection has been found
+            if (points[0].x < 0 || points[1].x < 0)
+            {
+                std::cout << "n/a" << std::endl;
+            }
+            else
+            {
+                double error = cv::norm(points[0] - points[1]);
+                totalError += error;
+                nbCompared++;
+                std::cout << error << std::endl;
+            }
+        }
+
+        if (!fileNames.empty())
+        {
+            std::cout << "Mean, " << totalTimes[0] / fileNames.size() << ", " 
+                      << totalTimes[1] / fileNames.size() << ", "
+                      << (nbCompared > 0 ? totalError / nbCompared : 0.0) << std::endl;
+        }
+    }
+
+    int checkKernels()
+    {
+        using kernels::Isa;
+
+        cv::RNG rng(0x1d1);
+        const size_t lengths[] = {0, 1, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 1000, 1920 * 3 + 7};
+        const int thresholds[] = {-1, 0, 1, 2, 30, 128, 254, 255, 256, 400, 766};
+
+        // A full HD Lab frame for the timing
+        cv::Mat frame(1080, 1920, CV_8UC3);
+        cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(256));
+        cv::Mat mask(frame.rows, frame.cols, CV_8UC1);
+        const uint8_t laser[3] = {163, 101, 139};
+
+        int exitCode = 0;
+        std::cout << "Selected: " << kernels::isaName(kernels::getIsa()) << std::endl;
+        std::cout << "isa, cases, mismatches, time (ms)" << std::endl;
+        for (Isa isa : {Isa::scalar, Isa::sse4, Isa::avx2, Isa::avx512})
+        {
+            if (!kernels::isSupported(isa))
+            {
+                std::cout << kernels::isaName(isa) << ", unsupported" << std::endl;
+                continue;
+            }
+            auto variant = kernels::colorDistanceMaskVariant(isa);
+
+            size_t nbCases = 0, nbMismatches = 0;
+            for (size_t length : lengths)
+            {
+                for (int threshold : thresholds)
+                {
+                    // Half the pixels close to the target, so that both sides of the threshold are hit
+                    uint8_t target[3] = {static_cast<uint8_t>(rng.uniform(0, 256)), 
+                                         static_cast<uint8_t>(rng.uniform(0, 256)), 
+                                         static_cast<uint8_t>(rng.uniform(0, 256))};
+                    std::vector<uint8_t> pixels(3 * length);
+                    for (size_t i = 0; i < pixels.size(); ++i)
+                    {
+                        pixels[i] = (i / 3) % 2 ? static_cast<uint8_t>(rng.uniform(0, 256))
+                                                : cv::saturate_cast<uint8_t>(target[i % 3] + rng.uniform(-60, 61));
+                    }
+
+                    // One extra byte to catch writes past the end
+                    std::vector<uint8_t> expected(length + 1, 0x5a), actual(length + 1, 0x5a);
+                    kernels::colorDistanceMaskScalar(pixels.data(), expected.data(), length, target, threshold);
+                    variant(pixels.data(), actual.data(), length, target, threshold);
+
+                    nbCases++;
+                    nbMismatches += expected != actual ? 1 : 0;
+                }
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            for (int j = 0; j < frame.rows; ++j)
+            {
+                variant(frame.ptr<uint8_t>(j), mask.ptr<uint8_t>(j), frame.cols, laser, 30);
+            }
+            double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << kernels::isaName(isa) << ", " << nbCases << ", " << nbMismatches << ", " << time << std::endl;
+            if (nbMismatches > 0)
+            {
+                exitCode = 1;
+            }
+        }
+        return exitCode;
+    }
+
+    int benchmarkMorphology()
+    {
+        using morphology::Shape;
+
+        // Sparse pixels, as Canny edges or color masks
+        cv::Mat noise(1080, 1920, CV_8UC1), mask;
+        cv::randu(noise, cv::Scalar::all(0), cv::Scalar::all(256));
+        cv::threshold(noise, mask, 230, 255, cv::THRESH_BINARY);
+
+        const int sizes[] = {2, 3, 5, 9, 13, 16, 21, 33, 65};
+        const int nbRounds = 5;
+        int exitCode = 0;
+
+        std::cout << "Shape, Operation, Size, Iterations, OpenCV (ms), van Herk/Gil-Werman (ms), Identical" << std::endl;
+        for (Shape shape : {Shape::rect, Shape::ellipse})
+        {
+            int cvShape = Shape::rect == shape ? cv::MORPH_RECT : cv::MORPH_ELLIPSE;
+            for (int size : sizes)
+            {
+                cv::Mat element = cv::getStructuringElement(cvShape, cv::Size(size, size));
+                for (int op = 0; op < 4; ++op)
+                {
+                    // Rectangles are folded over the iterations, ellipses are not
+                    int iterations = (op >= 2) ? 2 : 1;
+                    const char* names[4] = {"dilate", "erode", "open", "close"};
+                    cv::Mat expected, actual;
+
+                    int64 start = cv::getTickCount();
+                    for (int r = 0; r < nbRounds; ++r)
+                    {
+                        switch (op)
+                        {
+                            case 0: cv::dilate(mask, expected, element); break;
+                            case 1: cv::erode(mask, expected, element); break;
+                            case 2: cv::morphologyEx(mask, expected, cv::MORPH_OPEN, element, cv::Point(-1, -1), iterations); break;
+                            default: cv::morphologyEx(mask, expected, cv::MORPH_CLOSE, element, cv::Point(-1, -1), iterations); break;
+                        }
+                    }
+                    double timeOpenCV = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() / nbRounds;
+
+                    start = cv::getTickCount();
+                    for (int r = 0; r < nbRounds; ++r)
+                    {
+                        switch (op)
+                        {
+                            case 0: morphology::dilate(mask, actual, shape, element.size()); break;
+                            case 1: morphology::erode(mask, actual, shape, element.size()); break;
+                            case 2: morphology::open(mask, actual, shape, element.size(), iterations); break;
+                            default: morphology::close(mask, actual, shape, element.size(), iterations); break;
+                        }
+                    }
+                    double timeFast = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() / nbRounds;
+
+                    bool isIdentical = 0.0 == cv::norm(expected, actual, cv::NORM_INF);
+                    exitCode = isIdentical ? exitCode : 1;
+                    std::cout << (Shape::rect == shape ? "rect" : "ellipse") << ", " << names[op] << ", " << size << ", " 
+                              << iterations << ", " << timeOpenCV << ", " << timeFast << ", " << (isIdentical ? "yes" : "NO") << std::endl;
+                }
+            }
+        }
+        return exitCode;
+    }
+
+    void benchmarkPyramid(const std::string& imageDirectory)
+    {
+        std::vector<cv::String> fileNames;
+        cv::glob(imageDirectory + "/*.png", fileNames, false);
+
+        const int downscales[3] = {1, 2, 4};
+        double totalTimes[3] = {0.0, 0.0, 0.0};
+        double totalRecall[3] = {0.0, 0.0, 0.0};
+
+        std::cout << "Image, Downscale, Time (ms), Plants, Recall, Mean IoU, Same species" << std::endl;
+        for (const auto& fileName : fileNames)
+        {
+            cv::Mat img = cv::imread(fileName, cv::IMREAD_COLOR);
+            if (img.empty())
+            {
+                std::cerr << "Error: Could not load image " << fileName << std::endl;
+                continue;
+            }
+
+            std::vector<Plant> reference;
+            for (int k = 0; k < 3; ++k)
+            {
+                int64 start = cv::getTickCount();
+                auto plants = PlantDetector::detectPlants(img, cv::Rect(0, 0, img.cols, img.rows), downscales[k]);
+                double time = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+                totalTimes[k] += time;
+
+                if (k == 0)
+                {
+                    reference = plants;
+                }
+
+                // Match every reference plant with its best overlapping plant
+                int nbMatched = 0, nbSameSpecies = 0;
+                double sumIoU = 0.0;
+                for (const auto& ref : reference)
+                {
+                    double bestIoU = 0.0;
+                    const Plant* best = nullptr;
+                    for (const auto& plant : plants)
+                    {
+                        double inter = (ref.boundingBox & plant.boundingBox).area();
+                        double iou = inter / (ref.boundingBox.area() + plant.boundingBox.area() - inter);
+                        if (iou > bestIoU)
+                        {
+                            bestIoU = iou;
+                            best = &plant;
+                        }
+                    }
+
+                    if (best && bestIoU >= 0.5)
+                    {
+                        nbMatched++;
+                        sumIoU += bestIoU;
+                        nbSameSpecies += (best->plantSpecies == ref.plantSpecies) ? 1 : 0;
+                    }
+                }
+
+                double recall = reference.empty() ? 1.0 : static_cast<double>(nbMatched) / reference.size();
+                totalRecall[k] += recall;
+
+                std::cout << fileName.substr(fileName.find_last_of("/") + 1) << ", " << downscales[k] << ", "
+                          << time << ", " << plants.size() << ", " << recall << ", "
+                          << (nbMatched > 0 ? sumIoU / nbMatched : 0.0) << ", "
+                          << nbSameSpecies << "/" << nbMatched << std::endl;
+            }
+        }
+
+        if (!fileNames.empty())
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                std::cout << "Mean, " << downscales[k] << ", " << totalTimes[k] / fileNames.size() << ", , "
+                          << totalRecall[k] / fileNames.size() << ", speedup x" 
+                          << (totalTimes[k] > 0 ? totalTimes[0] / totalTimes[k] : 0.0) << std::endl;
+            }
+        }
+    }
+
+    void benchmarkPreprocessing(const std::string& imageDirectory, const PreprocessingPipeline& reference)
+    {
+        std::vector<cv::String> fileNames;
+        cv::glob(imageDirectory + "/*.png", fileNames, false);
+
+        // Copy holding its own buffers, warmed by the first image
+        PreprocessingPipeline pipeline = reference;
+        double totalSteps = 0.0, totalFused = 0.0;
+        int nbImages = 0;
+
+        std::cout << "Image, Passes, Step by step (ms), Fused (ms), Max difference" << std::endl;
+        for (const auto& fileName : fileNames)
+        {
+            cv::Mat img = cv::imread(fileName, cv::IMREAD_COLOR);
+            if (img.empty())
+            {
+                std::cerr << "Error: Could not load image " << fileName << std::endl;
+                continue;
+            }
+
+            int64 start = cv::getTickCount();
+            cv::Mat stepByStep = pipeline.applyStepByStep(img);
+            double timeSteps = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+
+            cv::Mat fused;
+            start = cv::getTickCount();
+            pipeline.apply(img, fused);
+            double timeFused = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+
+            double difference = (stepByStep.size() == fused.size() && stepByStep.type() == fused.type()) 
+                ? cv::norm(stepByStep, fused, cv::NORM_INF) : -1.0;
+            totalSteps += timeSteps;
+            totalFused += timeFused;
+            nbImages++;
+
+            std::cout << fileName.substr(fileName.find_last_of("/") + 1) << ", " << pipeline.describe(img.channels()) << ", "
+                      << timeSteps << ", " << timeFused << ", " << difference << std::endl;
+        }
+
+        if (nbImages > 0)
+        {
+            std::cout << "Mean, , " << totalSteps / nbImages << ", " << totalFused / nbImages << ", speedup x" 
+                      << (totalFused > 0 ? totalSteps / totalFused : 0.0) << std::endl;
+        }
+    }
+
+    int benchmarkAllocations(const std::string& imageDirectory)
+    {
+        if (!allocations::isCounted())
+        {
+            std::cerr << "Error: Allocations are not counted in this build (cmake -DIDL_COUNT_ALLOCATIONS=ON)" << std::endl;
+            return -1;
+        }
+
+        std::vector<cv::String> fileNames;
+        cv::glob(imageDirectory + "/*.png", fileNames, false);
+
+        const int nbWarmups = 2, nbRounds = 5;
+        double totalPerFrame = 0.0, totalPlants = 0.0;
+        int nbImages = 0;
+
+        std::cout << "Image, Plants, Allocations per frame, Allocations per plant" << std::endl;
+        for (const auto& fileName : fileNames)
+        {
+            cv::Mat img = cv::imread(fileName, cv::IMREAD_COLOR);
+            if (img.empty())
+            {
+                std::cerr << "Error: Could not load image " << fileName << std::endl;
+                continue;
+            }
+            cv::Rect area(0, 0, img.cols, img.rows);
+
+            size_t nbPlants = 0;
+            for (int r = 0; r < nbWarmups; ++r)
+            {
+                nbPlants = PlantDetector::detectPlants(img, area, 1).size();
+            }
+
+            uint64_t start = allocations::count();
+            for (int r = 0; r < nbRounds; ++r)
+            {
+                PlantDetector::detectPlants(img, area, 1);
+            }
+            double perFrame = static_cast<double>(allocations::count() - start) / nbRounds;
+            totalPerFrame += perFrame;
+            totalPlants += nbPlants;
+            nbImages++;
+
+            std::cout << fileName.substr(fileName.find_last_of("/") + 1) << ", " << nbPlants << ", " << perFrame << ", " 
+                      << (nbPlants > 0 ? perFrame / nbPlants : 0.0) << std::endl;
+        }
+
+        if (nbImages > 0)
+        {
+            std::cout << "Mean, " << totalPlants / nbImages << ", " << totalPerFrame / nbImages << ", " 
+                      << (totalPlants > 0 ? totalPerFrame / totalPlants : 0.0) << std::endl;
+        }
+        return 0;
+    }
+
+    void benchmarkDenoise(const std::string& imageDirectory)
+    {
+        std::vector<cv::String> fileNames;
+        cv::glob(imageDirectory + "/*.png", fileNames, false);
+
+        double totals[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        int nbImages = 0;
+
+        std::cout << "Image, NL-means (ms), Fast (ms), Fast PSNR (dB), Fast SSIM, Input PSNR (dB), Input SSIM" << std::endl;
+        for (const auto& fileName : fileNames)
+        {
+            cv::Mat img = cv::imread(fileName, cv::IMREAD_COLOR);
+            if (img.empty())
+            {
+                std::cerr << "Error: Could not load image " << fileName << std::endl;
+                continue;
+            }
+
+            int64 start = cv::getTickCount();
+            cv::Mat reference = ImagePreProcessor::process(img, PreprocessingType::NoiseCorrection);
+            double timeReference = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+
+            start = cv::getTickCount();
+            cv::Mat fast = ImagePreProcessor::process(img, PreprocessingType::FastNoiseCorrection);
+            double timeFast = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+
+            double values[6] = {timeReference, timeFast, cv::PSNR(fast, reference), computeSSIM(fast, reference), 
+                                cv::PSNR(img, reference), computeSSIM(img, reference)};
+            std::cout << fileName.substr(fileName.find_last_of("/") + 1);
+            for (int k = 0; k < 6; ++k)
+            {
+                totals[k] += values[k];
+                std::cout << ", " << values[k];
+            }
+            std::cout << std::endl;
+            nbImages++;
+        }
+
+        if (nbImages > 0)
+        {
+            std::cout << "Mean";
+            for (int k = 0; k < 6; ++k)
+            {
+                std::cout << ", " << totals[k] / nbImages;
+            }
+            std::cout << ", speedup x" << (totals[1] > 0 ? totals[0] / totals[1] : 0.0) << std::endl;
+        }
+    }
+}
@@ -0,0 +1,127 @@
+#include "DirectoryWatcher.hpp"
+#include <cerrno>
+#include <iostream>
+#ifdef __linux__
+// POSIX / Linux
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace idl
+{
+    DirectoryWatcher::~DirectoryWatcher()
+    {
+#ifdef __linux__
+        if (_fd >= 0)
+        {
+            close(_fd);
+        }
+#endif
+    }
+
+#ifdef __linux__
+    bool DirectoryWatcher::open(const std::string& iDirectory, const std::string& iExtension)
+    {
+        _directory = iDirectory;
+        _extension = iExtension;
+
+        _fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (_fd < 0)
+        {
+            std::cerr << "Error: Unable to create the inotify instance" << std::endl;
+            return false;
+        }
+
+        // Completed files only: closed after writing, or moved in once complete
+        if (inotify_add_watch(_fd, iDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+        {
+            std::cerr << "Error: Unable to watch the directory " << iDirectory << std::endl;
+            close(_fd);
+            _fd = -1;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool DirectoryWatcher::wait(std::vector<File>& oFiles, int iTimeoutMs)
+    {
+        if (_fd < 0)
+        {
+            return false;
+        }
+
+        struct pollfd pfd = {_fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, iTimeoutMs);
+        if (ready < 0)
+        {
+            // Interrupted by a signal: not an error, the caller checks its stop condition
+            return EINTR == errno;
+        }
+        if (0 == ready)
+        {
+            return true;
+        }
+
+        alignas(struct inotify_event) char buffer[4096];
+        while (true)
+        {
+            ssize_t length = read(_fd, buffer, sizeof(buffer));
+            if (length <= 0)
+            {
+                // EAGAIN: every pending event has been read
+                return length == 0 || EAGAIN == errno || EWOULDBLOCK == errno;
+            }
+
+            for (char* ptr = buffer; ptr < buffer + length; )
+            {
+                const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(ptr);
+                ptr += sizeof(struct inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW)
+                {
+                    std::cerr << "Warning: inotify queue overflow, files may have been missed" << std::endl;
+                    continue;
+                }
+                if (0 == event->len || (event->mask & IN_ISDIR))
+                {
+                    continue;
+                }
+
+                std::string name = event->name;
+                if (name.size() <= _extension.size() 
+                    || 0 != name.compare(name.size() - _extension.size(), _extension.size(), _extension))
+                {
+                    continue;
+                }
+
+                File file;
+                file.path = _directory + "/" + name;
+                file.completed = std::chrono::system_clock::now();
+
+                struct stat status;
+                if (0 == stat(file.path.c_str(), &status))
+                {
+                    file.completed = std::chrono::system_clock::time_point(
+                        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                            std::chrono::seconds(status.st_mtim.tv_sec) + std::chrono::nanoseconds(status.st_mtim.tv_nsec)));
+                }
+                oFiles.push_back(std::move(file));
+            }
+        }
+    }
+#else
+    bool DirectoryWatcher::open(const std::string& iDirectory, const std::string& iExtension)
+    {
+        std::cerr << "Error: The watch mode relies on inotify and is only available on Linux" << std::endl;
+        return false;
+    }
+
+    bool DirectoryWatcher::wait(std::vector<File>& oFiles, int iTimeoutMs)
+    {
+        return false;
+    }
+#endif
+}
@@ -0,0 +1,212 @@
+#include "FrameArchive.hpp"
+#include "ImageDecoder.hpp"
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace idl
+{
+    namespace
+    {
+        const char     archiveMagic[8] = {'I', 'D', 'L', 'F', 'R', 'A', 'M', 'E'};
+        const uint32_t archiveVersion  = 1;
+        const uint64_t frameAlignment  = 64;   // bytes, keeps the rows suitably aligned for vectorized reads
+
+        uint64_t alignOffset(uint64_t offset)
+        {
+            return (offset + frameAlignment - 1) / frameAlignment * frameAlignment;
+        }
+    }
+
+    FrameArchive::~FrameArchive()
+    {
+        close();
+    }
+
+    bool FrameArchive::isArchive(const std::string& iPath)
+    {
+        const std::string ext = extension;
+        return iPath.size() > ext.size() && 0 == iPath.compare(iPath.size() - ext.size(), ext.size(), ext);
+    }
+
+    int FrameArchive::convert(const std::string& iImgDirectory, const std::string& iArchivePath, int iReduction)
+    {
+        std::vector<cv::String> fileNames;
+        cv::glob(iImgDirectory + "/*.png", fileNames, false);
+
+        std::ofstream file(iArchivePath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cerr << "Error: Unable to create the archive " << iArchivePath << std::endl;
+            return -1;
+        }
+
+        // The index is written once every frame size is known
+        std::vector<FrameEntry> index;
+        index.reserve(fileNames.size());
+        uint64_t offset = alignOffset(sizeof(Header) + fileNames.size() * sizeof(FrameEntry));
+        file.seekp(static_cast<std::streamoff>(offset));
+
+        ImageDecoder decoder(std::move(fileNames), iReduction, 2);
+        cv::Mat img;
+        cv::String fileName;
+        while (decoder.next(img, fileName))
+        {
+            if (img.empty())
+            {
+                std::cerr << "Error: Could not load image " << fileName << std::endl;
+                continue;
+            }
+
+            FrameEntry entry = {};
+            std::string name = fileName.substr(fileName.find_last_of("/") + 1);
+            std::strncpy(entry.name, name.c_str(), sizeof(entry.name) - 1);
+            entry.rows   = static_cast<uint32_t>(img.rows);
+            entry.cols   = static_cast<uint32_t>(img.cols);
+            entry.type   = static_cast<uint32_t>(img.type());
+            entry.step   = static_cast<uint32_t>(img.cols * img.elemSize());
+            entry.offset = offset;
+
+            for (int y = 0; y < img.rows; y++)
+            {
+                file.write(reinterpret_cast<const char*>(img.ptr(y)), entry.step);
+            }
+
+            offset = alignOffset(offset + static_cast<uint64_t>(entry.step) * entry.rows);
+            file.seekp(static_cast<std::streamoff>(offset));
+            index.push_back(entry);
+        }
+
+        Header header = {};
+        std::memcpy(header.magic, archiveMagic, sizeof(archiveMagic));
+        header.version   = archiveVersion;
+        header.nbFrames  = static_cast<uint32_t>(index.size());
+        header.reduction = static_cast<uint32_t>(decoder.getReduction());
+
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(FrameEntry));
+
+        // Pad the last frame up to its alignment
+        file.seekp(static_cast<std::streamoff>(offset - 1));
+        file.put('\0');
+
+        if (!file.good())
+        {
+            std::cerr << "Error: Failed to write the archive " << iArchivePath << std::endl;
+            return -1;
+        }
+
+        return static_cast<int>(index.size());
+    }
+
+    bool FrameArchive::open(const std::string& iArchivePath)
+    {
+        close();
+
+        int fd = ::open(iArchivePath.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            std::cerr << "Error: Could not open the archive " << iArchivePath << std::endl;
+            return false;
+        }
+
+        struct stat status;
+        if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(Header))
+        {
+            std::cerr << "Error: Invalid archive " << iArchivePath << std::endl;
+            ::close(fd);
+            return false;
+        }
+
+        // Private writable mapping: the pages are shared with the page cache until written
+        _length = static_cast<size_t>(status.st_size);
+        _data = mmap(nullptr, _length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+
+        if (MAP_FAILED == _data)
+        {
+            std::cerr << "Error: Could not map the archive " << iArchivePath << std::endl;
+            _data = nullptr;
+            _length = 0;
+            return false;
+        }
+        madvise(_data, _length, MADV_SEQUENTIAL);
+
+        // Check the header, the index bounds and the frames, the detectors expect BGR frames 
+        // decoded with one of the supported reductions
+        const Header* header = static_cast<const Header*>(_data);
+        uint32_t reduction = header->reduction;
+        bool isValid = 0 == std::memcmp(header->magic, archiveMagic, sizeof(archiveMagic))
+                    && archiveVersion == header->version
+                    && (1 == reduction || 2 == reduction || 4 == reduction || 8 == reduction)
+                    && static_cast<uint64_t>(header->nbFrames) * sizeof(FrameEntry) <= _length - sizeof(Header);
+
+        _index = reinterpret_cast<const FrameEntry*>(header + 1);
+        for (uint32_t i = 0; isValid && i < header->nbFrames; i++)
+        {
+            // Written without overflow: the offset and the size are bounded separately
+            const FrameEntry& entry = _index[i];
+            uint64_t size = static_cast<uint64_t>(entry.step) * entry.rows;
+            isValid = CV_8UC3 == entry.type
+                   && entry.rows <= static_cast<uint32_t>(INT_MAX) && entry.cols <= static_cast<uint32_t>(INT_MAX)
+                   && entry.step >= static_cast<uint64_t>(entry.cols) * CV_ELEM_SIZE(CV_8UC3)
+                   && entry.offset <= _length && size <= _length - entry.offset;
+        }
+
+        if (!isValid)
+        {
+            std::cerr << "Error: Invalid archive " << iArchivePath << std::endl;
+            close();
+            return false;
+        }
+
+        _nbFrames  = header->nbFrames;
+        _reduction = static_cast<int>(header->reduction);
+        return true;
+    }
+
+    void FrameArchive::close()
+    {
+        if (_data)
+        {
+            munmap(_data, _length);
+        }
+        _data = nullptr;
+        _length = 0;
+        _nbFrames = 0;
+        _reduction = 1;
+        _index = nullptr;
+    }
+
+    cv::Mat FrameArchive::getFrame(size_t iIndex) const
+    {
+        if (iIndex >= _nbFrames)
+        {
+            return cv::Mat();
+        }
+
+        const FrameEntry& entry = _index[iIndex];
+        uchar* pixels = static_cast<uchar*>(_data) + entry.offset;
+        return cv::Mat(static_cast<int>(entry.rows), static_cast<int>(entry.cols), static_cast<int>(entry.type), 
+                       pixels, entry.step);
+    }
+
+    std::string FrameArchive::getName(size_t iIndex) const
+    {
+        if (iIndex >= _nbFrames)
+        {
+            return std::string();
+        }
+
+        const FrameEntry& entry = _index[iIndex];
+        return std::string(entry.name, strnlen(entry.name, sizeof(entry.name)));
+    }
+}
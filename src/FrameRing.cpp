@@ -0,0 +1,280 @@
+#include "FrameRing.hpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <new>
+// POSIX
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace idl
+{
+    namespace
+    {
+        const uint32_t ringMagic   = 0x474e4952; // "RING"
+        const uint32_t ringVersion = 2;
+        const size_t   cacheLine   = 64;
+
+        size_t alignSize(size_t size)
+        {
+            return (size + cacheLine - 1) / cacheLine * cacheLine;
+        }
+    }
+
+    /**
+     * Start of the shared memory object. Each index lives on its own cache line, 
+     * so that the producer and the consumer never write the same line.
+     */
+    struct FrameRing::Header
+    {
+        std::atomic<uint32_t> magic;                    //< written last by the producer, the header is then complete
+        uint32_t version;
+        int32_t producer;                               //< process id of the producer
+        uint32_t nbSlots;
+        uint32_t maxRows;
+        uint32_t maxCols;
+        uint32_t step;                                  //< bytes per row of a slot
+        uint64_t slotSize;                              //< bytes per slot, header included
+        alignas(64) std::atomic<uint64_t> head;         //< frames published, written by the producer
+        alignas(64) std::atomic<uint64_t> tail;         //< frames released, written by the consumer
+        alignas(64) std::atomic<uint64_t> dropped;      //< frames dropped, written by the producer
+        std::atomic<uint32_t> closed;                   //< producer finished
+    };
+
+    /**
+     * Description of a frame, followed by its pixels.
+     */
+    struct FrameRing::Slot
+    {
+        uint64_t sequence;
+        int64_t timestamp;
+        uint32_t rows;
+        uint32_t cols;
+        char name[48];
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free, 
+                  "the ring atomics must be lock-free to be shared");
+
+    FrameRing::~FrameRing()
+    {
+        if (_data)
+        {
+            munmap(_data, _length);
+        }
+        if (_isOwner)
+        {
+            shm_unlink(_name.c_str());
+        }
+    }
+
+    FrameRing::Slot* FrameRing::slot(uint64_t iIndex) const
+    {
+        size_t offset = alignSize(sizeof(Header)) + (iIndex % _header->nbSlots) * _header->slotSize;
+        return reinterpret_cast<Slot*>(static_cast<char*>(_data) + offset);
+    }
+
+    bool FrameRing::create(const std::string& iName, uint32_t iNbSlots, const cv::Size& iMaxSize)
+    {
+        size_t step = alignSize(static_cast<size_t>(iMaxSize.width) * 3);
+        size_t slotSize = alignSize(sizeof(Slot)) + step * iMaxSize.height;
+        _length = alignSize(sizeof(Header)) + slotSize * iNbSlots;
+
+        // A ring in use is never replaced, only the one left by a producer that has ended
+        int fd = shm_open(iName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0 && EEXIST == errno && isStale(iName))
+        {
+            std::cerr << "Warning: Replacing the frame ring " << iName << " left by an ended producer" << std::endl;
+            shm_unlink(iName.c_str());
+            fd = shm_open(iName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        }
+        else if (fd < 0 && EEXIST == errno)
+        {
+            std::cerr << "Error: The frame ring " << iName << " already exists and may be in use, " 
+                      << "remove /dev/shm" << iName << " if it is not" << std::endl;
+            return false;
+        }
+        if (fd < 0 || ftruncate(fd, static_cast<off_t>(_length)) != 0)
+        {
+            std::cerr << "Error: Unable to create the frame ring " << iName << std::endl;
+            if (fd >= 0)
+            {
+                ::close(fd);
+                shm_unlink(iName.c_str());
+            }
+            return false;
+        }
+
+        _data = mmap(nullptr, _length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (MAP_FAILED == _data)
+        {
+            std::cerr << "Error: Unable to map the frame ring " << iName << std::endl;
+            _data = nullptr;
+            shm_unlink(iName.c_str());
+            return false;
+        }
+        _name = iName;
+        _isOwner = true;
+
+        // The object is zero-filled: the atomics start at 0, the magic is published last
+        _header = new (_data) Header;
+        _header->version  = ringVersion;
+        _header->producer = static_cast<int32_t>(getpid());
+        _header->nbSlots  = iNbSlots;
+        _header->maxRows  = static_cast<uint32_t>(iMaxSize.height);
+        _header->maxCols  = static_cast<uint32_t>(iMaxSize.width);
+        _header->step     = static_cast<uint32_t>(step);
+        _header->slotSize = slotSize;
+        _header->head.store(0, std::memory_order_relaxed);
+        _header->tail.store(0, std::memory_order_relaxed);
+        _header->dropped.store(0, std::memory_order_relaxed);
+        _header->closed.store(0, std::memory_order_relaxed);
+        _header->magic.store(ringMagic, std::memory_order_release);
+
+        return true;
+    }
+
+    bool FrameRing::open(const std::string& iName)
+    {
+        int fd = shm_open(iName.c_str(), O_RDWR, 0);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat status;
+        if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(Header))
+        {
+            ::close(fd);
+            return false;
+        }
+
+        _length = static_cast<size_t>(status.st_size);
+        _data = mmap(nullptr, _length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (MAP_FAILED == _data)
+        {
+            _data = nullptr;
+            return false;
+        }
+
+        _header = static_cast<Header*>(_data);
+        bool isValid = ringMagic == _header->magic.load(std::memory_order_acquire) && ringVersion == _header->version && _header->nbSlots > 0
+                    && alignSize(sizeof(Header)) + _header->slotSize * _header->nbSlots <= _length;
+        if (!isValid)
+        {
+            munmap(_data, _length);
+            _data = nullptr;
+            _header = nullptr;
+            return false;
+        }
+
+        _name = iName;
+        return true;
+    }
+
+    bool FrameRing::isStale(const std::string& iName)
+    {
+        int fd = shm_open(iName.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat status;
+        void* data = MAP_FAILED;
+        if (0 == fstat(fd, &status) && static_cast<size_t>(status.st_size) >= sizeof(Header))
+        {
+            data = mmap(nullptr, sizeof(Header), PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (MAP_FAILED == data)
+        {
+            return false;
+        }
+
+        // A ring of another version or being created is left alone, the producer must not exist anymore
+        const Header* header = static_cast<const Header*>(data);
+        bool isStale = ringMagic == header->magic.load(std::memory_order_acquire) && ringVersion == header->version
+                    && header->producer > 0 && kill(static_cast<pid_t>(header->producer), 0) != 0 && ESRCH == errno;
+        munmap(data, sizeof(Header));
+        return isStale;
+    }
+
+    bool FrameRing::push(const cv::Mat& iFrame, const std::string& iName)
+    {
+        uint64_t head = _header->head.load(std::memory_order_relaxed);
+        uint64_t tail = _header->tail.load(std::memory_order_acquire);
+
+        // The producer never waits for the consumer
+        if (head - tail >= _header->nbSlots || CV_8UC3 != iFrame.type()
+            || static_cast<uint32_t>(iFrame.rows) > _header->maxRows 
+            || static_cast<uint32_t>(iFrame.cols) > _header->maxCols)
+        {
+            _header->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        Slot* target = slot(head);
+        target->sequence  = head + _header->dropped.load(std::memory_order_relaxed);
+        target->timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::system_clock::now().time_since_epoch()).count();
+        target->rows = static_cast<uint32_t>(iFrame.rows);
+        target->cols = static_cast<uint32_t>(iFrame.cols);
+        std::strncpy(target->name, iName.c_str(), sizeof(target->name) - 1);
+        target->name[sizeof(target->name) - 1] = '\0';
+
+        cv::Mat pixels(iFrame.rows, iFrame.cols, CV_8UC3, 
+                       reinterpret_cast<char*>(target) + alignSize(sizeof(Slot)), _header->step);
+        iFrame.copyTo(pixels);
+
+        // Publish the slot content with the index
+        _header->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    void FrameRing::close()
+    {
+        _header->closed.store(1, std::memory_order_release);
+    }
+
+    bool FrameRing::peek(Frame& oFrame) const
+    {
+        uint64_t tail = _header->tail.load(std::memory_order_relaxed);
+        uint64_t head = _header->head.load(std::memory_order_acquire);
+        if (tail == head)
+        {
+            return false;
+        }
+
+        Slot* source = slot(tail);
+        oFrame.image = cv::Mat(static_cast<int>(source->rows), static_cast<int>(source->cols), CV_8UC3, 
+                               reinterpret_cast<char*>(source) + alignSize(sizeof(Slot)), _header->step);
+        oFrame.name = std::string(source->name, strnlen(source->name, sizeof(source->name)));
+        oFrame.sequence = source->sequence;
+        oFrame.timestamp = source->timestamp;
+        return true;
+    }
+
+    void FrameRing::release()
+    {
+        uint64_t tail = _header->tail.load(std::memory_order_relaxed);
+        _header->tail.store(tail + 1, std::memory_order_release);
+    }
+
+    bool FrameRing::isFinished() const
+    {
+        return 0 != _header->closed.load(std::memory_order_acquire)
+            && _header->tail.load(std::memory_order_relaxed) == _header->head.load(std::memory_order_acquire);
+    }
+
+    uint64_t FrameRing::getNbDropped() const
+    {
+        return _header->dropped.load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,188 @@
+#include "FrameStream.hpp"
+#include "Metrics.hpp"
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+
+namespace idl
+{
+    FrameStream::FrameStream(DropPolicy iPolicy, int iEveryN):
+        _policy(iPolicy), _everyN(std::max(1, iEveryN))
+    {
+    }
+
+    FrameStream::~FrameStream()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _isStopped = true;
+        }
+        if (_thread.joinable())
+        {
+            _thread.join();
+        }
+    }
+
+    bool FrameStream::open(const std::string& iSource, double iFps)
+    {
+        bool isIndex = !iSource.empty() && std::all_of(iSource.begin(), iSource.end(), 
+                                                       [](char c) { return std::isdigit(static_cast<unsigned char>(c)); });
+        if (isIndex)
+        {
+            _capture.open(std::stoi(iSource));
+        }
+        else if (0 == iSource.compare(0, 10, "/dev/video"))
+        {
+            _capture.open(iSource, cv::CAP_V4L2);
+        }
+        else
+        {
+            _capture.open(iSource);
+            _isFile = true;
+        }
+
+        if (!_capture.isOpened())
+        {
+            std::cerr << "Error: Could not open the video source " << iSource << std::endl;
+            return false;
+        }
+
+        // A camera keeps the smallest buffer possible: stale frames only add latency
+        if (!_isFile)
+        {
+            _capture.set(cv::CAP_PROP_BUFFERSIZE, 1);
+        }
+
+        _fps = iFps > 0.0 ? iFps : _capture.get(cv::CAP_PROP_FPS);
+        if (_fps <= 0.0)
+        {
+            _fps = 30.0;
+        }
+        _period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / _fps));
+        _nextFrame = Clock::now();
+
+        if (DropPolicy::latestWins == _policy)
+        {
+            _thread = std::thread(&FrameStream::capture, this);
+        }
+        return true;
+    }
+
+    bool FrameStream::waitFrame()
+    {
+        if (!_isFile)
+        {
+            // A camera delivers the frames at its own rate
+            return true;
+        }
+
+        // A camera would have delivered the frames due meanwhile, and lost them
+        while (Clock::now() >= _nextFrame + _period)
+        {
+            if (!_capture.grab())
+            {
+                return false;
+            }
+            _nextFrame += _period;
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            _nbCaptured++;
+            _nbDropped++;
+            Metrics::addDropped();
+        }
+
+        std::this_thread::sleep_until(_nextFrame);
+        _nextFrame += _period;
+        return true;
+    }
+
+    bool FrameStream::read(cv::Mat& oFrame)
+    {
+        return waitFrame() && _capture.read(oFrame) && !oFrame.empty();
+    }
+
+    void FrameStream::capture()
+    {
+        cv::Mat frame;
+        while (true)
+        {
+            bool isRead = read(frame);
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_isStopped || !isRead)
+            {
+                _isFinished = true;
+                _condition.notify_one();
+                return;
+            }
+
+            // An unprocessed frame is replaced by the newer one
+            if (_hasLatest)
+            {
+                _nbDropped++;
+                Metrics::addDropped();
+            }
+            std::swap(_latest, frame);
+            _latestCaptured = Clock::now();
+            _latestIndex = _nbCaptured++;
+            _hasLatest = true;
+            _condition.notify_one();
+        }
+    }
+
+    bool FrameStream::next(cv::Mat& oFrame, Clock::time_point& oCaptured, uint64_t& oIndex)
+    {
+        if (DropPolicy::latestWins == _policy)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this]() { return _hasLatest || _isFinished; });
+            if (!_hasLatest)
+            {
+                return false;
+            }
+
+            // Hand the frame over, the capture thread then decodes into a new buffer
+            oFrame = _latest;
+            _latest = cv::Mat();
+            oCaptured = _latestCaptured;
+            oIndex = _latestIndex;
+            _hasLatest = false;
+            return true;
+        }
+
+        // everyNth: skip the frames without decoding them
+        for (int i = 1; i < _everyN; ++i)
+        {
+            if (!waitFrame() || !_capture.grab())
+            {
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(_mutex);
+            _nbCaptured++;
+            _nbDropped++;
+            Metrics::addDropped();
+        }
+
+        if (!read(oFrame))
+        {
+            return false;
+        }
+        oCaptured = Clock::now();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        oIndex = _nbCaptured++;
+        return true;
+    }
+
+    uint64_t FrameStream::getNbCaptured() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _nbCaptured;
+    }
+
+    uint64_t FrameStream::getNbDropped() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _nbDropped;
+    }
+}
@@ -0,0 +1,83 @@
+#include "ImageDecoder.hpp"
+#include "Metrics.hpp"
+#include "PerfCounters.hpp"
+
+namespace idl
+{
+    ImageDecoder::ImageDecoder(std::vector<cv::String> iFileNames, int iReduction, int iNbThreads):
+        _fileNames(std::move(iFileNames)), _reduction(iReduction), _flags(readFlags(iReduction)), 
+        _nbThreads(iNbThreads)
+    {
+        if (cv::IMREAD_COLOR == _flags)
+        {
+            _reduction = 1;
+        }
+        prefetch();
+    }
+
+    ImageDecoder::~ImageDecoder()
+    {
+        for (auto& pending : _pending)
+        {
+            pending.wait();
+        }
+    }
+
+    int ImageDecoder::readFlags(int iReduction)
+    {
+        switch (iReduction)
+        {
+            case 2:
+                return cv::IMREAD_REDUCED_COLOR_2;
+            case 4:
+                return cv::IMREAD_REDUCED_COLOR_4;
+            case 8:
+                return cv::IMREAD_REDUCED_COLOR_8;
+            default:
+                return cv::IMREAD_COLOR;
+        }
+    }
+
+    void ImageDecoder::prefetch()
+    {
+        while (_pending.size() < static_cast<size_t>(_nbThreads) && _nextRequested < _fileNames.size())
+        {
+            const cv::String& fileName = _fileNames[_nextRequested++];
+            int flags = _flags;
+            _pending.push_back(std::async(std::launch::async, [&fileName, flags]() 
+            { 
+                return cv::imread(fileName, flags); 
+            }));
+        }
+    }
+
+    bool ImageDecoder::next(cv::Mat& oImage, cv::String& oFileName)
+    {
+        if (_nextReturned >= _fileNames.size())
+        {
+            return false;
+        }
+        oFileName = _fileNames[_nextReturned++];
+
+        // Measured on the calling thread, attributed to the frame: with workers, the wait for an image 
+        // is the part of its decoding not hidden by the processing of the previous ones
+        PerfCounters::FrameScope frame(oFileName.substr(oFileName.find_last_of('/') + 1));
+        PerfCounters::Scope scope("decode");
+        Metrics::StageTimer timer(Metrics::Stage::decode);
+
+        if (_pending.empty())
+        {
+            // Sequential decoding
+            _nextRequested = _nextReturned;
+            oImage = cv::imread(oFileName, _flags);
+            return true;
+        }
+
+        oImage = _pending.front().get();
+        _pending.pop_front();
+
+        // Keep the workers busy while the image is processed
+        prefetch();
+        return true;
+    }
+}
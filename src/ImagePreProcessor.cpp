@@ -1,4 +1,6 @@
 #include <ImagePreProcessor.hpp>
+#include <PreprocessingPipeline.hpp>
+#include <algorithm>
 
 namespace idl
 {
@@ -92,6 +94,75 @@ namespace idl
         return output;
     }
 
+    cv::Mat ImagePreProcessor::applyFastNoiseCorrection(const cv::Mat& img, int radius, double eps, int subsample) {
+        if (img.empty() || img.depth() != CV_8U || radius < 1) {
+            std::cerr << "Error : applyFastNoiseCorrection needs an 8-bit image" << std::endl;
+            return img;
+        }
+
+        int channels = img.channels();
+        subsample = std::max(1, std::min(subsample, radius));
+        int smallRadius = std::max(1, radius / subsample);
+        cv::Size smallSize((img.cols + subsample - 1) / subsample, (img.rows + subsample - 1) / subsample);
+        cv::Size window(2 * smallRadius + 1, 2 * smallRadius + 1);
+
+        // Window means of the reduced image and of its square, intensities in [0, 1]
+        cv::Mat small, meanI, meanII, squared;
+        cv::resize(img, small, smallSize, 0, 0, cv::INTER_AREA);
+        small.convertTo(small, CV_32FC(channels), 1.0 / 255.0);
+        squared.create(small.size(), small.type());
+        int smallWidth = small.cols * channels;
+        cv::parallel_for_(cv::Range(0, small.rows), [&](const cv::Range& rows) {
+            for (int y = rows.start; y < rows.end; ++y) {
+                const float* in = small.ptr<float>(y);
+                float* out = squared.ptr<float>(y);
+                for (int x = 0; x < smallWidth; ++x) {
+                    out[x] = in[x] * in[x];
+                }
+            }
+        });
+        cv::boxFilter(small, meanI, CV_32F, window);
+        cv::boxFilter(squared, meanII, CV_32F, window);
+
+        // Linear model q = a * I + b of each window: a close to 1 on edges, 0 on flat areas
+        float epsilon = static_cast<float>(eps);
+        cv::parallel_for_(cv::Range(0, small.rows), [&](const cv::Range& rows) {
+            for (int y = rows.start; y < rows.end; ++y) {
+                float* mean = meanI.ptr<float>(y);
+                float* meanSquare = meanII.ptr<float>(y);
+                for (int x = 0; x < smallWidth; ++x) {
+                    float variance = std::max(0.f, meanSquare[x] - mean[x] * mean[x]);
+                    float a = variance / (variance + epsilon);
+                    meanSquare[x] = a;
+                    mean[x] = mean[x] * (1.f - a);
+                }
+            }
+        });
+
+        // Average the models covering each pixel, then bring them back to full resolution
+        cv::Mat meanA, meanB;
+        cv::boxFilter(meanII, meanA, CV_32F, window);
+        cv::boxFilter(meanI, meanB, CV_32F, window);
+        cv::resize(meanA, meanA, img.size(), 0, 0, cv::INTER_LINEAR);
+        cv::resize(meanB, meanB, img.size(), 0, 0, cv::INTER_LINEAR);
+
+        cv::Mat output(img.size(), img.type());
+        int width = img.cols * channels;
+        cv::parallel_for_(cv::Range(0, img.rows), [&](const cv::Range& rows) {
+            for (int y = rows.start; y < rows.end; ++y) {
+                const uchar* in = img.ptr<uchar>(y);
+                const float* a = meanA.ptr<float>(y);
+                const float* b = meanB.ptr<float>(y);
+                uchar* out = output.ptr<uchar>(y);
+                for (int x = 0; x < width; ++x) {
+                    out[x] = cv::saturate_cast<uchar>(a[x] * in[x] + 255.f * b[x]);
+                }
+            }
+        });
+
+        return output;
+    }
+
     //mux for choose PreprocessingType
     cv::Mat ImagePreProcessor::process(const cv::Mat& img, PreprocessingType type) {
         switch(type) {
@@ -105,6 +176,8 @@ namespace idl
                 return ImagePreProcessor::applyHistogramEqualization(img);
             case PreprocessingType::NoiseCorrection:
                 return ImagePreProcessor::applyNoiseCorrection(img);
+            case PreprocessingType::FastNoiseCorrection:
+                return ImagePreProcessor::applyFastNoiseCorrection(img);
             default:
                 return img;
         }
@@ -116,12 +189,9 @@ namespace idl
             std::cerr << "Error : img void." << std::endl;
             return img;
         }
-        cv::Mat imgNew = img;
-        /*
-        imgNew = ImagePreProcessor::applyGrayscale(imgNew);
-        imgNew = ImagePreProcessor::applyMedianBlur(imgNew, 5);
-        imgNew = ImagePreProcessor::applyHistogramEqualization(imgNew);
-        */
+        cv::Mat imgNew;
+        thread_local PreprocessingPipeline pipeline = PreprocessingPipeline().grayscale().medianBlur(5).equalize();
+        pipeline.apply(img, imgNew);
 
         //imgNew = ImagePreProcessor::applyNoiseCorrection(imgNew, 7);
 
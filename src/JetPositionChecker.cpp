@@ -2,14 +2,14 @@
 
 namespace idl
 {
-    LaserBehavior JetPositionChecker::isOnPlant(const Plant& iPlant, const cv::Point& iJet)
+    LaserBehavior JetPositionChecker::isOnPlant(const Plant& iPlant, const cv::Point& iJet, int iReduction)
     {
         int tolerance = 0; // px
         auto boundingBox = iPlant.boundingBox;
         
         if (Species::advantis == iPlant.plantSpecies)
         {
-            tolerance = 40; // px
+            tolerance = 40 / iReduction; // px
             boundingBox.height += tolerance; // px
             boundingBox.width  += tolerance; // px
 
@@ -76,7 +76,7 @@ namespace idl
 
         for (const auto& plant : _plants)
         {
-            auto state = isOnPlant(plant, intersection);
+            auto state = isOnPlant(plant, intersection, _lineDetector.getReduction());
             if (LaserBehavior::onAdventis == state || LaserBehavior::onWheat == state)
             {
                 return state;
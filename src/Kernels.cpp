@@ -0,0 +1,136 @@
+#include "Kernels.hpp"
+#include "KernelVariants.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+
+namespace idl
+{
+    namespace kernels
+    {
+        /**
+         * Instruction set of the kernels, -1 until the first use.
+         */
+        std::atomic<int> selectedIsa {-1};
+
+        const char* isaName(Isa iIsa)
+        {
+            switch (iIsa)
+            {
+                case Isa::sse4:
+                    return "sse4";
+                case Isa::avx2:
+                    return "avx2";
+                case Isa::avx512:
+                    return "avx512";
+                case Isa::scalar:
+                default:
+                    return "scalar";
+            }
+        }
+
+        bool parseIsa(const std::string& iName, Isa& oIsa)
+        {
+            for (Isa isa : {Isa::scalar, Isa::sse4, Isa::avx2, Isa::avx512})
+            {
+                if (iName == isaName(isa))
+                {
+                    oIsa = isa;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool isSupported(Isa iIsa)
+        {
+            switch (iIsa)
+            {
+#ifdef IDL_KERNELS_X86
+                // Also checks that the OS saves the vector registers
+                case Isa::sse4:
+                    return __builtin_cpu_supports("sse4.1");
+                case Isa::avx2:
+                    return __builtin_cpu_supports("avx2");
+                case Isa::avx512:
+                    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+                case Isa::scalar:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        Isa detectIsa()
+        {
+            for (Isa isa : {Isa::avx512, Isa::avx2, Isa::sse4})
+            {
+                if (isSupported(isa))
+                {
+                    return isa;
+                }
+            }
+            return Isa::scalar;
+        }
+
+        bool setIsa(Isa iIsa)
+        {
+            if (!isSupported(iIsa))
+            {
+                std::cerr << "Error: The " << isaName(iIsa) << " kernels are not supported on this CPU" << std::endl;
+                return false;
+            }
+            selectedIsa = static_cast<int>(iIsa);
+            return true;
+        }
+
+        Isa getIsa()
+        {
+            int isa = selectedIsa;
+            if (isa >= 0)
+            {
+                return static_cast<Isa>(isa);
+            }
+
+            // First use: forced by the environment, or the best one
+            Isa forced;
+            const char* name = std::getenv("IDL_KERNEL_ISA");
+            if (name && !parseIsa(name, forced))
+            {
+                std::cerr << "Error: Unknown instruction set IDL_KERNEL_ISA=" << name 
+                          << " (scalar, sse4, avx2, avx512)" << std::endl;
+            }
+            if (!name || !parseIsa(name, forced) || !setIsa(forced))
+            {
+                selectedIsa = static_cast<int>(detectIsa());
+            }
+            return static_cast<Isa>(selectedIsa.load());
+        }
+
+        ColorDistanceMaskFn colorDistanceMaskVariant(Isa iIsa)
+        {
+            switch (iIsa)
+            {
+#ifdef IDL_KERNELS_X86
+                case Isa::sse4:
+                    return colorDistanceMaskSse4;
+                case Isa::avx2:
+                    return colorDistanceMaskAvx2;
+                case Isa::avx512:
+                    return colorDistanceMaskAvx512;
+#endif
+                case Isa::scalar:
+                    return colorDistanceMaskScalar;
+                default:
+                    return nullptr;
+            }
+        }
+
+        void colorDistanceMask(const uint8_t* iPixels, uint8_t* oMask, size_t iCount, 
+                               const uint8_t iTarget[3], int iThreshold)
+        {
+            colorDistanceMaskVariant(getIsa())(iPixels, oMask, iCount, iTarget, iThreshold);
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#include "KernelVariants.hpp"
+#include <immintrin.h>
+
+namespace idl
+{
+    namespace kernels
+    {
+        /**
+         * Load two groups of 16 bytes, one in each 128 bits lane.
+         */
+        inline __m256i loadLanes(const uint8_t* iLow, const uint8_t* iHigh)
+        {
+            __m128i low  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iLow));
+            __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iHigh));
+            return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+        }
+
+        void colorDistanceMaskAvx2(const uint8_t* iPixels, uint8_t* oMask, size_t iCount, 
+                                   const uint8_t iTarget[3], int iThreshold)
+        {
+            // The saturated byte sum only decides thresholds up to 255
+            if (iThreshold < 1 || iThreshold > 255)
+            {
+                colorDistanceMaskScalar(iPixels, oMask, iCount, iTarget, iThreshold);
+                return;
+            }
+
+            __m256i target[3], shuffle[3][3];
+            for (int c = 0; c < 3; ++c)
+            {
+                target[c] = _mm256_set1_epi8(static_cast<char>(iTarget[c]));
+                for (int r = 0; r < 3; ++r)
+                {
+                    shuffle[c][r] = _mm256_broadcastsi128_si256(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(deinterleaveTable.shuffle[c][r])));
+                }
+            }
+            const __m256i limit = _mm256_set1_epi8(static_cast<char>(iThreshold - 1));
+
+            // 32 pixels per iteration: byte shuffles stay within a lane, 
+            // so each lane deinterleaves its own group of 16 pixels
+            size_t i = 0;
+            for (; i + 32 <= iCount; i += 32)
+            {
+                const uint8_t* pixels = iPixels + 3 * i;
+                __m256i r0 = loadLanes(pixels,      pixels + 48);
+                __m256i r1 = loadLanes(pixels + 16, pixels + 64);
+                __m256i r2 = loadLanes(pixels + 32, pixels + 80);
+
+                __m256i distance = _mm256_setzero_si256();
+                for (int c = 0; c < 3; ++c)
+                {
+                    __m256i channel = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(r0, shuffle[c][0]), 
+                                                                      _mm256_shuffle_epi8(r1, shuffle[c][1])), 
+                                                      _mm256_shuffle_epi8(r2, shuffle[c][2]));
+                    __m256i diff = _mm256_or_si256(_mm256_subs_epu8(channel, target[c]), 
+                                                   _mm256_subs_epu8(target[c], channel));
+                    distance = _mm256_adds_epu8(distance, diff);
+                }
+
+                // distance <= threshold - 1, unsigned
+                __m256i isNear = _mm256_cmpeq_epi8(_mm256_min_epu8(distance, limit), distance);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(oMask + i), isNear);
+            }
+
+            colorDistanceMaskScalar(iPixels + 3 * i, oMask + i, iCount - i, iTarget, iThreshold);
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#include "KernelVariants.hpp"
+#include <immintrin.h>
+
+namespace idl
+{
+    namespace kernels
+    {
+        /**
+         * Gather the registers of four groups of 16 pixels (48 bytes each), one group per 
+         * 128 bits lane, from 192 contiguous bytes: register r of group k is the 16 bytes 
+         * chunk 3k + r, moved with 64 bits permutations.
+         */
+        inline void loadGroups(const uint8_t* iPixels, __m512i oRegisters[3])
+        {
+            __m512i z0 = _mm512_loadu_si512(iPixels);
+            __m512i z1 = _mm512_loadu_si512(iPixels + 64);
+            __m512i z2 = _mm512_loadu_si512(iPixels + 128);
+
+            // Chunks 0-7 come from z0 and z1, chunks 8-11 from z2 into the last lane
+            oRegisters[0] = _mm512_permutex2var_epi64(z0, _mm512_setr_epi64(0, 1, 6, 7, 12, 13, 0, 0), z1);
+            oRegisters[0] = _mm512_mask_permutexvar_epi64(oRegisters[0], 0xC0, _mm512_setr_epi64(0, 0, 0, 0, 0, 0, 2, 3), z2);
+            oRegisters[1] = _mm512_permutex2var_epi64(z0, _mm512_setr_epi64(2, 3, 8, 9, 14, 15, 0, 0), z1);
+            oRegisters[1] = _mm512_mask_permutexvar_epi64(oRegisters[1], 0xC0, _mm512_setr_epi64(0, 0, 0, 0, 0, 0, 4, 5), z2);
+            oRegisters[2] = _mm512_permutex2var_epi64(z0, _mm512_setr_epi64(4, 5, 10, 11, 0, 0, 0, 0), z1);
+            oRegisters[2] = _mm512_mask_permutexvar_epi64(oRegisters[2], 0xF0, _mm512_setr_epi64(0, 0, 0, 0, 0, 1, 6, 7), z2);
+        }
+
+        void colorDistanceMaskAvx512(const uint8_t* iPixels, uint8_t* oMask, size_t iCount, 
+                                     const uint8_t iTarget[3], int iThreshold)
+        {
+            // The saturated byte sum only decides thresholds up to 255
+            if (iThreshold < 1 || iThreshold > 255)
+            {
+                colorDistanceMaskScalar(iPixels, oMask, iCount, iTarget, iThreshold);
+                return;
+            }
+
+            __m512i target[3], shuffle[3][3];
+            for (int c = 0; c < 3; ++c)
+            {
+                target[c] = _mm512_set1_epi8(static_cast<char>(iTarget[c]));
+                for (int r = 0; r < 3; ++r)
+                {
+                    shuffle[c][r] = _mm512_broadcast_i32x4(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(deinterleaveTable.shuffle[c][r])));
+                }
+            }
+            const __m512i limit = _mm512_set1_epi8(static_cast<char>(iThreshold - 1));
+
+            // 64 pixels per iteration, each lane deinterleaves its own group of 16 pixels
+            size_t i = 0;
+            for (; i + 64 <= iCount; i += 64)
+            {
+                __m512i r[3];
+                loadGroups(iPixels + 3 * i, r);
+
+                __m512i distance = _mm512_setzero_si512();
+                for (int c = 0; c < 3; ++c)
+                {
+                    __m512i channel = _mm512_or_si512(_mm512_or_si512(_mm512_shuffle_epi8(r[0], shuffle[c][0]), 
+                                                                      _mm512_shuffle_epi8(r[1], shuffle[c][1])), 
+                                                      _mm512_shuffle_epi8(r[2], shuffle[c][2]));
+                    __m512i diff = _mm512_or_si512(_mm512_subs_epu8(channel, target[c]), 
+                                                   _mm512_subs_epu8(target[c], channel));
+                    distance = _mm512_adds_epu8(distance, diff);
+                }
+
+                __mmask64 isNear = _mm512_cmple_epu8_mask(distance, limit);
+                _mm512_storeu_si512(oMask + i, _mm512_movm_epi8(isNear));
+            }
+
+            colorDistanceMaskScalar(iPixels + 3 * i, oMask + i, iCount - i, iTarget, iThreshold);
+        }
+    }
+}
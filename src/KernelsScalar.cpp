@@ -0,0 +1,20 @@
+#include "KernelVariants.hpp"
+#include <cstdlib>
+
+namespace idl
+{
+    namespace kernels
+    {
+        void colorDistanceMaskScalar(const uint8_t* iPixels, uint8_t* oMask, size_t iCount, 
+                                     const uint8_t iTarget[3], int iThreshold)
+        {
+            for (size_t i = 0; i < iCount; ++i, iPixels += 3)
+            {
+                int distance = std::abs(iTarget[0] - iPixels[0]) 
+                             + std::abs(iTarget[1] - iPixels[1]) 
+                             + std::abs(iTarget[2] - iPixels[2]);
+                oMask[i] = distance < iThreshold ? 255 : 0;
+            }
+        }
+    }
+}
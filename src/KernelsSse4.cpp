@@ -0,0 +1,56 @@
+#include "KernelVariants.hpp"
+#include <immintrin.h>
+
+namespace idl
+{
+    namespace kernels
+    {
+        void colorDistanceMaskSse4(const uint8_t* iPixels, uint8_t* oMask, size_t iCount, 
+                                   const uint8_t iTarget[3], int iThreshold)
+        {
+            // The saturated byte sum only decides thresholds up to 255
+            if (iThreshold < 1 || iThreshold > 255)
+            {
+                colorDistanceMaskScalar(iPixels, oMask, iCount, iTarget, iThreshold);
+                return;
+            }
+
+            __m128i target[3], shuffle[3][3];
+            for (int c = 0; c < 3; ++c)
+            {
+                target[c] = _mm_set1_epi8(static_cast<char>(iTarget[c]));
+                for (int r = 0; r < 3; ++r)
+                {
+                    shuffle[c][r] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(deinterleaveTable.shuffle[c][r]));
+                }
+            }
+            const __m128i limit = _mm_set1_epi8(static_cast<char>(iThreshold - 1));
+
+            // 16 pixels per iteration
+            size_t i = 0;
+            for (; i + 16 <= iCount; i += 16)
+            {
+                const uint8_t* pixels = iPixels + 3 * i;
+                __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));
+                __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + 16));
+                __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + 32));
+
+                __m128i distance = _mm_setzero_si128();
+                for (int c = 0; c < 3; ++c)
+                {
+                    __m128i channel = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r0, shuffle[c][0]), 
+                                                                _mm_shuffle_epi8(r1, shuffle[c][1])), 
+                                                   _mm_shuffle_epi8(r2, shuffle[c][2]));
+                    __m128i diff = _mm_or_si128(_mm_subs_epu8(channel, target[c]), _mm_subs_epu8(target[c], channel));
+                    distance = _mm_adds_epu8(distance, diff);
+                }
+
+                // distance <= threshold - 1, unsigned
+                __m128i isNear = _mm_cmpeq_epi8(_mm_min_epu8(distance, limit), distance);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(oMask + i), isNear);
+            }
+
+            colorDistanceMaskScalar(iPixels + 3 * i, oMask + i, iCount - i, iTarget, iThreshold);
+        }
+    }
+}
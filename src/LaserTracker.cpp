@@ -0,0 +1,63 @@
+#include "LaserTracker.hpp"
+
+namespace idl
+{
+    LaserTracker::LaserTracker(int iWindowSize, float iMinConfidence):
+        _windowSize(iWindowSize), _minConfidence(iMinConfidence)
+    {
+    }
+
+    cv::Point LaserTracker::predict() const
+    {
+        if (!isTracking())
+        {
+            return cv::Point {-1, -1};
+        }
+
+        return _last + _velocity;
+    }
+
+    cv::Rect LaserTracker::getSearchArea(const cv::Size& iFrameSize) const
+    {
+        if (!isTracking())
+        {
+            // Lost, search the whole frame
+            return cv::Rect();
+        }
+
+        cv::Point center = predict();
+        cv::Rect window = cv::Rect(center.x - _windowSize / 2, center.y - _windowSize / 2,
+            _windowSize, _windowSize);
+
+        return window & cv::Rect(0, 0, iFrameSize.width, iFrameSize.height);
+    }
+
+    bool LaserTracker::isReliable(const LineDetector& iDetector) const
+    {
+        return iDetector.hasIntersection() 
+            && iDetector.getIntersectionConfidence() >= _minConfidence;
+    }
+
+    void LaserTracker::update(const LineDetector& iDetector)
+    {
+        if (!isReliable(iDetector))
+        {
+            reset();
+            return;
+        }
+
+        cv::Point intersection = iDetector.getIntersection();
+
+        // The velocity needs two consecutive tracked frames
+        _velocity = isTracking() ? intersection - _last : cv::Point {0, 0};
+        _last     = intersection;
+        _nbTracked++;
+    }
+
+    void LaserTracker::reset()
+    {
+        _last      = cv::Point {-1, -1};
+        _velocity  = cv::Point {0, 0};
+        _nbTracked = 0;
+    }
+}
@@ -1,175 +1,474 @@
 #include "LineDetector.hpp"
+#include "Hash.hpp"
+#include "Kernels.hpp"
+#include "PerfCounters.hpp"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 namespace idl 
 {
+    // Laser color in the Lab space and maximal L1 distance to it
+    const cv::Vec3i laserColor          = {163, 101, 139};
+    const int       laserColorThreshold = 30;
+
+    // Version of the detection, to bump when the algorithm changes the results
+    const uint64_t  lineDetectorVersion = 1;
+
     cv::Mat LineDetector::filterLinesColor(const cv::Mat& in)
     {
-        //DEF STATIC VAR
-        cv::Vec3i targetColor = {163, 101, 139};
-        int threshold = 30;
+        PerfCounters::Scope scope("filterLinesColor");
+        const uint8_t targetColor[3] = {static_cast<uint8_t>(laserColor[0]), 
+                                        static_cast<uint8_t>(laserColor[1]), 
+                                        static_cast<uint8_t>(laserColor[2])};
         cv::Mat imgLab;
         cv::cvtColor(in,imgLab,cv::COLOR_BGR2Lab);
         cv::Mat out(imgLab.rows, imgLab.cols, CV_8UC1);
+
+        // Vectorized L1 distance threshold, row by row (the input may be a region of the image)
         for (int j = 0; j < imgLab.rows; j++)
         {
-            for (int i = 0; i < imgLab.cols; i++)
-            {
-                cv::Vec3b pixel = imgLab.at<cv::Vec3b>(cv::Point{i,j});
-                double distance = abs(targetColor[0]-pixel[0]) + abs(targetColor[1]-pixel[1]) + abs(targetColor[2]-pixel[2]);
-
-                if(distance<threshold){
-                    out.at<uchar>(cv::Point{i,j})=255;
-                } else {
-                    out.at<uchar>(cv::Point{i,j})=0;
-                }
-            }
+            kernels::colorDistanceMask(imgLab.ptr<uint8_t>(j), out.ptr<uint8_t>(j), imgLab.cols, 
+                                       targetColor, laserColorThreshold);
         }
         
         return out;
     }
 
-    LineDetector::LineDetector(const cv::Mat& iImgSrc):
-        _img(iImgSrc)
+    LineDetector::LineDetector(const cv::Mat& iImgSrc, LaserLocator iLocator, const cv::Rect& iSearchArea, int iReduction):
+        _img(iImgSrc), _locator(iLocator), _searchArea(iSearchArea), _reduction(std::max(1, iReduction))
+    {
+    }
+
+    uint64_t LineDetector::parametersHash(LaserLocator iLocator, int iReduction)
     {
+        uint64_t oHash = hash::value(lineDetectorVersion);
+        oHash = hash::value(static_cast<int>(iLocator), oHash);
+        oHash = hash::value(iReduction, oHash);
+        for (int i = 0; i < 3; i++)
+        {
+            oHash = hash::value(laserColor[i], oHash);
+        }
+        return hash::value(laserColorThreshold, oHash);
+    }
+
+    LineDetector::Results LineDetector::getResults() const
+    {
+        computeIntersections();
+        return Results {_lines, _intersections, _intersection, _confidence};
+    }
+
+    void LineDetector::setResults(const Results& iResults)
+    {
+        _isComputed    = true;
+        _lines         = iResults.lines;
+        _intersections = iResults.intersections;
+        _intersection  = iResults.intersection;
+        _confidence    = iResults.confidence;
     }
 
     std::vector<cv::Vec4i> LineDetector::getCurLines() const 
+    {
+        computeIntersections();
+        return _lines;
+    }
+
+    std::vector<cv::Vec4i> LineDetector::houghLines(const cv::Mat& iMask, int iReduction)
     {
         // output 
         std::vector<cv::Vec4i> oResults; 
         
         // intermediary variables
-        cv::Mat dst, cdst;  
+        cv::Mat dst;  
 
         // Use Canny for edge detection
-        dst = filterLinesColor(_img);
-        cv::Canny(dst, dst, 50, 300, 3, true);
+        cv::Canny(iMask, dst, 50, 300, 3, true);
         
         // Apply hough transformation
-        std::vector<cv::Vec4i> lines;
-        cv::HoughLinesP(dst, oResults, 1, .5*CV_PI/180, 150, 200, 500);
+        cv::HoughLinesP(dst, oResults, 1, .5*CV_PI/180, 150 / iReduction, 200.0 / iReduction, 500.0 / iReduction);
 
         return oResults;
     }
 
-    cv::Vec3f LineDetector::toLinearEquation(const cv::Vec4i& iLine)
+    std::vector<cv::Vec4i> LineDetector::projectionLines(const cv::Mat& iMask, int iReduction)
     {
-        float a, b, c;
-        float x1 = iLine[0];
-        float y1 = iLine[1];
-        float x2 = iLine[2];
-        float y2 = iLine[3];
+        // fitting parameters, lengths given at full resolution
+        const int    maxLines       = 2;      // the laser is a cross of two lines
+        const size_t maxSamples     = 4000;   // laser pixels kept for the fitting
+        const int    iterations     = 150;    // RANSAC draws per line
+        const float  inlierDistance = std::max(1.0f, 3.0f / iReduction);   // px
+        const size_t minInliers     = 100 / iReduction;                    // samples required to accept a line
+        const float  minLength      = 200.0f / iReduction;                 // px, same as hough minLineLength
 
-        a = y2-y1;
-        b = x1-x2;
-        c = y1 * (x2-x1) - (y2-y1) * x1;
-        return cv::Vec3f {a,b,c};
-    }
+        // output
+        std::vector<cv::Vec4i> oResults;
 
-    float LineDetector::computeAngle(const cv::Vec4i& iLine1, const cv::Vec4i& iLine2)
-    {
-        cv::Vec2f vec1 = 
+        // Projection profiles: skip rows without laser and bound the scanned columns
+        cv::Mat rowProfile, colProfile;
+        cv::reduce(iMask, rowProfile, 1, cv::REDUCE_SUM, CV_32S);
+        cv::reduce(iMask, colProfile, 0, cv::REDUCE_SUM, CV_32S);
+
+        int xMin = 0, xMax = iMask.cols - 1;
+        while (xMin <= xMax && 0 == colProfile.at<int>(0, xMin)) xMin++;
+        while (xMax >= xMin && 0 == colProfile.at<int>(0, xMax)) xMax--;
+
+        // Collect the laser pixels
+        std::vector<cv::Point2f> points;
+        for (int y = 0; y < iMask.rows && xMin <= xMax; y++)
         {
-            static_cast<float>(iLine1[2])-static_cast<float>(iLine1[0]),
-            static_cast<float>(iLine1[3])-static_cast<float>(iLine1[1])
-        };
-        cv::Vec2f vec2 = 
+            if (0 == rowProfile.at<int>(y, 0))
+            {
+                continue;
+            }
+
+            const uchar* row = iMask.ptr<uchar>(y);
+            for (int x = xMin; x <= xMax; x++)
+            {
+                if (row[x])
+                {
+                    points.emplace_back(static_cast<float>(x), static_cast<float>(y));
+                }
+            }
+        }
+
+        // Sample the laser pixels to bound the fitting cost
+        if (points.size() > maxSamples)
         {
-            static_cast<float>(iLine2[2])-static_cast<float>(iLine2[0]),
-            static_cast<float>(iLine2[3])-static_cast<float>(iLine2[1])
-        };
+            size_t step = (points.size() + maxSamples - 1) / maxSamples;
+            size_t kept = 0;
+            for (size_t i = 0; i < points.size(); i += step)
+            {
+                points[kept++] = points[i];
+            }
+            points.resize(kept);
+        }
 
-        return static_cast<float>(
-            acos(vec1.dot(vec2)/(cv::norm(vec1)*cv::norm(vec2)))
-        );
+        cv::RNG rng(0x1A5E7); // fixed seed, results must be reproducible
+        std::vector<cv::Point2f> inliers, remaining;
+
+        for (int lineIndex = 0; lineIndex < maxLines && points.size() >= minInliers; lineIndex++)
+        {
+            // RANSAC: keep the candidate line n.x*x + n.y*y + c = 0 with the largest support
+            size_t bestCount = 0;
+            cv::Point2f bestNormal;
+            float bestC = 0.f;
+            int nbPoints = static_cast<int>(points.size());
+
+            for (int it = 0; it < iterations; it++)
+            {
+                const cv::Point2f& p1 = points[rng.uniform(0, nbPoints)];
+                const cv::Point2f& p2 = points[rng.uniform(0, nbPoints)];
+                cv::Point2f dir = p2 - p1;
+                float len = std::sqrt(dir.dot(dir));
+
+                if (len < 2 * inlierDistance)
+                {
+                    // points too close to give a reliable direction
+                    continue;
+                }
+
+                cv::Point2f normal = {-dir.y / len, dir.x / len};
+                float c = -normal.dot(p1);
+
+                size_t count = 0;
+                for (const auto& pt : points)
+                {
+                    if (std::abs(normal.dot(pt) + c) < inlierDistance)
+                    {
+                        count++;
+                    }
+                }
+
+                if (count > bestCount)
+                {
+                    bestCount  = count;
+                    bestNormal = normal;
+                    bestC      = c;
+                }
+            }
+
+            if (bestCount < minInliers)
+            {
+                break;
+            }
+
+            // Split the line's inliers from the points left for the next line
+            inliers.clear();
+            remaining.clear();
+            for (const auto& pt : points)
+            {
+                if (std::abs(bestNormal.dot(pt) + bestC) < inlierDistance)
+                {
+                    inliers.push_back(pt);
+                }
+                else
+                {
+                    remaining.push_back(pt);
+                }
+            }
+            points.swap(remaining);
+
+            // Refine the line with a robust least-squares fit on its inliers
+            cv::Vec4f fitted;
+            cv::fitLine(inliers, fitted, cv::DIST_HUBER, 0, 0.01, 0.01);
+            cv::Point2f dir    = {fitted[0], fitted[1]};
+            cv::Point2f origin = {fitted[2], fitted[3]};
+
+            // Retrieve the segment extent by projecting the inliers onto the line
+            float tMin = std::numeric_limits<float>::max();
+            float tMax = std::numeric_limits<float>::lowest();
+            for (const auto& pt : inliers)
+            {
+                float t = (pt - origin).dot(dir);
+                tMin = std::min(tMin, t);
+                tMax = std::max(tMax, t);
+            }
+
+            if (tMax - tMin < minLength)
+            {
+                // too short to be a laser line
+                continue;
+            }
+
+            cv::Point2f pt1 = origin + dir * tMin;
+            cv::Point2f pt2 = origin + dir * tMax;
+            oResults.emplace_back(cvRound(pt1.x), cvRound(pt1.y), cvRound(pt2.x), cvRound(pt2.y));
+        }
+
+        return oResults;
     }
 
-    std::vector<cv::Point> LineDetector::getIntersections() const
+    std::vector<LineDetector::LineFamily> LineDetector::clusterLines(const std::vector<cv::Vec4i>& iLines, int iReduction)
     {
-        std::vector<cv::Point> oResults;
-        auto lines = getCurLines();
+        const float parallelCos    = 0.995f; // cos(0.1 rad), below this the lines are crossing
+        const float offsetDistance = 20.0f / iReduction;  // px, max distance of a segment to its family line
+
+        std::vector<LineFamily> oFamilies;
 
-        if (0 == lines.size())
+        // Seed the families with the longest segments first
+        std::vector<size_t> order(iLines.size());
+        std::vector<float> lengths(iLines.size());
+        for (size_t i = 0; i < iLines.size(); i++)
         {
-            return oResults;
+            order[i]   = i;
+            lengths[i] = static_cast<float>(std::hypot(iLines[i][2] - iLines[i][0], iLines[i][3] - iLines[i][1]));
         }
+        std::sort(order.begin(), order.end(), [&lengths](size_t a, size_t b) { return lengths[a] > lengths[b]; });
 
-        for (size_t lineIndex = 0; lineIndex < lines.size()-1; lineIndex++)
+        for (size_t index : order)
         {
-            // retrieve the first line to compare, with its linear equation
-            auto line1     = lines[lineIndex];
-            auto linearEq1 = toLinearEquation(line1); 
+            const cv::Vec4i& line = iLines[index];
+            float length = lengths[index];
+            if (length <= 0.0f)
+            {
+                continue;
+            }
 
-            for (size_t compareLineIndex = lineIndex+1; 
-                compareLineIndex < lines.size(); 
-                compareLineIndex++)
+            cv::Point2f direction = {(line[2] - line[0]) / length, (line[3] - line[1]) / length};
+            cv::Point2f middle    = {(line[0] + line[2]) / 2.0f, (line[1] + line[3]) / 2.0f};
+
+            // Look for a family with the same direction and a close offset
+            LineFamily* family = nullptr;
+            for (auto& candidate : oFamilies)
             {
-                // retrieve the second line to compare, with its linear equation
-                auto line2     = lines[compareLineIndex];
-                auto linearEq2 = toLinearEquation(line2);
-    
-                // check the angle between the two lines
-                // if the angle is too small, they might be parallel in reality 
-                // then ignore, otherwise, continue comparison
-                if ((computeAngle(line1, line2)) > 0.1f /* threshold */)
+                float cosAngle = candidate.direction.dot(direction);
+                float offset   = std::abs(candidate.direction.cross(middle - candidate.point));
+                if (std::abs(cosAngle) > parallelCos && offset < offsetDistance)
                 {
-                    // Prepare for linear equation resolving
-                    float data[2][2] = {
-                        {linearEq1[0], linearEq1[1]},
-                        {linearEq2[0], linearEq2[1]}
-                    }; 
-                    cv::Mat A (2, 2, CV_32F, data);
-                    cv::Vec2f B = {-linearEq1[2], -linearEq2[2]};
-                    cv::Vec2f pt;
-
-                    // Solve linear equations
-                    bool isSolve = cv::solve(A, B, pt);
-
-                    // If equations has been solved and point is in outlines
-                    if (isSolve 
-                        && pt[0] >= 0 && pt[0] < _img.cols
-                        && pt[1] >= 0 && pt[1] < _img.rows)
+                    family = &candidate;
+                    // orient the segment as its family
+                    if (cosAngle < 0.0f)
                     {
-                        // Add intersection to list
-                        oResults.emplace_back(cv::Point{
-                            static_cast<int>(pt[0]), static_cast<int>(pt[1])
-                        });
+                        direction = -direction;
                     }
+                    break;
                 }
             }
+
+            if (nullptr == family)
+            {
+                oFamilies.push_back(LineFamily {middle, direction, length});
+                continue;
+            }
+
+            // Merge the segment into the family representative, weighted by length
+            float weight = family->weight + length;
+            cv::Point2f sumDirection = family->direction * family->weight + direction * length;
+            family->point     = (family->point * family->weight + middle * length) / weight;
+            family->direction = sumDirection / std::sqrt(sumDirection.dot(sumDirection));
+            family->weight    = weight;
         }
 
-        return oResults;
+        return oFamilies;
     }
 
-    cv::Point LineDetector::getIntersection() const 
+    void LineDetector::computeIntersections() const
     {
-        cv::Point oPoint {-1, -1};          // result point
-        auto points = getIntersections();   // the differents retrieved points
-        int xTotal = 0, yTotal = 0;         // the sum of all Xs and Ys
-        int ptSize = static_cast<int>(points.size()); // the number of points to get mean point
-        
-        if (0 == ptSize)
+        const float parallelCos    = 0.995f; // cos(0.1 rad), same threshold as the clustering
+        const float agreeDistance  = 10.0f / _reduction;  // px, intersections supporting the result
+
+        if (_isComputed)
         {
-            // no point detected, return default "error" point with invalid value
-            return oPoint;
+            return;
         }
+        _isComputed = true;
+        PerfCounters::Scope scope("laser");
 
-        // Add all points to compute the mean point
-        for (const auto& pt : points)
+        // Restrict the detection to the search area
+        cv::Rect area = cv::Rect(0, 0, _img.cols, _img.rows);
+        if (!_searchArea.empty())
+        {
+            area &= _searchArea;
+        }
+
+        // Detect the lines, both backends work on the laser color mask
+        cv::Mat mask = filterLinesColor(_img(area));
+        switch (_locator)
+        {
+            case LaserLocator::projection:
+                _lines = projectionLines(mask, _reduction);
+                break;
+            case LaserLocator::hough:
+            default:
+                _lines = houghLines(mask, _reduction);
+                break;
+        }
+
+        // Back to image coordinates
+        for (auto& line : _lines)
+        {
+            line[0] += area.x;
+            line[1] += area.y;
+            line[2] += area.x;
+            line[3] += area.y;
+        }
+
+        auto families = clusterLines(_lines, _reduction);
+
+        float totalLength = 0.0f;
+        for (const auto& family : families)
+        {
+            totalLength += family.weight;
+        }
+
+        // Intersect every pair of crossing families with the Cramer's rule
+        std::vector<cv::Point2f> points;
+        std::vector<float> weights;
+        std::vector<bool> isCrossing(families.size(), false);
+
+        for (size_t i = 0; i < families.size(); i++)
+        {
+            for (size_t j = i + 1; j < families.size(); j++)
+            {
+                const LineFamily& f1 = families[i];
+                const LineFamily& f2 = families[j];
+
+                // unit directions: |dot| is the cosine and |det| the sine of the angle
+                float cosAngle = std::abs(f1.direction.dot(f2.direction));
+                if (cosAngle > parallelCos)
+                {
+                    continue;
+                }
+
+                // linear equations a*x + b*y + c = 0, (a, b) being the line normal
+                float a1 = -f1.direction.y, b1 = f1.direction.x, c1 = -(a1 * f1.point.x + b1 * f1.point.y);
+                float a2 = -f2.direction.y, b2 = f2.direction.x, c2 = -(a2 * f2.point.x + b2 * f2.point.y);
+                float det = a1 * b2 - a2 * b1;
+
+                cv::Point2f pt = {(b1 * c2 - b2 * c1) / det, (a2 * c1 - a1 * c2) / det};
+
+                // Keep the intersection only if inside the image
+                if (pt.x >= 0 && pt.x < _img.cols && pt.y >= 0 && pt.y < _img.rows)
+                {
+                    points.push_back(pt);
+                    weights.push_back(f1.weight * f2.weight * std::abs(det));
+                    isCrossing[i] = isCrossing[j] = true;
+                    _intersections.emplace_back(static_cast<int>(pt.x), static_cast<int>(pt.y));
+                }
+            }
+        }
+
+        if (points.empty())
+        {
+            return;
+        }
+
+        // Weighted median of each coordinate, robust to a stray intersection
+        float totalWeight = 0.0f;
+        for (float weight : weights)
+        {
+            totalWeight += weight;
+        }
+
+        auto weightedMedian = [&](float cv::Point2f::* coord)
+        {
+            std::vector<size_t> order(points.size());
+            for (size_t i = 0; i < order.size(); i++)
+            {
+                order[i] = i;
+            }
+            std::sort(order.begin(), order.end(), 
+                [&](size_t a, size_t b) { return points[a].*coord < points[b].*coord; });
+
+            float cumulated = 0.0f;
+            for (size_t index : order)
+            {
+                cumulated += weights[index];
+                if (cumulated >= totalWeight / 2.0f)
+                {
+                    return points[index].*coord;
+                }
+            }
+            return points[order.back()].*coord;
+        };
+
+        cv::Point2f median = {weightedMedian(&cv::Point2f::x), weightedMedian(&cv::Point2f::y)};
+        _intersection = cv::Point {static_cast<int>(median.x), static_cast<int>(median.y)};
+
+        // Confidence: agreement between the intersections and coverage of the detected lines
+        float agreeWeight = 0.0f, crossingLength = 0.0f;
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            cv::Point2f delta = points[i] - median;
+            if (delta.dot(delta) <= agreeDistance * agreeDistance)
+            {
+                agreeWeight += weights[i];
+            }
+        }
+        for (size_t i = 0; i < families.size(); i++)
         {
-            xTotal += pt.x;
-            yTotal += pt.y;
+            if (isCrossing[i])
+            {
+                crossingLength += families[i].weight;
+            }
         }
 
-        // Compute and return the mean point
-        return cv::Point {xTotal / ptSize, yTotal / ptSize};
+        _confidence = (agreeWeight / totalWeight) * (crossingLength / totalLength);
+    }
+
+    std::vector<cv::Point> LineDetector::getIntersections() const
+    {
+        computeIntersections();
+        return _intersections;
+    }
+
+    cv::Point LineDetector::getIntersection() const 
+    {
+        computeIntersections();
+        return _intersection;
+    }
+
+    float LineDetector::getIntersectionConfidence() const
+    {
+        computeIntersections();
+        return _confidence;
     }
 
     bool LineDetector::hasIntersection() const 
     {
-        return !getIntersections().empty();
+        computeIntersections();
+        return !_intersections.empty();
     }
 
     cv::Mat LineDetector::drawResults() const 
@@ -199,6 +498,7 @@ namespace idl
 
         if (hasIntersection())
         {
+            std::cout << "Intersection confidence: " << getIntersectionConfidence() << std::endl;
             cv::circle(dst, getIntersection(), 2, cv::Scalar(0,255,0), -1);
         }
 
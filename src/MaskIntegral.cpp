@@ -0,0 +1,53 @@
+#include "MaskIntegral.hpp"
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace idl
+{
+    void MaskIntegral::build(const cv::Mat& iMask)
+    {
+        if (CV_8UC1 != iMask.type())
+        {
+            std::cerr << "Error: The summed-area table needs an 8-bit single channel mask" << std::endl;
+            _sums.release();
+            return;
+        }
+
+        _sums.create(iMask.rows + 1, iMask.cols + 1, CV_32S);
+        std::memset(_sums.ptr<int32_t>(0), 0, _sums.cols * sizeof(int32_t));
+
+        for (int y = 0; y < iMask.rows; ++y)
+        {
+            const uint8_t* in = iMask.ptr<uint8_t>(y);
+            const int32_t* above = _sums.ptr<int32_t>(y);
+            int32_t* sums = _sums.ptr<int32_t>(y + 1);
+            int32_t rowSum = 0;
+            sums[0] = 0;
+            for (int x = 0; x < iMask.cols; ++x)
+            {
+                rowSum += in[x] != 0;
+                sums[x + 1] = above[x + 1] + rowSum;
+            }
+        }
+    }
+
+    int MaskIntegral::count(const cv::Rect& iBox) const
+    {
+        cv::Rect box = iBox & cv::Rect(cv::Point(0, 0), size());
+        if (box.empty())
+        {
+            return 0;
+        }
+
+        const int32_t* top = _sums.ptr<int32_t>(box.y);
+        const int32_t* bottom = _sums.ptr<int32_t>(box.y + box.height);
+        return bottom[box.x + box.width] - bottom[box.x] - top[box.x + box.width] + top[box.x];
+    }
+
+    double MaskIntegral::density(const cv::Rect& iBox) const
+    {
+        cv::Rect box = iBox & cv::Rect(cv::Point(0, 0), size());
+        return box.empty() ? 0.0 : static_cast<double>(count(box)) / box.area();
+    }
+}
@@ -0,0 +1,388 @@
+#include "Metrics.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace idl
+{
+    namespace
+    {
+        const int nbStages  = static_cast<int>(Metrics::Stage::nbStages);
+        const int nbQueues  = static_cast<int>(Metrics::Queue::nbQueues);
+        const int nbSpecies = 3;
+
+        const char* stageNames[nbStages]     = {"decode", "detect", "laser", "write", "frame"};
+        const char* queueNames[nbQueues]     = {"decoded", "detected", "rendered", "pending"};
+        const char* speciesNames[nbSpecies]  = {"unknown", "wheat", "advantis"};
+
+        // Upper bounds of the histogram buckets, the last bucket being +Inf
+        const int nbLatencyBounds = 12;
+        const uint64_t latencyBoundsUs[nbLatencyBounds] = {1000, 2000, 5000, 10000, 20000, 50000,
+            100000, 200000, 500000, 1000000, 2000000, 5000000};
+        const int nbPlantBounds = 8;
+        const uint64_t plantBounds[nbPlantBounds] = {0, 1, 2, 3, 5, 10, 20, 50};
+
+        /**
+         * Histogram written by a single thread.
+         */
+        template <int NbBounds>
+        struct Histogram
+        {
+            std::atomic<uint64_t> buckets[NbBounds + 1] = {};   //< observations of each bucket, not cumulated
+            std::atomic<uint64_t> sum {0};
+        };
+
+        /**
+         * Counters of a thread, on their own cache lines.
+         */
+        struct alignas(64) ThreadMetrics
+        {
+            std::atomic<uint64_t> nbFrames {0};
+            std::atomic<uint64_t> nbDropped {0};
+            std::atomic<uint64_t> nbLaserFound {0};
+            std::atomic<uint64_t> nbLaserMissed {0};
+            Histogram<nbLatencyBounds> latencies[nbStages];  //< in us
+            Histogram<nbPlantBounds> plants[nbSpecies];
+        };
+
+        std::atomic<bool> enabled {false};
+        std::atomic<uint64_t> queueDepths[nbQueues] = {};
+
+        /**
+         * Move a counter into another one, both being only written under the registry mutex.
+         */
+        void moveCount(std::atomic<uint64_t>& ioTotal, std::atomic<uint64_t>& ioCounter)
+        {
+            ioTotal.store(ioTotal.load(std::memory_order_relaxed) + ioCounter.load(std::memory_order_relaxed), 
+                          std::memory_order_relaxed);
+            ioCounter.store(0, std::memory_order_relaxed);
+        }
+
+        // The counters of the running threads, the slots of the ended ones being reused, 
+        // and the counts of the ended threads
+        std::mutex registryMutex;
+        std::vector<std::unique_ptr<ThreadMetrics>> registry;
+        std::vector<ThreadMetrics*> freeSlots;
+        ThreadMetrics ended;
+
+        /**
+         * Slot of a thread, released when the thread ends.
+         */
+        struct ThreadSlot
+        {
+            ThreadMetrics* metrics = nullptr;
+
+            ~ThreadSlot()
+            {
+                if (!metrics)
+                {
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(registryMutex);
+                moveCount(ended.nbFrames, metrics->nbFrames);
+                moveCount(ended.nbDropped, metrics->nbDropped);
+                moveCount(ended.nbLaserFound, metrics->nbLaserFound);
+                moveCount(ended.nbLaserMissed, metrics->nbLaserMissed);
+                for (int s = 0; s < nbStages; ++s)
+                {
+                    for (int b = 0; b <= nbLatencyBounds; ++b)
+                    {
+                        moveCount(ended.latencies[s].buckets[b], metrics->latencies[s].buckets[b]);
+                    }
+                    moveCount(ended.latencies[s].sum, metrics->latencies[s].sum);
+                }
+                for (int s = 0; s < nbSpecies; ++s)
+                {
+                    for (int b = 0; b <= nbPlantBounds; ++b)
+                    {
+                        moveCount(ended.plants[s].buckets[b], metrics->plants[s].buckets[b]);
+                    }
+                    moveCount(ended.plants[s].sum, metrics->plants[s].sum);
+                }
+                freeSlots.push_back(metrics);
+            }
+        };
+
+        /**
+         * @return the counters of the calling thread, registered on its first call
+         */
+        ThreadMetrics& threadMetrics()
+        {
+            thread_local ThreadSlot slot;
+            if (!slot.metrics)
+            {
+                std::lock_guard<std::mutex> lock(registryMutex);
+                if (freeSlots.empty())
+                {
+                    registry.push_back(std::make_unique<ThreadMetrics>());
+                    slot.metrics = registry.back().get();
+                }
+                else
+                {
+                    slot.metrics = freeSlots.back();
+                    freeSlots.pop_back();
+                }
+            }
+            return *slot.metrics;
+        }
+
+        /**
+         * Add to a counter only written by the calling thread: no read-modify-write needed.
+         */
+        void bump(std::atomic<uint64_t>& ioCounter, uint64_t iValue = 1)
+        {
+            ioCounter.store(ioCounter.load(std::memory_order_relaxed) + iValue, std::memory_order_relaxed);
+        }
+
+        template <int NbBounds>
+        void observe(Histogram<NbBounds>& ioHistogram, const uint64_t (&iBounds)[NbBounds], uint64_t iValue)
+        {
+            int bucket = 0;
+            while (bucket < NbBounds && iValue > iBounds[bucket])
+            {
+                bucket++;
+            }
+            bump(ioHistogram.buckets[bucket]);
+            bump(ioHistogram.sum, iValue);
+        }
+
+        int64_t nowNs()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /**
+         * @return the resident memory of the process in bytes, 0 if unknown
+         */
+        uint64_t residentBytes()
+        {
+#ifdef __linux__
+            FILE* file = std::fopen("/proc/self/statm", "r");
+            if (!file)
+            {
+                return 0;
+            }
+            unsigned long long size = 0, resident = 0;
+            int nbRead = std::fscanf(file, "%llu %llu", &size, &resident);
+            std::fclose(file);
+            return 2 == nbRead ? resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+            return 0;
+#endif
+        }
+
+        void appendHeader(std::string& oText, const char* iName, const char* iType, const char* iHelp)
+        {
+            oText += "# HELP ";
+            oText += iName;
+            oText += ' ';
+            oText += iHelp;
+            oText += "\n# TYPE ";
+            oText += iName;
+            oText += ' ';
+            oText += iType;
+            oText += '\n';
+        }
+
+        void appendSample(std::string& oText, const char* iName, const std::string& iLabels, double iValue)
+        {
+            char value[32];
+            std::snprintf(value, sizeof(value), "%.15g", iValue);
+            oText += iName;
+            if (!iLabels.empty())
+            {
+                oText += '{' + iLabels + '}';
+            }
+            oText += ' ';
+            oText += value;
+            oText += '\n';
+        }
+
+        /**
+         * Append the cumulated buckets, the sum and the count of a histogram summed over the threads.
+         */
+        template <int NbBounds>
+        void appendHistogram(std::string& oText, const std::string& iName, const std::string& iLabels,
+                             const uint64_t (&iBounds)[NbBounds], double iScale,
+                             const uint64_t (&iBuckets)[NbBounds + 1], uint64_t iSum)
+        {
+            std::string bucketName = iName + "_bucket";
+            uint64_t count = 0;
+            for (int b = 0; b <= NbBounds; ++b)
+            {
+                count += iBuckets[b];
+                char bound[32];
+                if (b < NbBounds)
+                {
+                    std::snprintf(bound, sizeof(bound), "%g", iBounds[b] * iScale);
+                }
+                else
+                {
+                    std::snprintf(bound, sizeof(bound), "+Inf");
+                }
+                appendSample(oText, bucketName.c_str(), iLabels + ",le=\"" + bound + "\"", static_cast<double>(count));
+            }
+            appendSample(oText, (iName + "_sum").c_str(), iLabels, iSum * iScale);
+            appendSample(oText, (iName + "_count").c_str(), iLabels, static_cast<double>(count));
+        }
+    }
+
+    Metrics::StageTimer::StageTimer(Stage iStage):
+        _stage(iStage)
+    {
+        if (enabled.load(std::memory_order_relaxed))
+        {
+            _startNs = nowNs();
+        }
+    }
+
+    Metrics::StageTimer::~StageTimer()
+    {
+        if (_startNs >= 0)
+        {
+            observeLatency(_stage, (nowNs() - _startNs) / 1e6);
+        }
+    }
+
+    void Metrics::enable()
+    {
+        enabled = true;
+    }
+
+    bool Metrics::isEnabled()
+    {
+        return enabled;
+    }
+
+    void Metrics::addFrame(const int iNbPlants[3])
+    {
+        if (!enabled.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        ThreadMetrics& metrics = threadMetrics();
+        bump(metrics.nbFrames);
+        for (int s = 0; s < nbSpecies; ++s)
+        {
+            observe(metrics.plants[s], plantBounds, static_cast<uint64_t>(iNbPlants[s]));
+        }
+    }
+
+    void Metrics::addDropped(uint64_t iNbFrames)
+    {
+        if (enabled.load(std::memory_order_relaxed))
+        {
+            bump(threadMetrics().nbDropped, iNbFrames);
+        }
+    }
+
+    void Metrics::addLaser(bool iFound)
+    {
+        if (enabled.load(std::memory_order_relaxed))
+        {
+            ThreadMetrics& metrics = threadMetrics();
+            bump(iFound ? metrics.nbLaserFound : metrics.nbLaserMissed);
+        }
+    }
+
+    void Metrics::observeLatency(Stage iStage, double iMs)
+    {
+        if (enabled.load(std::memory_order_relaxed))
+        {
+            uint64_t us = iMs > 0.0 ? static_cast<uint64_t>(iMs * 1000.0) : 0;
+            observe(threadMetrics().latencies[static_cast<int>(iStage)], latencyBoundsUs, us);
+        }
+    }
+
+    void Metrics::setQueueDepth(Queue iQueue, size_t iDepth)
+    {
+        if (enabled.load(std::memory_order_relaxed))
+        {
+            queueDepths[static_cast<int>(iQueue)].store(iDepth, std::memory_order_relaxed);
+        }
+    }
+
+    void Metrics::format(std::string& oText)
+    {
+        // Sum of the threads, each counter being read once
+        uint64_t nbFrames = 0, nbDropped = 0, nbLaserFound = 0, nbLaserMissed = 0;
+        uint64_t latencyBuckets[nbStages][nbLatencyBounds + 1] = {};
+        uint64_t latencySums[nbStages] = {};
+        uint64_t plantBuckets[nbSpecies][nbPlantBounds + 1] = {};
+        uint64_t plantSums[nbSpecies] = {};
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            auto sum = [&](const ThreadMetrics* metrics)
+            {
+                nbFrames      += metrics->nbFrames.load(std::memory_order_relaxed);
+                nbDropped     += metrics->nbDropped.load(std::memory_order_relaxed);
+                nbLaserFound  += metrics->nbLaserFound.load(std::memory_order_relaxed);
+                nbLaserMissed += metrics->nbLaserMissed.load(std::memory_order_relaxed);
+                for (int s = 0; s < nbStages; ++s)
+                {
+                    for (int b = 0; b <= nbLatencyBounds; ++b)
+                    {
+                        latencyBuckets[s][b] += metrics->latencies[s].buckets[b].load(std::memory_order_relaxed);
+                    }
+                    latencySums[s] += metrics->latencies[s].sum.load(std::memory_order_relaxed);
+                }
+                for (int s = 0; s < nbSpecies; ++s)
+                {
+                    for (int b = 0; b <= nbPlantBounds; ++b)
+                    {
+                        plantBuckets[s][b] += metrics->plants[s].buckets[b].load(std::memory_order_relaxed);
+                    }
+                    plantSums[s] += metrics->plants[s].sum.load(std::memory_order_relaxed);
+                }
+            };
+            sum(&ended);
+            for (const auto& metrics : registry)
+            {
+                sum(metrics.get());
+            }
+        }
+
+        oText.clear();
+        appendHeader(oText, "idl_frames_processed_total", "counter", "Frames processed.");
+        appendSample(oText, "idl_frames_processed_total", "", static_cast<double>(nbFrames));
+
+        appendHeader(oText, "idl_frames_dropped_total", "counter", "Frames dropped before their processing.");
+        appendSample(oText, "idl_frames_dropped_total", "", static_cast<double>(nbDropped));
+
+        appendHeader(oText, "idl_laser_detections_total", "counter", "Laser detections, by result.");
+        appendSample(oText, "idl_laser_detections_total", "result=\"found\"", static_cast<double>(nbLaserFound));
+        appendSample(oText, "idl_laser_detections_total", "result=\"missed\"", static_cast<double>(nbLaserMissed));
+
+        appendHeader(oText, "idl_stage_latency_seconds", "histogram", "Latency of each processing stage.");
+        for (int s = 0; s < nbStages; ++s)
+        {
+            appendHistogram(oText, "idl_stage_latency_seconds", std::string("stage=\"") + stageNames[s] + "\"",
+                            latencyBoundsUs, 1e-6, latencyBuckets[s], latencySums[s]);
+        }
+
+        appendHeader(oText, "idl_queue_depth", "gauge", "Frames waiting in each queue.");
+        for (int q = 0; q < nbQueues; ++q)
+        {
+            appendSample(oText, "idl_queue_depth", std::string("queue=\"") + queueNames[q] + "\"",
+                         static_cast<double>(queueDepths[q].load(std::memory_order_relaxed)));
+        }
+
+        appendHeader(oText, "idl_plants_per_frame", "histogram", "Plants detected in each frame, by species.");
+        for (int s = 0; s < nbSpecies; ++s)
+        {
+            appendHistogram(oText, "idl_plants_per_frame", std::string("species=\"") + speciesNames[s] + "\"",
+                            plantBounds, 1.0, plantBuckets[s], plantSums[s]);
+        }
+
+        appendHeader(oText, "process_resident_memory_bytes", "gauge", "Resident memory size in bytes.");
+        appendSample(oText, "process_resident_memory_bytes", "", static_cast<double>(residentBytes()));
+    }
+}
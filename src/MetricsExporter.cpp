@@ -0,0 +1,227 @@
+#include "MetricsExporter.hpp"
+#include "Metrics.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+// POSIX
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace idl
+{
+    namespace
+    {
+        const size_t maxRequestSize = 8192;   // bytes, headers included
+
+        /**
+         * Send a whole buffer, a closed peer is not a fatal error.
+         */
+        bool sendAll(int fd, const std::string& data)
+        {
+            size_t sent = 0;
+            while (sent < data.size())
+            {
+                ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+                if (n < 0 && EINTR == errno)
+                {
+                    continue;
+                }
+                if (n <= 0)
+                {
+                    return false;
+                }
+                sent += static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        /**
+         * Read the request of a client and answer it, the connection is then closed.
+         */
+        void answer(int client)
+        {
+            // A slow client does not hold the exporter
+            struct timeval timeout = {1, 0};
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+            std::string request;
+            char chunk[1024];
+            while (request.find("\r\n\r\n") == std::string::npos && request.size() < maxRequestSize)
+            {
+                ssize_t length = recv(client, chunk, sizeof(chunk), 0);
+                if (length < 0 && EINTR == errno)
+                {
+                    continue;
+                }
+                if (length <= 0)
+                {
+                    break;
+                }
+                request.append(chunk, static_cast<size_t>(length));
+            }
+
+            std::string body;
+            const char* status = "200 OK";
+            if (0 == request.compare(0, 13, "GET /metrics ") || 0 == request.compare(0, 6, "GET / "))
+            {
+                Metrics::format(body);
+            }
+            else
+            {
+                status = "404 Not Found";
+                body = "Not found, the metrics are served on /metrics\n";
+            }
+
+            std::string reply = std::string("HTTP/1.0 ") + status + "\r\n"
+                                "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                                "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                                "Connection: close\r\n\r\n" + body;
+            sendAll(client, reply);
+        }
+    }
+
+    MetricsExporter::~MetricsExporter()
+    {
+        stop();
+    }
+
+    bool MetricsExporter::listen(int iPort)
+    {
+        if (_fd >= 0)
+        {
+            return true;
+        }
+
+        struct sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(iPort));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        _fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (_fd < 0)
+        {
+            std::cerr << "Error: Unable to create the metrics socket" << std::endl;
+            return false;
+        }
+        fcntl(_fd, F_SETFD, FD_CLOEXEC);
+
+        int reuse = 1;
+        setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (bind(_fd, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address)) != 0
+            || ::listen(_fd, 8) != 0)
+        {
+            std::cerr << "Error: Unable to serve the metrics on port " << iPort << std::endl;
+            close(_fd);
+            _fd = -1;
+            return false;
+        }
+
+        Metrics::enable();
+        _server = std::thread(&MetricsExporter::serve, this);
+        return true;
+    }
+
+    bool MetricsExporter::writeFile(const std::string& iPath, double iPeriodS)
+    {
+        if (_writer.joinable())
+        {
+            return true;
+        }
+
+        _path = iPath;
+        _periodS = iPeriodS > 0.0 ? iPeriodS : 10.0;
+        Metrics::enable();
+        if (!write())
+        {
+            return false;
+        }
+
+        _writer = std::thread([this]()
+        {
+            auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                              std::chrono::duration<double>(_periodS));
+            auto next = std::chrono::steady_clock::now() + period;
+            while (!_isStopped)
+            {
+                // Short sleeps, so that stopping does not wait for the end of the period
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                if (std::chrono::steady_clock::now() >= next)
+                {
+                    write();
+                    next += period;
+                }
+            }
+            write();
+        });
+        return true;
+    }
+
+    void MetricsExporter::stop()
+    {
+        _isStopped = true;
+        if (_server.joinable())
+        {
+            _server.join();
+        }
+        if (_writer.joinable())
+        {
+            _writer.join();
+        }
+        if (_fd >= 0)
+        {
+            close(_fd);
+            _fd = -1;
+        }
+    }
+
+    void MetricsExporter::serve()
+    {
+        // Scrapes are rare and short, the clients are answered one at a time
+        struct pollfd listening = {_fd, POLLIN, 0};
+        while (!_isStopped)
+        {
+            int ready = poll(&listening, 1, 200);
+            if (ready <= 0 || !(listening.revents & POLLIN))
+            {
+                continue;
+            }
+
+            int client = accept(_fd, nullptr, nullptr);
+            if (client >= 0)
+            {
+                fcntl(client, F_SETFD, FD_CLOEXEC);
+                answer(client);
+                close(client);
+            }
+        }
+    }
+
+    bool MetricsExporter::write() const
+    {
+        std::string text;
+        Metrics::format(text);
+
+        // Written aside then renamed, a reader never sees a partial file
+        std::string temporary = _path + ".tmp";
+        FILE* file = std::fopen(temporary.c_str(), "w");
+        bool isWritten = file && std::fwrite(text.data(), 1, text.size(), file) == text.size();
+        isWritten = file && 0 == std::fclose(file) && isWritten;
+        if (!isWritten || std::rename(temporary.c_str(), _path.c_str()) != 0)
+        {
+            std::cerr << "Error: Unable to write the metrics to " << _path << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
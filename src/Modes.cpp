@@ -0,0 +1,488 @@
+#include "Modes.hpp"
+#include "AnalysisClient.hpp"
+#include "AnalysisServer.hpp"
+#include "DirectoryWatcher.hpp"
+#include "FrameArchive.hpp"
+#include "FrameRing.hpp"
+#include "Metrics.hpp"
+#include "PerfCounters.hpp"
+#include "ProcessingFactory.hpp"
+#include "ResultSink.hpp"
+#include "ResultsFolder.hpp"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace idl
+{
+    namespace
+    {
+        // Set by SIGINT / SIGTERM to leave the watch and daemon modes
+        volatile std::sig_atomic_t stopRequested = 0;
+
+        void onStopSignal(int)
+        {
+            stopRequested = 1;
+        }
+    }
+
+    int processDirectory(const std::string& imageDirectory, const ProcessingOptions& options)
+    {
+        fs::path savedPath = createResultsFolder();
+        ResultSink results;
+        if (savedPath.empty() || !openResults(results, savedPath, options.resultFormat))
+        {
+            return 1;
+        }
+
+        // Each row is written as soon as its image is processed
+        ProcessingFactory factory(imageDirectory, options, 
+            [&results](const ProcessingFactory::ImageProcessing& processing) { results.write(processing); });
+        std::cout << "Found " << factory.listProcessing().size() << " image(s)!" << std::endl;
+
+        if (options.trackPlants)
+        {
+            std::cout << "Plant classifications reused: " << factory.getPlantTracker().getNbReused() 
+                      << ", computed: " << factory.getPlantTracker().getNbClassified() << std::endl;
+        }
+
+        if (!options.cacheDirectory.empty())
+        {
+            std::cout << "Cached results loaded: " << factory.getResultCache().getNbHits() 
+                      << ", computed: " << factory.getResultCache().getNbMisses() << std::endl;
+        }
+
+        std::cout << results.getNbRows() << " result row(s) written" << std::endl;
+        reportPerfCounters(savedPath);
+
+        cv::namedWindow("Image", cv::WINDOW_AUTOSIZE);
+
+        for(int i = 0; i < factory.listProcessing().size(); ++i)
+        {   
+
+            cv::Mat imgs[2];
+            saveOverlays(factory[i], savedPath, imgs);
+
+            // display picture
+            for (auto img : imgs)
+            {
+                char windowTitle[60];
+                std::snprintf(windowTitle, 60, "Image #%d", i);
+                cv::imshow("Image", img);
+                if(cv::waitKey(200) == 27){
+                    return 0;
+                }
+            }
+        }
+        return 0;
+    }
+
+    int watchDirectory(const std::string& imageDirectory, const ProcessingOptions& options, size_t maxPending)
+    {
+        using Clock = std::chrono::system_clock;
+
+        DirectoryWatcher watcher;
+        if (!watcher.open(imageDirectory))
+        {
+            return -1;
+        }
+
+        fs::path savedPath = createResultsFolder();
+        ResultSink results;
+        if (savedPath.empty() || !openResults(results, savedPath, options.resultFormat))
+        {
+            return 1;
+        }
+
+        std::signal(SIGINT, onStopSignal);
+        std::signal(SIGTERM, onStopSignal);
+
+        ProcessingFactory factory(options);
+        std::deque<DirectoryWatcher::File> pending;
+        std::vector<DirectoryWatcher::File> completed;
+        size_t nbProcessed = 0, nbDropped = 0;
+        double sumLatency = 0.0, maxLatency = 0.0;
+
+        std::cout << "Watching " << imageDirectory << " (Ctrl+C to stop)" << std::endl;
+        while (!stopRequested)
+        {
+            // Block only when there is nothing left to process
+            completed.clear();
+            if (!watcher.wait(completed, pending.empty() ? 200 : 0))
+            {
+                break;
+            }
+            pending.insert(pending.end(), completed.begin(), completed.end());
+
+            // Backpressure: keep the newest images, the older ones would be processed too late
+            while (pending.size() > maxPending)
+            {
+                std::cerr << "Warning: Dropped " << pending.front().path << " (processing behind)" << std::endl;
+                pending.pop_front();
+                nbDropped++;
+                Metrics::addDropped();
+            }
+            Metrics::setQueueDepth(Metrics::Queue::pending, pending.size());
+
+            if (pending.empty())
+            {
+                continue;
+            }
+
+            DirectoryWatcher::File file = std::move(pending.front());
+            pending.pop_front();
+
+            const auto* processing = factory.process(file.path);
+            if (processing)
+            {
+                results.write(*processing);
+
+                cv::Mat imgs[2];
+                saveOverlays(*processing, savedPath, imgs);
+
+                double latency = std::chrono::duration<double, std::milli>(Clock::now() - file.completed).count();
+                Metrics::observeLatency(Metrics::Stage::frame, latency);
+                sumLatency += latency;
+                maxLatency = std::max(maxLatency, latency);
+                nbProcessed++;
+
+                std::cout << processing->getImageName() << ": " << latency << " ms, " 
+                          << pending.size() << " pending" << std::endl;
+            }
+
+            // Only the sequence state is kept, the memory stays bounded
+            factory.clear();
+        }
+
+        std::cout << "Processed " << nbProcessed << " image(s), dropped " << nbDropped 
+                  << ", latency mean " << (nbProcessed > 0 ? sumLatency / nbProcessed : 0.0) 
+                  << " ms, max " << maxLatency << " ms" << std::endl;
+        return 0;
+    }
+
+    int produceFrames(const std::string& imageDirectory, const std::string& ringName, uint32_t nbSlots, double fps)
+    {
+        std::vector<cv::String> fileNames;
+        cv::glob(imageDirectory + "/*.png", fileNames, false);
+
+        // Decode beforehand, as a capture process handing over raw frames
+        std::vector<cv::Mat> frames;
+        std::vector<std::string> names;
+        cv::Size maxSize;
+        for (const auto& fileName : fileNames)
+        {
+            cv::Mat img = cv::imread(fileName, cv::IMREAD_COLOR);
+            if (img.empty())
+            {
+                std::cerr << "Error: Could not load image " << fileName << std::endl;
+                continue;
+            }
+            maxSize.width = std::max(maxSize.width, img.cols);
+            maxSize.height = std::max(maxSize.height, img.rows);
+            frames.push_back(img);
+            names.push_back(fileName.substr(fileName.find_last_of("/") + 1));
+        }
+
+        FrameRing ring;
+        if (frames.empty() || !ring.create(ringName, nbSlots, maxSize))
+        {
+            return -1;
+        }
+
+        std::signal(SIGINT, onStopSignal);
+        std::signal(SIGTERM, onStopSignal);
+
+        auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / fps));
+        auto next = std::chrono::steady_clock::now();
+        size_t nbPushed = 0;
+        for (size_t i = 0; i < frames.size() && !stopRequested; ++i)
+        {
+            std::this_thread::sleep_until(next);
+            next += period;
+            nbPushed += ring.push(frames[i], names[i]) ? 1 : 0;
+        }
+        ring.close();
+
+        std::cout << "Pushed " << nbPushed << " frame(s), dropped " << ring.getNbDropped() << std::endl;
+
+        // Leave the consumer the time to map the ring before it is removed
+        while (!ring.isFinished() && !stopRequested)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return 0;
+    }
+
+    int consumeFrames(const std::string& ringName, const ProcessingOptions& options)
+    {
+        std::signal(SIGINT, onStopSignal);
+        std::signal(SIGTERM, onStopSignal);
+
+        // The producer may not have created the ring yet
+        FrameRing ring;
+        while (!ring.open(ringName))
+        {
+            if (stopRequested)
+            {
+                return 0;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+
+        fs::path savedPath = createResultsFolder();
+        ResultSink results;
+        if (savedPath.empty() || !openResults(results, savedPath, options.resultFormat))
+        {
+            return 1;
+        }
+
+        ProcessingFactory factory(options);
+        FrameRing::Frame frame;
+        size_t nbProcessed = 0;
+        double sumLatency = 0.0, maxLatency = 0.0;
+
+        while (!stopRequested && !ring.isFinished())
+        {
+            if (!ring.peek(frame))
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+                continue;
+            }
+
+            const auto* processing = factory.process(frame.image, frame.name);
+            if (processing)
+            {
+                results.write(*processing);
+
+                cv::Mat imgs[2];
+                saveOverlays(*processing, savedPath, imgs);
+
+                int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::system_clock::now().time_since_epoch()).count();
+                double latency = (now - frame.timestamp) / 1e6;
+                Metrics::observeLatency(Metrics::Stage::frame, latency);
+                sumLatency += latency;
+                maxLatency = std::max(maxLatency, latency);
+                nbProcessed++;
+
+                std::cout << frame.name << " #" << frame.sequence << ": " << latency << " ms" << std::endl;
+            }
+
+            // The processing views the slot: drop it before giving the slot back
+            factory.clear();
+            ring.release();
+        }
+
+        std::cout << "Processed " << nbProcessed << " frame(s), dropped " << ring.getNbDropped() 
+                  << ", latency mean " << (nbProcessed > 0 ? sumLatency / nbProcessed : 0.0) 
+                  << " ms, max " << maxLatency << " ms" << std::endl;
+        return 0;
+    }
+
+    int runPipeline(const std::string& imageDirectory, const ProcessingOptions& options, 
+                    const ProcessingPipeline::Settings& settings)
+    {
+        fs::path savedPath = createResultsFolder();
+        ResultSink results;
+        if (savedPath.empty() || !openResults(results, savedPath, options.resultFormat))
+        {
+            return 1;
+        }
+
+        ProcessingPipeline pipeline(options, settings);
+        auto start = std::chrono::steady_clock::now();
+        int nbProcessed = pipeline.run(imageDirectory, savedPath.string(), results);
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (nbProcessed < 0)
+        {
+            return -1;
+        }
+
+        std::cout << "Processed " << nbProcessed << " image(s) in " << elapsed << " ms" << std::endl;
+        std::cout << "stage, threads, frames, busy (ms), starved (ms), blocked (ms), queue mean, queue max" << std::endl;
+        for (const auto& stage : pipeline.getStats())
+        {
+            std::cout << stage.name << ", " << stage.nbThreads << ", " << stage.nbFrames << ", " 
+                      << stage.busyMs << ", " << stage.starvedMs << ", " << stage.blockedMs << ", " 
+                      << stage.meanDepth << ", " << stage.maxDepth << std::endl;
+        }
+        reportPerfCounters(savedPath);
+        return 0;
+    }
+
+    int streamVideo(const std::string& source, const ProcessingOptions& options, 
+                    DropPolicy policy, int everyN, double deadlineMs, double fps)
+    {
+        FrameStream stream(policy, everyN);
+        if (!stream.open(source, fps))
+        {
+            return -1;
+        }
+        if (deadlineMs <= 0.0)
+        {
+            deadlineMs = 1000.0 / stream.getFps();
+        }
+
+        fs::path savedPath = createResultsFolder();
+        ResultSink results;
+        if (savedPath.empty() || !openResults(results, savedPath, options.resultFormat))
+        {
+            return 1;
+        }
+
+        std::signal(SIGINT, onStopSignal);
+        std::signal(SIGTERM, onStopSignal);
+
+        ProcessingFactory factory(options);
+        std::vector<double> latencies;
+        size_t nbMissed = 0;
+        cv::Mat frame;
+        FrameStream::Clock::time_point captured;
+        uint64_t index = 0;
+        auto start = FrameStream::Clock::now();
+
+        while (!stopRequested && stream.next(frame, captured, index))
+        {
+            char name[32];
+            std::snprintf(name, sizeof(name), "frame_%06llu", static_cast<unsigned long long>(index));
+
+            PerfCounters::FrameScope frameScope(name);
+            const auto* processing = factory.process(frame, name);
+            if (processing)
+            {
+                results.write(*processing);
+
+                double latency = std::chrono::duration<double, std::milli>(
+                                     FrameStream::Clock::now() - captured).count();
+                Metrics::observeLatency(Metrics::Stage::frame, latency);
+                latencies.push_back(latency);
+                nbMissed += latency > deadlineMs ? 1 : 0;
+            }
+            factory.clear();
+        }
+
+        double elapsed = std::chrono::duration<double>(FrameStream::Clock::now() - start).count();
+        uint64_t nbCaptured = stream.getNbCaptured();
+        uint64_t nbDropped = stream.getNbDropped();
+
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&latencies](double p)
+        {
+            return latencies.empty() ? 0.0 : latencies[static_cast<size_t>(p * (latencies.size() - 1))];
+        };
+
+        std::cout << "Source " << stream.getFps() << " fps, processed " << latencies.size() << " frame(s) at " 
+                  << (elapsed > 0.0 ? latencies.size() / elapsed : 0.0) << " fps" << std::endl;
+        std::cout << "Dropped " << nbDropped << " of " << nbCaptured << " frame(s) (" 
+                  << (nbCaptured > 0 ? 100.0 * nbDropped / nbCaptured : 0.0) << " %)" << std::endl;
+        std::cout << "Latency p50 " << percentile(0.5) << " ms, p90 " << percentile(0.9) 
+                  << " ms, p99 " << percentile(0.99) << " ms, max " << percentile(1.0) << " ms" << std::endl;
+        std::cout << "Deadline " << deadlineMs << " ms missed by " << nbMissed << " frame(s)" << std::endl;
+        reportPerfCounters(savedPath);
+        return 0;
+    }
+
+    int convertFrames(const std::string& imageDirectory, const std::string& archivePath, int reduction)
+    {
+        int nbFrames = FrameArchive::convert(imageDirectory, archivePath, reduction);
+        if (nbFrames < 0)
+        {
+            return -1;
+        }
+        std::cout << nbFrames << " frame(s) written to " << archivePath << std::endl;
+        return 0;
+    }
+
+    int serve(const std::string& socketPath, const ProcessingOptions& options)
+    {
+        AnalysisServer server(socketPath, options);
+        if (!server.open())
+        {
+            return -1;
+        }
+
+        std::signal(SIGINT, onStopSignal);
+        std::signal(SIGTERM, onStopSignal);
+
+        std::cout << "Serving on " << socketPath << " (Ctrl+C to stop)" << std::endl;
+        size_t nbServed = server.run(stopRequested);
+        std::cout << "Served " << nbServed << " request(s)" << std::endl;
+        return 0;
+    }
+
+    int requestAnalysis(const std::string& socketPath, const std::string& requestFile)
+    {
+        AnalysisClient client;
+        std::string reply;
+        if (!client.connect(socketPath) 
+            || !client.analyseFile(fs::absolute(fs::path(requestFile)).string(), reply))
+        {
+            return -1;
+        }
+        std::cout << reply << std::endl;
+        return 0;
+    }
+
+    int benchmarkServer(const std::string& socketPath, const std::string& imageDirectory, int nbRounds)
+    {
+        AnalysisClient client;
+        if (!client.connect(socketPath))
+        {
+            return -1;
+        }
+
+        std::vector<cv::String> fileNames;
+        cv::glob(imageDirectory + "/*.png", fileNames, false);
+
+        std::vector<double> fileLatencies, frameLatencies;
+        std::string reply;
+        for (const auto& fileName : fileNames)
+        {
+            cv::Mat img = cv::imread(fileName, cv::IMREAD_COLOR);
+            std::string path = fs::absolute(fs::path(fileName)).string();
+
+            for (int round = 0; round < nbRounds; ++round)
+            {
+                int64 start = cv::getTickCount();
+                if (!client.analyseFile(path, reply))
+                {
+                    std::cerr << "Error: The server stopped answering" << std::endl;
+                    return -1;
+                }
+                fileLatencies.push_back((cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency());
+
+                start = cv::getTickCount();
+                if (!img.empty() && client.analyseFrame(img, reply))
+                {
+                    frameLatencies.push_back((cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency());
+                }
+            }
+        }
+
+        auto percentile = [](std::vector<double>& latencies, double rank)
+        {
+            if (latencies.empty())
+            {
+                return 0.0;
+            }
+            size_t index = std::min(latencies.size() - 1, static_cast<size_t>(rank * latencies.size()));
+            std::nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+            return latencies[index];
+        };
+
+        std::cout << "Request, Count, p50 (ms), p99 (ms), Max (ms)" << std::endl;
+        for (auto* latencies : {&fileLatencies, &frameLatencies})
+        {
+            std::cout << (latencies == &fileLatencies ? "File" : "Shared frame") << ", " << latencies->size() << ", "
+                      << percentile(*latencies, 0.5) << ", " << percentile(*latencies, 0.99) << ", " 
+                      << percentile(*latencies, 1.0) << std::endl;
+        }
+        return 0;
+    }
+}
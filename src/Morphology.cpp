@@ -0,0 +1,341 @@
+#include "Morphology.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace idl
+{
+    namespace morphology
+    {
+        /**
+         * @return the extremum of two values: the maximum for a dilation, the minimum for an erosion
+         */
+        template <bool IsMax>
+        inline uint8_t extremum(uint8_t iA, uint8_t iB)
+        {
+            return IsMax ? std::max(iA, iB) : std::min(iA, iB);
+        }
+
+        /**
+         * @return the value of the pixels outside the image, which never wins (OpenCV default border)
+         */
+        template <bool IsMax>
+        constexpr uint8_t neutral()
+        {
+            return IsMax ? 0 : 255;
+        }
+
+        /**
+         * Extremum of a window sliding along each row:
+         * oDst(x, y) = extremum of iSrc(x - iAnchor .. x - iAnchor + iLength - 1, y).
+         * The padded row is cut in blocks of the window length; the extremum from the block start
+         * (prefix) and to the block end (suffix) give any window from two values.
+         * @param iSrc the input mask
+         * @param oDst the filtered mask, may be the input
+         * @param iLength the length of the window
+         * @param iAnchor the position of the pixel in its window
+         */
+        template <bool IsMax>
+        void filterRows(const cv::Mat& iSrc, cv::Mat& oDst, int iLength, int iAnchor)
+        {
+            oDst.create(iSrc.rows, iSrc.cols, CV_8UC1);
+            int width = iSrc.cols;
+            int padded = width + iLength - 1;
+
+            // Part of the padded row covered by the image
+            int begin = std::min(std::max(iAnchor, 0), padded);
+            int end   = std::min(std::max(iAnchor + width, 0), padded);
+
+            cv::parallel_for_(cv::Range(0, iSrc.rows), [&](const cv::Range& iRows)
+            {
+                std::vector<uint8_t> line(padded), prefix(padded), suffix(padded);
+                for (int y = iRows.start; y < iRows.end; ++y)
+                {
+                    std::fill(line.begin(), line.end(), neutral<IsMax>());
+                    if (end > begin)
+                    {
+                        std::memcpy(line.data() + begin, iSrc.ptr<uint8_t>(y) + begin - iAnchor, end - begin);
+                    }
+
+                    for (int block = 0; block < padded; block += iLength)
+                    {
+                        int blockEnd = std::min(block + iLength, padded);
+                        prefix[block] = line[block];
+                        for (int j = block + 1; j < blockEnd; ++j)
+                        {
+                            prefix[j] = extremum<IsMax>(prefix[j - 1], line[j]);
+                        }
+                        suffix[blockEnd - 1] = line[blockEnd - 1];
+                        for (int j = blockEnd - 2; j >= block; --j)
+                        {
+                            suffix[j] = extremum<IsMax>(suffix[j + 1], line[j]);
+                        }
+                    }
+
+                    uint8_t* out = oDst.ptr<uint8_t>(y);
+                    for (int x = 0; x < width; ++x)
+                    {
+                        out[x] = extremum<IsMax>(suffix[x], prefix[x + iLength - 1]);
+                    }
+                }
+            });
+        }
+
+        /**
+         * Extremum of a window sliding along each column, as filterRows() with whole rows
+         * as elements so that the memory is read in order.
+         * @param iSrc the input mask
+         * @param oDst the filtered mask, may be the input
+         * @param iLength the length of the window
+         * @param iAnchor the position of the pixel in its window
+         */
+        template <bool IsMax>
+        void filterColumns(const cv::Mat& iSrc, cv::Mat& oDst, int iLength, int iAnchor)
+        {
+            int rows = iSrc.rows;
+            int padded = rows + iLength - 1;
+
+            // Kept from one call to the next
+            thread_local cv::Mat prefix, suffix;
+            thread_local std::vector<uint8_t> border;
+            prefix.create(padded, iSrc.cols, CV_8UC1);
+            suffix.create(padded, iSrc.cols, CV_8UC1);
+            border.assign(iSrc.cols, neutral<IsMax>());
+
+            // The workers use the buffers of the calling thread
+            cv::Mat& prefixes = prefix;
+            cv::Mat& suffixes = suffix;
+            const uint8_t* outside = border.data();
+            auto line = [&](int j)
+            {
+                int y = j - iAnchor;
+                return (y >= 0 && y < rows) ? iSrc.ptr<uint8_t>(y) : outside;
+            };
+
+            // Each thread owns a slice of the columns, read and written only by it
+            oDst.create(iSrc.rows, iSrc.cols, CV_8UC1);
+            cv::parallel_for_(cv::Range(0, iSrc.cols), [&](const cv::Range& iColumns)
+            {
+                int first = iColumns.start, last = iColumns.end;
+                for (int j = 0; j < padded; ++j)
+                {
+                    const uint8_t* in = line(j);
+                    uint8_t* p = prefixes.ptr<uint8_t>(j);
+                    if (0 == j % iLength)
+                    {
+                        std::memcpy(p + first, in + first, last - first);
+                        continue;
+                    }
+                    const uint8_t* previous = prefixes.ptr<uint8_t>(j - 1);
+                    for (int x = first; x < last; ++x)
+                    {
+                        p[x] = extremum<IsMax>(previous[x], in[x]);
+                    }
+                }
+                for (int j = padded - 1; j >= 0; --j)
+                {
+                    const uint8_t* in = line(j);
+                    uint8_t* s = suffixes.ptr<uint8_t>(j);
+                    if (j == padded - 1 || iLength - 1 == j % iLength)
+                    {
+                        std::memcpy(s + first, in + first, last - first);
+                        continue;
+                    }
+                    const uint8_t* next = suffixes.ptr<uint8_t>(j + 1);
+                    for (int x = first; x < last; ++x)
+                    {
+                        s[x] = extremum<IsMax>(next[x], in[x]);
+                    }
+                }
+                for (int y = 0; y < rows; ++y)
+                {
+                    const uint8_t* s = suffixes.ptr<uint8_t>(y);
+                    const uint8_t* p = prefixes.ptr<uint8_t>(y + iLength - 1);
+                    uint8_t* out = oDst.ptr<uint8_t>(y);
+                    for (int x = first; x < last; ++x)
+                    {
+                        out[x] = extremum<IsMax>(s[x], p[x]);
+                    }
+                }
+            }, std::max(1, iSrc.cols / 256));
+        }
+
+        /**
+         * Erode or dilate with a rectangle, as a row pass then a column pass.
+         * @param iSrc the input mask
+         * @param oDst the mask after, may be the input
+         * @param iSize the size of the rectangle
+         * @param iAnchor the position of the pixel in the rectangle
+         */
+        template <bool IsMax>
+        void filterRect(const cv::Mat& iSrc, cv::Mat& oDst, cv::Size iSize, cv::Point iAnchor)
+        {
+            thread_local cv::Mat filtered;
+            const cv::Mat* rows = &iSrc;
+            if (iSize.width > 1)
+            {
+                filterRows<IsMax>(iSrc, filtered, iSize.width, iAnchor.x);
+                rows = &filtered;
+            }
+
+            if (iSize.height > 1)
+            {
+                filterColumns<IsMax>(*rows, oDst, iSize.height, iAnchor.y);
+            }
+            else
+            {
+                rows->copyTo(oDst);
+            }
+        }
+
+        /**
+         * Erode or dilate with a structuring element made of one run of pixels per row, as an ellipse:
+         * a row pass per distinct run, then the extremum over the element rows.
+         * @param iSrc the input mask
+         * @param oDst the mask after, may be the input
+         * @param iElement the structuring element, anchored at its center
+         */
+        template <bool IsMax>
+        void filterRowRuns(const cv::Mat& iSrc, cv::Mat& oDst, const cv::Mat& iElement)
+        {
+            cv::Point anchor(iElement.cols / 2, iElement.rows / 2);
+
+            // Run of each element row, rows sharing a run share its filtered image
+            std::map<std::pair<int, int>, cv::Mat> filtered;
+            std::vector<std::pair<int, const cv::Mat*>> runs;   //< element row, filtered image
+            for (int r = 0; r < iElement.rows; ++r)
+            {
+                const uint8_t* row = iElement.ptr<uint8_t>(r);
+                int first = 0;
+                while (first < iElement.cols && 0 == row[first])
+                {
+                    first++;
+                }
+                if (first == iElement.cols)
+                {
+                    continue;
+                }
+                int last = iElement.cols - 1;
+                while (0 == row[last])
+                {
+                    last--;
+                }
+
+                auto key = std::make_pair(first, last);
+                auto it = filtered.find(key);
+                if (it == filtered.end())
+                {
+                    it = filtered.emplace(key, cv::Mat()).first;
+                    filterRows<IsMax>(iSrc, it->second, last - first + 1, anchor.x - first);
+                }
+                runs.emplace_back(r, &it->second);
+            }
+
+            // The input is not read anymore, the output may replace it
+            oDst.create(iSrc.rows, iSrc.cols, CV_8UC1);
+            int rows = iSrc.rows;
+            cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& iRows)
+            {
+                for (int y = iRows.start; y < iRows.end; ++y)
+                {
+                    uint8_t* out = oDst.ptr<uint8_t>(y);
+                    std::fill(out, out + oDst.cols, neutral<IsMax>());
+                    for (const auto& run : runs)
+                    {
+                        int sy = y + run.first - anchor.y;
+                        if (sy < 0 || sy >= rows)
+                        {
+                            continue;
+                        }
+                        const uint8_t* in = run.second->ptr<uint8_t>(sy);
+                        for (int x = 0; x < oDst.cols; ++x)
+                        {
+                            out[x] = extremum<IsMax>(out[x], in[x]);
+                        }
+                    }
+                }
+            });
+        }
+
+        /**
+         * Erode or dilate a mask, the iterations of a rectangle being folded into one rectangle.
+         * @param iSrc the input mask
+         * @param oDst the mask after, may be the input
+         * @param iShape the shape of the structuring element
+         * @param iSize the size of the structuring element
+         * @param iIterations the number of operations
+         */
+        template <bool IsMax>
+        void filter(const cv::Mat& iSrc, cv::Mat& oDst, Shape iShape, cv::Size iSize, int iIterations)
+        {
+            if (iIterations <= 0 || iSize.width < 1 || iSize.height < 1 || (1 == iSize.width && 1 == iSize.height))
+            {
+                iSrc.copyTo(oDst);
+                return;
+            }
+
+            int shape = Shape::rect == iShape ? cv::MORPH_RECT : cv::MORPH_ELLIPSE;
+            if (CV_8UC1 != iSrc.type())
+            {
+                cv::Mat element = cv::getStructuringElement(shape, iSize);
+                if (IsMax)
+                {
+                    cv::dilate(iSrc, oDst, element, cv::Point(-1, -1), iIterations);
+                }
+                else
+                {
+                    cv::erode(iSrc, oDst, element, cv::Point(-1, -1), iIterations);
+                }
+                return;
+            }
+
+            if (Shape::rect == iShape)
+            {
+                // n windows of length k in a row cover (k - 1) * n + 1 pixels
+                cv::Size size((iSize.width - 1) * iIterations + 1, (iSize.height - 1) * iIterations + 1);
+                cv::Point anchor(iSize.width / 2 * iIterations, iSize.height / 2 * iIterations);
+                filterRect<IsMax>(iSrc, oDst, size, anchor);
+                return;
+            }
+
+            cv::Mat element = cv::getStructuringElement(shape, iSize);
+            filterRowRuns<IsMax>(iSrc, oDst, element);
+            for (int i = 1; i < iIterations; ++i)
+            {
+                filterRowRuns<IsMax>(oDst, oDst, element);
+            }
+        }
+
+        void dilate(const cv::Mat& iSrc, cv::Mat& oDst, Shape iShape, cv::Size iSize, int iIterations)
+        {
+            filter<true>(iSrc, oDst, iShape, iSize, iIterations);
+        }
+
+        void erode(const cv::Mat& iSrc, cv::Mat& oDst, Shape iShape, cv::Size iSize, int iIterations)
+        {
+            filter<false>(iSrc, oDst, iShape, iSize, iIterations);
+        }
+
+        void open(const cv::Mat& iSrc, cv::Mat& oDst, Shape iShape, cv::Size iSize, int iIterations)
+        {
+            filter<false>(iSrc, oDst, iShape, iSize, iIterations);
+            filter<true>(oDst, oDst, iShape, iSize, iIterations);
+        }
+
+        void close(const cv::Mat& iSrc, cv::Mat& oDst, Shape iShape, cv::Size iSize, int iIterations)
+        {
+            filter<true>(iSrc, oDst, iShape, iSize, iIterations);
+            filter<false>(oDst, oDst, iShape, iSize, iIterations);
+        }
+
+        void openThenDilate(const cv::Mat& iSrc, cv::Mat& oDst, cv::Size iSize, int iDilateIterations)
+        {
+            // The dilation closing the opening and the following ones are a single dilation
+            filter<false>(iSrc, oDst, Shape::rect, iSize, 1);
+            filter<true>(oDst, oDst, Shape::rect, iSize, 1 + std::max(0, iDilateIterations));
+        }
+    }
+}
@@ -0,0 +1,359 @@
+#include "PerfCounters.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace idl
+{
+    namespace
+    {
+        std::atomic<bool> enabled {false};
+        std::atomic<unsigned> availableEvents {0};  //< bit of each event counted by a thread
+
+        // Rows kept until the CSV is opened, the later ones are written as they complete
+        const size_t maxPendingRows = 65536;
+
+        std::mutex totalsMutex;
+        std::vector<PerfCounters::StageTotals> totals;
+        std::vector<PerfCounters::FrameRow> pendingRows;
+        uint64_t nbDroppedRows = 0;
+        std::ofstream framesFile;
+
+        thread_local std::string currentFrame;
+
+        int64_t nowNs()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /**
+         * Counters of a thread, opened as one group so that they are read with a single call.
+         */
+        class ThreadCounters
+        {
+        public:
+            ThreadCounters()
+            {
+                _slots.fill(-1);
+#ifdef __linux__
+                // Type and config of each event
+                const uint32_t types[PerfCounters::nbEvents] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                    PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_SOFTWARE};
+                const uint64_t configs[PerfCounters::nbEvents] = {PERF_COUNT_HW_CPU_CYCLES,
+                    PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+                    PERF_COUNT_SW_PAGE_FAULTS};
+
+                for (int e = 0; e < PerfCounters::nbEvents; ++e)
+                {
+                    perf_event_attr attr;
+                    std::memset(&attr, 0, sizeof(attr));
+                    attr.size = sizeof(attr);
+                    attr.type = types[e];
+                    attr.config = configs[e];
+                    attr.exclude_kernel = 1;    // allowed with the default perf_event_paranoid
+                    attr.exclude_hv = 1;
+                    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+                    // The first event opened leads the group, the calling thread on any CPU
+                    int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, _leader, 0));
+                    if (fd < 0)
+                    {
+                        continue;
+                    }
+                    if (_leader < 0)
+                    {
+                        _leader = fd;
+                    }
+                    _fds[_nbOpened] = fd;
+                    _slots[e] = _nbOpened++;
+                    availableEvents |= 1u << e;
+                }
+#endif
+            }
+
+            ~ThreadCounters()
+            {
+#ifdef __linux__
+                for (int i = 0; i < _nbOpened; ++i)
+                {
+                    close(_fds[i]);
+                }
+#endif
+            }
+
+            /**
+             * @return if at least one event is counted
+             */
+            bool isOpen() const { return _leader >= 0; }
+
+            /**
+             * Read the counts since the opening, scaled when the group has not always been scheduled.
+             * @param oValues the counts, 0 for the unavailable events
+             */
+            void read(PerfCounters::Values& oValues) const
+            {
+                oValues.fill(0.0);
+#ifdef __linux__
+                if (_leader < 0)
+                {
+                    return;
+                }
+
+                // nr, time enabled, time running, then the value of each event of the group
+                uint64_t buffer[3 + PerfCounters::nbEvents];
+                ssize_t size = ::read(_leader, buffer, sizeof(buffer));
+                if (size < static_cast<ssize_t>(3 * sizeof(uint64_t)) || buffer[2] == 0)
+                {
+                    return;
+                }
+                double scale = static_cast<double>(buffer[1]) / buffer[2];
+                for (int e = 0; e < PerfCounters::nbEvents; ++e)
+                {
+                    if (_slots[e] >= 0 && static_cast<uint64_t>(_slots[e]) < buffer[0])
+                    {
+                        oValues[e] = buffer[3 + _slots[e]] * scale;
+                    }
+                }
+#endif
+            }
+
+        private:
+            int _leader = -1;
+            int _nbOpened = 0;
+            int _fds[PerfCounters::nbEvents] = {};
+            std::array<int, PerfCounters::nbEvents> _slots;  //< position of each event in the group, -1 if unavailable
+        };
+
+        ThreadCounters& threadCounters()
+        {
+            thread_local ThreadCounters counters;
+            return counters;
+        }
+
+        /**
+         * Write a row of the frames CSV, the columns of the unavailable events left empty.
+         */
+        void writeRow(std::ostream& oStream, const PerfCounters::FrameRow& iRow)
+        {
+            oStream << iRow.frame << "," << iRow.stage << "," << iRow.elapsedMs;
+            for (int e = 0; e < PerfCounters::nbEvents; ++e)
+            {
+                oStream << ",";
+                if (PerfCounters::isAvailable(static_cast<PerfCounters::Event>(e)))
+                {
+                    oStream << static_cast<uint64_t>(iRow.values[e]);
+                }
+            }
+            oStream << '\n';
+        }
+    }
+
+    PerfCounters::Scope::Scope(const char* iStage)
+    {
+        if (!enabled.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        _stage = iStage;
+        _startNs = nowNs();
+        threadCounters().read(_start);
+    }
+
+    PerfCounters::Scope::~Scope()
+    {
+        if (!_stage)
+        {
+            return;
+        }
+        Values end;
+        threadCounters().read(end);
+        double elapsedMs = (nowNs() - _startNs) / 1e6;
+
+        FrameRow row;
+        row.frame = currentFrame;
+        row.stage = _stage;
+        row.elapsedMs = elapsedMs;
+        for (int e = 0; e < nbEvents; ++e)
+        {
+            row.values[e] = std::max(0.0, end[e] - _start[e]);  // the scaling of multiplexed counts may go back
+        }
+
+        std::lock_guard<std::mutex> lock(totalsMutex);
+        auto it = totals.begin();
+        while (it != totals.end() && it->name != row.stage)
+        {
+            ++it;
+        }
+        if (it == totals.end())
+        {
+            totals.emplace_back();
+            it = totals.end() - 1;
+            it->name = row.stage;
+        }
+        it->nbCalls++;
+        it->elapsedMs += elapsedMs;
+        for (int e = 0; e < nbEvents; ++e)
+        {
+            it->values[e] += row.values[e];
+        }
+        if (framesFile.is_open())
+        {
+            writeRow(framesFile, row);
+        }
+        else if (pendingRows.size() < maxPendingRows)
+        {
+            pendingRows.push_back(std::move(row));
+        }
+        else
+        {
+            nbDroppedRows++;
+        }
+    }
+
+    PerfCounters::FrameScope::FrameScope(const std::string& iFrame)
+    {
+        if (!enabled.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        _enabled = true;
+        _previous = std::move(currentFrame);
+        currentFrame = iFrame;
+    }
+
+    PerfCounters::FrameScope::~FrameScope()
+    {
+        if (_enabled)
+        {
+            currentFrame = std::move(_previous);
+        }
+    }
+
+    bool PerfCounters::enable()
+    {
+        if (!threadCounters().isOpen())
+        {
+            std::cerr << "Error: Performance counters are not supported (perf_event_open)" << std::endl;
+            return false;
+        }
+        enabled = true;
+        return true;
+    }
+
+    bool PerfCounters::isEnabled()
+    {
+        return enabled;
+    }
+
+    bool PerfCounters::isAvailable(Event iEvent)
+    {
+        return (availableEvents & (1u << iEvent)) != 0;
+    }
+
+    std::vector<PerfCounters::StageTotals> PerfCounters::getTotals()
+    {
+        std::lock_guard<std::mutex> lock(totalsMutex);
+        return totals;
+    }
+
+    void PerfCounters::printReport(std::ostream& oStream)
+    {
+        // Counts as integers, n/a for the events not counted
+        auto count = [&oStream](const Values& iValues, Event iEvent)
+        {
+            if (isAvailable(iEvent))
+            {
+                oStream << static_cast<uint64_t>(iValues[iEvent]);
+            }
+            else
+            {
+                oStream << "n/a";
+            }
+        };
+        auto ratio = [&oStream](const Values& iValues, Event iNum, Event iDen, double iFactor)
+        {
+            if (isAvailable(iNum) && isAvailable(iDen) && iValues[iDen] > 0.0)
+            {
+                oStream << iFactor * iValues[iNum] / iValues[iDen];
+            }
+            else
+            {
+                oStream << "n/a";
+            }
+        };
+
+        oStream << "stage, calls, time (ms), cycles, instructions, IPC, cache misses, cache MPKI, "
+                << "branch misses, branch MPKI, page faults" << std::endl;
+        for (const auto& stage : getTotals())
+        {
+            oStream << stage.name << ", " << stage.nbCalls << ", " << stage.elapsedMs << ", ";
+            count(stage.values, cycles);
+            oStream << ", ";
+            count(stage.values, instructions);
+            oStream << ", ";
+            ratio(stage.values, instructions, cycles, 1.0);
+            oStream << ", ";
+            count(stage.values, cacheMisses);
+            oStream << ", ";
+            ratio(stage.values, cacheMisses, instructions, 1000.0);
+            oStream << ", ";
+            count(stage.values, branchMisses);
+            oStream << ", ";
+            ratio(stage.values, branchMisses, instructions, 1000.0);
+            oStream << ", ";
+            count(stage.values, pageFaults);
+            oStream << std::endl;
+        }
+    }
+
+    bool PerfCounters::openFrames(const std::string& iPath)
+    {
+        std::lock_guard<std::mutex> lock(totalsMutex);
+        if (framesFile.is_open())
+        {
+            return true;
+        }
+        framesFile.open(iPath);
+        if (!framesFile)
+        {
+            std::cerr << "Error: Could not open " << iPath << std::endl;
+            return false;
+        }
+
+        framesFile << "frame,stage,time_ms,cycles,instructions,cache_misses,branch_misses,page_faults\n";
+        for (const auto& row : pendingRows)
+        {
+            writeRow(framesFile, row);
+        }
+        std::vector<FrameRow>().swap(pendingRows);
+        if (nbDroppedRows > 0)
+        {
+            std::cerr << "Warning: " << nbDroppedRows << " row(s) of counters dropped before " << iPath 
+                      << " was opened" << std::endl;
+        }
+        return static_cast<bool>(framesFile);
+    }
+
+    bool PerfCounters::closeFrames()
+    {
+        std::lock_guard<std::mutex> lock(totalsMutex);
+        if (!framesFile.is_open())
+        {
+            return false;
+        }
+        framesFile.close();
+        return !framesFile.fail();
+    }
+}
@@ -1,8 +1,16 @@
 #include "PlantDetector.hpp"
+#include "PlantTracker.hpp"
 #include "Plant.hpp"
 #include "Species.hpp"
+#include "Hash.hpp"
+#include "RangeMask.hpp"
+#include "Morphology.hpp"
+#include "MaskIntegral.hpp"
+#include "PointGrid.hpp"
+#include "PerfCounters.hpp"
 #include <algorithm>
 #include <opencv2/opencv.hpp>
+#include <climits>
 #include <cmath>
 
 using namespace cv;
@@ -10,18 +18,23 @@ using namespace std;
 
 namespace idl
 {
+    // HSV range of the laser line removed before the detection
+    using ElimRange = ColorRange<80, 80, 80, 100, 255, 255>;
+
     /**
      * @brief This method removes a specific color from an image by using mask detection, growth, removal, and then inpainting.
      * 
+     * @tparam Range the HSV range of the color to remove
      * @param in image to be processed
-     * @param min color min 
-     * @param max color max
      * @param morph_size morph kernel size
      * @param inpaint_size inpainting kernel size
      * @return cv::Mat processed image with removed color
      */
-    cv::Mat ElimColor(const cv::Mat& in, Scalar min, Scalar max, int morph_size = 5, int inpaint_size = 5)
+    template <typename Range>
+    cv::Mat ElimColor(const cv::Mat& in, int morph_size = 5, int inpaint_size = 5)
     {
+        PerfCounters::Scope scope("elimColor");
+
         Mat result;
 
         // Convert to HSV color space
@@ -29,11 +42,10 @@ namespace idl
         cvtColor(in, hsv, COLOR_BGR2HSV);
 
         // Remove specified color from the image
-        inRange(hsv, min, max, result);
+        rangeMask<Range>(hsv, result);
 
         // Thicken the mask
-        Mat kernel = getStructuringElement(MORPH_RECT, Size(morph_size, morph_size));
-        dilate(result, result, kernel);
+        morphology::dilate(result, result, morphology::Shape::rect, Size(morph_size, morph_size));
 
         // Invert the mask
         Mat resn;
@@ -49,43 +61,89 @@ namespace idl
         return masked;
     }
 
+    /**
+     * @brief Struct to hold contour information along with computed features and species classification.
+     */
+    struct ContourInfo
+    {
+        int contour;            // index in the contours of the frame
+        Species plantSpecies;
+        double area;
+        double score;
+        cv::Rect boundingBox;
+        cv::Point2f center;
+        bool isTracked = false; // classification reused from the previous image
+    };
+
+    /**
+     * @brief A group of contours, its points being a span of the point arena of the frame.
+     */
+    struct ContourGroup
+    {
+        size_t first;   // first point in the arena
+        size_t count;   // number of points
+        double score;   // score of the contours, weighted by their area
+    };
+
     /**
      * @brief This method groups together a set of contours.
      * 
-     * @param contours contour to be grouped
-     * @param groupedContours grouped contours
+     * @param contours contours of the frame
+     * @param infos description of the contours of the frame
+     * @param members indices in infos of the contours to be grouped
      * @param maxDistance maximum distance between two contours
+     * @param points point arena, the points of each group are appended in order
+     * @param groupedContours grouped contours, appended
      */
-    void groupContours(const vector<vector<Point>>& contours, vector<vector<Point>>& groupedContours, double maxDistance)
+    void groupContours(const vector<vector<Point>>& contours, const vector<ContourInfo>& infos, const vector<int>& members, 
+                       double maxDistance, vector<Point>& points, vector<ContourGroup>& groupedContours)
     {
-        vector<bool> visited(contours.size(), false);
+        PerfCounters::Scope scope("groupContours");
+
+        thread_local vector<bool> visited;
+        visited.assign(members.size(), false);
 
-        for (size_t i = 0; i < contours.size(); ++i)
+        for (size_t i = 0; i < members.size(); ++i)
         {
             if (visited[i])
                 continue;
 
-            vector<Point> group = contours[i];
+            const ContourInfo& info_i = infos[members[i]];
+            ContourGroup group = {points.size(), 0, 0.0};
+            const vector<Point>& contour_i = contours[info_i.contour];
+            points.insert(points.end(), contour_i.begin(), contour_i.end());
             visited[i] = true;
+            double scoreSum = info_i.score * info_i.area;
+            double areaSum = info_i.area;
+            double plainSum = info_i.score;
+            size_t nbMembers = 1;
 
-            Rect rect_i = boundingRect(contours[i]);
+            const Rect& rect_i = info_i.boundingBox;
 
-            for (size_t j = i + 1; j < contours.size(); ++j)
+            for (size_t j = i + 1; j < members.size(); ++j)
             {
                 if (visited[j])
                     continue;
 
-                Rect rect_j = boundingRect(contours[j]);
+                const ContourInfo& info_j = infos[members[j]];
+                const Rect& rect_j = info_j.boundingBox;
 
                 // Check if contours are close or overlapping
                 double distance = norm((rect_i.tl() + rect_i.br()) * 0.5 - (rect_j.tl() + rect_j.br()) * 0.5);
 
                 if ((rect_i & rect_j).area() > 0 || distance < maxDistance)
                 {
-                    group.insert(group.end(), contours[j].begin(), contours[j].end());
+                    const vector<Point>& contour_j = contours[info_j.contour];
+                    points.insert(points.end(), contour_j.begin(), contour_j.end());
                     visited[j] = true;
+                    scoreSum += info_j.score * info_j.area;
+                    areaSum += info_j.area;
+                    plainSum += info_j.score;
+                    nbMembers++;
                 }
             }
+            group.count = points.size() - group.first;
+            group.score = areaSum > 0.0 ? scoreSum / areaSum : plainSum / nbMembers;
             groupedContours.push_back(group);
         }
     }
@@ -120,8 +178,112 @@ namespace idl
         double aspectRatioMax;
         double groupMaxDistance;
     };
+
+    struct EdgeParams
+    {
+        int lowThreshold;
+        int highThreshold;
+        int dilateSize;
+        int erodeSize;
+    };
+    //----------------------------------------------------------------------------------------------------
+
+    /// -------------------------------Production values of the filter settings--------------------------------
+    const double         defaultWheatScoreThreshold = 4.0;
+    constexpr AdvantisParams defaultAdvantisParams  = {96, 0, 0, 179, 253, 109, 2, 2, 50.0, 0.0};
+    constexpr WheatParams    defaultWheatParams     = {0, 82, 123, 240, 131, 134, 3, 2, 500.0, 0.2, 5.0, 50.0};
+    const EdgeParams     defaultEdgeParams          = {22, 64, 13, 16};
+
+    // Production color ranges, tested with compile-time bounds
+    using AdvantisRange = ColorRange<defaultAdvantisParams.inRangeMinH, defaultAdvantisParams.inRangeMinS, 
+                                     defaultAdvantisParams.inRangeMinV, defaultAdvantisParams.inRangeMaxH, 
+                                     defaultAdvantisParams.inRangeMaxS, defaultAdvantisParams.inRangeMaxV>;
+    using WheatRange    = ColorRange<defaultWheatParams.min_L, defaultWheatParams.min_a, defaultWheatParams.min_b, 
+                                     defaultWheatParams.max_L, defaultWheatParams.max_a, defaultWheatParams.max_b>;
+
+    // Version of the detection, to bump when the algorithm changes the results
+    const uint64_t       plantDetectorVersion       = 1;
+    //----------------------------------------------------------------------------------------------------
+
+    /**
+     * @brief Scale a kernel size for an image reduced by a downscale factor.
+     * 
+     * @param size The kernel size at full resolution
+     * @param downscale The reduction factor of the image
+     * @return int The kernel size for the reduced image, at least 1
+     */
+    int scaleKernelSize(int size, int downscale)
+    {
+        return std::max(1, static_cast<int>(std::lround(static_cast<double>(size) / downscale)));
+    }
+
+    /// -------------------------------Filter settings for a reduced image--------------------------------
+    AdvantisParams scaleParams(AdvantisParams params, int downscale)
+    {
+        params.morphOpenSize = scaleKernelSize(params.morphOpenSize, downscale);
+        params.areaThreshold /= downscale * downscale;
+        params.groupMaxDistance /= downscale;
+        return params;
+    }
+
+    WheatParams scaleParams(WheatParams params, int downscale)
+    {
+        params.morphKernelSize = scaleKernelSize(params.morphKernelSize, downscale);
+        params.areaThreshold /= downscale * downscale;
+        params.groupMaxDistance /= downscale;
+        return params;
+    }
+
+    EdgeParams scaleParams(EdgeParams params, int downscale)
+    {
+        params.dilateSize = scaleKernelSize(params.dilateSize, downscale);
+        params.erodeSize = scaleKernelSize(params.erodeSize, downscale);
+        return params;
+    }
     //----------------------------------------------------------------------------------------------------
 
+    /// -------------------------------Whether the color ranges are the production ones--------------------------------
+    bool hasDefaultRange(const AdvantisParams& params)
+    {
+        const AdvantisParams& ref = defaultAdvantisParams;
+        return params.inRangeMinH == ref.inRangeMinH && params.inRangeMinS == ref.inRangeMinS 
+            && params.inRangeMinV == ref.inRangeMinV && params.inRangeMaxH == ref.inRangeMaxH 
+            && params.inRangeMaxS == ref.inRangeMaxS && params.inRangeMaxV == ref.inRangeMaxV;
+    }
+
+    bool hasDefaultRange(const WheatParams& params)
+    {
+        const WheatParams& ref = defaultWheatParams;
+        return params.min_L == ref.min_L && params.min_a == ref.min_a && params.min_b == ref.min_b 
+            && params.max_L == ref.max_L && params.max_a == ref.max_a && params.max_b == ref.max_b;
+    }
+    //----------------------------------------------------------------------------------------------------
+
+    /**
+     * @brief Detect the plant edges: Canny edges grown then shrunk to keep the textured regions.
+     * 
+     * @param masked The input image with the laser line removed
+     * @param params The edge detection parameters
+     * @return cv::Mat Edge mask
+     */
+    cv::Mat detectEdges(const cv::Mat& masked, const EdgeParams& params)
+    {
+        PerfCounters::Scope scope("detectEdges");
+
+        cv::Mat grayMasked;
+        cv::cvtColor(masked, grayMasked, cv::COLOR_BGR2GRAY);
+        cv::Mat edges;
+        cv::Canny(grayMasked, edges, params.lowThreshold, params.highThreshold);
+
+        // Dilate the edges
+        morphology::dilate(edges, edges, morphology::Shape::rect, cv::Size(params.dilateSize, params.dilateSize));
+
+        // Erode the edges
+        morphology::erode(edges, edges, morphology::Shape::rect, cv::Size(params.erodeSize, params.erodeSize));
+
+        return edges;
+    }
+
     /**
      * @brief Detect advantis plants in the image without grouping contours.
      * 
@@ -131,33 +293,89 @@ namespace idl
      */
     cv::Mat detectAdvantis(const cv::Mat& masked, const AdvantisParams& params)
     {
+        PerfCounters::Scope scope("detectAdvantis");
+
         cv::Mat ranged_advantis;
-        cv::inRange(masked,
-                    cv::Scalar(params.inRangeMinH, params.inRangeMinS, params.inRangeMinV),
-                    cv::Scalar(params.inRangeMaxH, params.inRangeMaxS, params.inRangeMaxV),
-                    ranged_advantis);
+        if (hasDefaultRange(params))
+        {
+            rangeMask<AdvantisRange>(masked, ranged_advantis);
+        }
+        else
+        {
+            // Range tuned with the sliders
+            cv::inRange(masked,
+                        cv::Scalar(params.inRangeMinH, params.inRangeMinS, params.inRangeMinV),
+                        cv::Scalar(params.inRangeMaxH, params.inRangeMaxS, params.inRangeMaxV),
+                        ranged_advantis);
+        }
 
         cv::Mat binary_advantis;
         cv::threshold(ranged_advantis, binary_advantis, 0, 255, cv::THRESH_BINARY);
 
-        cv::Mat kernel_advantis = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(params.morphOpenSize, params.morphOpenSize));
-        cv::morphologyEx(binary_advantis, binary_advantis, cv::MORPH_OPEN, kernel_advantis);
-
-        // Grow the blobs
-        cv::dilate(binary_advantis, binary_advantis, kernel_advantis, cv::Point(-1, -1), params.dilateIterations);
+        // Open, then grow the blobs: a single erosion and a single dilation
+        morphology::openThenDilate(binary_advantis, binary_advantis, 
+                                   cv::Size(params.morphOpenSize, params.morphOpenSize), params.dilateIterations);
 
         return binary_advantis;
     }
 
+    /**
+     * @brief Lookup table of the histogram equalization of a channel, the one cv::equalizeHist applies.
+     * 
+     * @param channel The 8-bit channel
+     * @return cv::Mat The 256 entries table
+     */
+    cv::Mat equalizationTable(const cv::Mat& channel)
+    {
+        int hist[256] = {0};
+        for (int y = 0; y < channel.rows; ++y)
+        {
+            const uchar* row = channel.ptr<uchar>(y);
+            for (int x = 0; x < channel.cols; ++x)
+            {
+                hist[row[x]]++;
+            }
+        }
+
+        cv::Mat table(1, 256, CV_8UC1, cv::Scalar(0));
+        uchar* lut = table.ptr<uchar>();
+        int total = static_cast<int>(channel.total());
+        int i = 0;
+        while (i < 255 && 0 == hist[i])
+        {
+            ++i;
+        }
+
+        // A constant channel is left unchanged
+        if (hist[i] == total)
+        {
+            table.setTo(cv::Scalar(i));
+            return table;
+        }
+
+        float scale = 255.0f / (total - hist[i]);
+        int sum = 0;
+        for (lut[i++] = 0; i < 256; ++i)
+        {
+            sum += hist[i];
+            lut[i] = cv::saturate_cast<uchar>(sum * scale);
+        }
+        return table;
+    }
+
     /**
      * @brief Detect wheat plants in the image without grouping contours.
      * 
      * @param masked The input image with the laser line removed
      * @param params The detection parameters
+     * @param equalization The lookup table equalizing the L channel, computed from the histogram of this image and 
+     *                     returned if empty, otherwise applied as is (same equalization for an area of the frame)
      * @return cv::Mat Detected wheat mask
      */
-    cv::Mat detectWheat(const cv::Mat& masked, const WheatParams& params)
+    cv::Mat detectWheat(const cv::Mat& masked, const WheatParams& params, cv::Mat& equalization)
     {
+        PerfCounters::Scope scope("detectWheat");
+
         // Convert to Lab color space for better color segmentation
         cv::Mat lab;
         cv::cvtColor(masked, lab, cv::COLOR_BGR2Lab);
@@ -167,20 +385,31 @@ namespace idl
         cv::split(lab, lab_channels);
 
         // Apply histogram equalization on the L channel
-        cv::equalizeHist(lab_channels[0], lab_channels[0]);
+        if (equalization.empty())
+        {
+            equalization = equalizationTable(lab_channels[0]);
+        }
+        cv::LUT(lab_channels[0], equalization, lab_channels[0]);
 
         // Merge the channels back
         cv::merge(lab_channels, lab);
 
-        // Threshold to get wheat plants using specified values
+        // Threshold to get wheat plants using specified values, 
+        // the mask is inverted since leaves are black regions
         cv::Mat plantMask_wheat;
-        cv::inRange(lab,
-                    cv::Scalar(params.min_L, params.min_a, params.min_b),
-                    cv::Scalar(params.max_L, params.max_a, params.max_b),
-                    plantMask_wheat);
-
-        // Invert the mask since leaves are black regions
-        cv::bitwise_not(plantMask_wheat, plantMask_wheat);
+        if (hasDefaultRange(params))
+        {
+            rangeMask<WheatRange>(lab, plantMask_wheat, true);
+        }
+        else
+        {
+            // Range tuned with the sliders
+            cv::inRange(lab,
+                        cv::Scalar(params.min_L, params.min_a, params.min_b),
+                        cv::Scalar(params.max_L, params.max_a, params.max_b),
+                        plantMask_wheat);
+            cv::bitwise_not(plantMask_wheat, plantMask_wheat);
+        }
 
         // Adjust morphological operations to remove noise and fill holes
         int morph_kernel_size = params.morphKernelSize;
@@ -190,30 +419,17 @@ namespace idl
         if (morph_kernel_size % 2 == 0) morph_kernel_size += 1;
         if (morph_kernel_size < 1) morph_kernel_size = 1;
 
-        cv::Mat kernel_wheat = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(morph_kernel_size, morph_kernel_size));
+        cv::Size kernel_wheat(morph_kernel_size, morph_kernel_size);
 
         // Apply morphological opening to remove small noise
-        cv::morphologyEx(plantMask_wheat, plantMask_wheat, cv::MORPH_OPEN, kernel_wheat, cv::Point(-1, -1), morph_iterations);
+        morphology::open(plantMask_wheat, plantMask_wheat, morphology::Shape::ellipse, kernel_wheat, morph_iterations);
 
         // Apply morphological closing to fill small holes in the leaves
-        cv::morphologyEx(plantMask_wheat, plantMask_wheat, cv::MORPH_CLOSE, kernel_wheat, cv::Point(-1, -1), morph_iterations);
+        morphology::close(plantMask_wheat, plantMask_wheat, morphology::Shape::ellipse, kernel_wheat, morph_iterations);
 
         return plantMask_wheat;
     }
 
-    /**
-     * @brief Struct to hold contour information along with computed features and species classification.
-     */
-    struct ContourInfo
-    {
-        std::vector<cv::Point> contour;
-        Species plantSpecies;
-        double area;
-        double score;
-        cv::Rect boundingBox;
-        cv::Point2f center;
-    };
-
     /**
      * @brief Struct to hold circle information for debugging purposes.
      */
@@ -232,30 +448,45 @@ namespace idl
      * @param edgeMask The edge mask for filtering
      * @param wheatScoreThreshold The threshold for classifying wheat
      * @param wheatCircles Vector to store circles around wheat centers for debugging
-     * @return std::vector<Plant> The detected and grouped plants
+     * @param tracker The plant tracker of the image sequence, nullptr to classify every contour
+     * @param frameSize The size of the whole frame, the image being an area of it
+     * @param frameOffset The position of the image in the whole frame
+     * @param pixelScale The size of an image pixel in full resolution pixels, the pixel constants are scaled accordingly
+     * @return std::vector<Plant> The detected and grouped plants, in the image coordinates
      */
-    std::vector<Plant> processCombinedMask(const cv::Mat& combinedMask, const cv::Mat& image, const cv::Mat& edgeMask, double wheatScoreThreshold, std::vector<Circle>& wheatCircles)
+    std::vector<Plant> processCombinedMask(const cv::Mat& combinedMask, const cv::Mat& image, const cv::Mat& edgeMask, double wheatScoreThreshold, std::vector<Circle>& wheatCircles, PlantTracker* tracker, const cv::Size& frameSize, const cv::Point& frameOffset, double pixelScale)
     {
-        std::vector<std::vector<cv::Point>> contours_combined;
+        PerfCounters::Scope scope("processCombinedMask");
+
+        // The buffers of the frame keep their memory for the next one
+        thread_local std::vector<std::vector<cv::Point>> contours_combined;
         cv::findContours(combinedMask, contours_combined, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
 
         // **Prepare ContourInfo Objects**
-        std::vector<ContourInfo> contourInfos;
+        thread_local std::vector<ContourInfo> contourInfos;
+        contourInfos.clear();
 
-        double centerLineX = image.cols / 2.0;
-        double centerLineThreshold = image.cols * 0.3; // Adjust as needed
+        // Areas and distances are compared in full resolution pixels
+        double pixelArea = pixelScale * pixelScale;
+
+        // The scoring relies on the whole frame geometry
+        double centerLineX = frameSize.width / 2.0 - frameOffset.x;
+        double centerLineThreshold = frameSize.width * pixelScale * 0.3; // Adjust as needed
 
         // Image diagonal length
-        double imageDiagonal = std::sqrt(image.cols * image.cols + image.rows * image.rows);
+        double imageDiagonal = std::sqrt(frameSize.width * frameSize.width + frameSize.height * frameSize.height);
         double proximityThreshold = 0.04 * imageDiagonal; // 4% of image diagonal
 
         // First pass: classify plants and store advantis centers
-        std::vector<cv::Point2f> advantisCenters;
+        thread_local std::vector<cv::Point2f> advantisCenters;
+        thread_local std::vector<cv::Point> hull;
+        advantisCenters.clear();
 
-        for (const auto& contour : contours_combined)
+        for (size_t c = 0; c < contours_combined.size(); ++c)
         {
+            const std::vector<cv::Point>& contour = contours_combined[c];
             ContourInfo info;
-            info.contour = contour;
+            info.contour = static_cast<int>(c);
 
             // Compute bounding box
             info.boundingBox = cv::boundingRect(contour);
@@ -274,14 +505,30 @@ namespace idl
             }
             info.center = center;
 
-            // **Compute Features for Intelligent Scoring**
-
             // Compute contour area
             double area = cv::contourArea(contour);
-            info.area = area;
+            info.area = area * pixelArea;
+
+            // Reuse the classification of the same blob in the previous image
+            const PlantTracker::Track* track = tracker ? tracker->match(info.boundingBox, info.area) : nullptr;
+            if (track)
+            {
+                info.score = track->score;
+                info.plantSpecies = track->species;
+                info.isTracked = true;
+
+                if (info.plantSpecies == Species::advantis)
+                {
+                    advantisCenters.push_back(center);
+                }
+
+                contourInfos.push_back(info);
+                continue;
+            }
+
+            // **Compute Features for Intelligent Scoring**
 
             // Compute convex hull and solidity
-            std::vector<cv::Point> hull;
             cv::convexHull(contour, hull);
             double hullArea = cv::contourArea(hull);
             double solidity = area / hullArea;
@@ -294,14 +541,14 @@ namespace idl
             double extent = area / boundingBoxArea;
 
             // Compute distance from center line
-            double distanceFromCenter = std::abs(center.x - centerLineX);
+            double distanceFromCenter = std::abs(center.x - centerLineX) * pixelScale;
 
             // Score calculation
             double score = 0.0;
 
             // Size Feature
             //if (area > 400.0)
-                score += area / 400;
+                score += info.area / 400;
 
             // Solidity Feature (wheat leaves may have higher solidity due to heart shape)
             if (solidity > 0.8)
@@ -334,9 +581,13 @@ namespace idl
         }
 
         // **Second pass: Reclassify small plants near advantis as advantis**
+        // The advantis centers are bucketed by cells of the proximity threshold, only the neighbouring cells are tested
+        PointGrid advantisGrid;
+        advantisGrid.build(advantisCenters, static_cast<float>(proximityThreshold));
         for (auto& info : contourInfos)
         {
-            if (info.plantSpecies == Species::wheat)
+            // Tracked contours already went through this pass
+            if (info.plantSpecies == Species::wheat && !info.isTracked)
             {
                 // Check if plant is small
                 if (info.area < 3000.0)
@@ -345,248 +596,310 @@ namespace idl
                     if (info.score < wheatScoreThreshold + 1.0)
                     {
                         // Check proximity to any advantis plant
-                        for (const auto& advCenter : advantisCenters)
+                        bool isNearAdvantis = advantisGrid.visit(info.center, static_cast<float>(proximityThreshold), [&](int i)
+                        {
+                            double distance = cv::norm(info.center - advantisCenters[i]);
+                            return distance < proximityThreshold;
+                        });
+                        if (isNearAdvantis)
                         {
-                            double distance = cv::norm(info.center - advCenter);
-                            if (distance < proximityThreshold)
-                            {
-                                // Reclassify as advantis
-                                info.plantSpecies = Species::advantis;
-                                break;
-                            }
+                            // Reclassify as advantis
+                            info.plantSpecies = Species::advantis;
                         }
                     }
                 }
             }
         }
 
+        // Keep the classification for the next image
+        if (tracker)
+        {
+            std::vector<PlantTracker::Track> tracks;
+            tracks.reserve(contourInfos.size());
+            for (const auto& info : contourInfos)
+            {
+                tracks.push_back({info.boundingBox, info.area, info.score, info.plantSpecies});
+            }
+            tracker->update(std::move(tracks));
+        }
+
         // **Group Contours by Species**
-        std::vector<std::vector<cv::Point>> wheatContours;
-        std::vector<std::vector<cv::Point>> advantisContours;
+        thread_local std::vector<int> wheatContours, advantisContours;
+        wheatContours.clear();
+        advantisContours.clear();
+        size_t nbPoints = 0;
 
-        for (const auto& info : contourInfos)
+        for (size_t i = 0; i < contourInfos.size(); ++i)
         {
+            const ContourInfo& info = contourInfos[i];
+            nbPoints += contours_combined[info.contour].size();
             if (info.plantSpecies == Species::wheat)
             {
-                wheatContours.push_back(info.contour);
+                wheatContours.push_back(static_cast<int>(i));
             }
             else if (info.plantSpecies == Species::advantis)
             {
-                advantisContours.push_back(info.contour);
+                advantisContours.push_back(static_cast<int>(i));
             }
         }
 
         // **Perform Species-Aware Grouping**
-        std::vector<std::vector<cv::Point>> groupedWheatContours;
-        std::vector<std::vector<cv::Point>> groupedAdvantisContours;
-
-        double wheatGroupMaxDistance = 50.0;    // Adjust as needed
-        double advantisGroupMaxDistance = 30.0; // Adjust as needed
+        // The points of the groups are copied once, into an arena holding every point of the frame
+        thread_local std::vector<cv::Point> points;
+        thread_local std::vector<ContourGroup> groups;
+        points.clear();
+        points.reserve(nbPoints);
+        groups.clear();
 
-        groupContours(wheatContours, groupedWheatContours, wheatGroupMaxDistance);
-        groupContours(advantisContours, groupedAdvantisContours, advantisGroupMaxDistance);
+        double wheatGroupMaxDistance = 50.0 / pixelScale;    // Adjust as needed
+        double advantisGroupMaxDistance = 30.0 / pixelScale; // Adjust as needed
 
-        // **Create Plant Objects from Grouped Contours**
-        std::vector<Plant> plants;
+        groupContours(contours_combined, contourInfos, wheatContours, wheatGroupMaxDistance, points, groups);
+        size_t nbWheat = groups.size();
+        groupContours(contours_combined, contourInfos, advantisContours, advantisGroupMaxDistance, points, groups);
 
-        // Process grouped wheat contours
-        for (const auto& contourGroup : groupedWheatContours)
+        auto groupPoints = [](const ContourGroup& group)
         {
-            Plant plant;
-
-            // Compute bounding box
-            cv::Rect boundingBox = cv::boundingRect(contourGroup);
-
-            // Ensure bounding box is within image boundaries
-            boundingBox &= cv::Rect(0, 0, image.cols, image.rows);
-
-            plant.boundingBox = boundingBox;
-
-            // Extract plant image and mask
-            plant.plantImg = image(boundingBox);
+            return cv::Mat(static_cast<int>(group.count), 1, CV_32SC2, points.data() + group.first);
+        };
 
-            // Create mask
-            cv::Mat plantMask = cv::Mat::zeros(boundingBox.size(), CV_8UC1);
-
-            // Shift contour points to ROI coordinates
-            std::vector<std::vector<cv::Point>> shiftedContours(1);
-            for (const auto& pt : contourGroup)
-            {
-                shiftedContours[0].push_back(cv::Point(pt.x - boundingBox.x, pt.y - boundingBox.y));
-            }
-
-            // Draw contour onto mask
-            cv::drawContours(plantMask, shiftedContours, -1, cv::Scalar(255), cv::FILLED);
-
-            plant.mask = plantMask;
-
-            // Compute center
-            cv::Moments m = cv::moments(contourGroup);
+        // **Describe the grouped contours, the wheat ones first**
+        struct Candidate
+        {
+            cv::Rect boundingBox;
             cv::Point2f center;
-            if (m.m00 != 0)
-            {
-                center = cv::Point2f(static_cast<float>(m.m10 / m.m00), static_cast<float>(m.m01 / m.m00));
-                plant.center = cv::Vec2d(center.x, center.y);
-            }
-            else
-            {
-                center = cv::Point2f(boundingBox.x + boundingBox.width / 2.0f,
-                                     boundingBox.y + boundingBox.height / 2.0f);
-                plant.center = cv::Vec2d(center.x, center.y);
-            }
-
-            plant.position = cv::Vec2d(static_cast<double>(boundingBox.x),
-                                       static_cast<double>(boundingBox.y));
-
-            plant.plantSpecies = Species::wheat;
+            float area;         // full resolution pixels
+            float score;
+        };
+        thread_local std::vector<Candidate> candidates;
+        candidates.clear();
 
-            // Compute area (optional)
-            plant.area = cv::contourArea(contourGroup);
-
-            plants.push_back(plant);
-        }
-
-        // Process grouped advantis contours
-        for (const auto& contourGroup : groupedAdvantisContours)
+        for (const auto& group : groups)
         {
-            Plant plant;
-
-            // Compute bounding box
-            cv::Rect boundingBox = cv::boundingRect(contourGroup);
-
-            // Ensure bounding box is within image boundaries
-            boundingBox &= cv::Rect(0, 0, image.cols, image.rows);
-
-            plant.boundingBox = boundingBox;
-
-            // Extract plant image and mask
-            plant.plantImg = image(boundingBox);
-
-            // Create mask
-            cv::Mat plantMask = cv::Mat::zeros(boundingBox.size(), CV_8UC1);
-
-            // Shift contour points to ROI coordinates
-            std::vector<std::vector<cv::Point>> shiftedContours(1);
-            for (const auto& pt : contourGroup)
-            {
-                shiftedContours[0].push_back(cv::Point(pt.x - boundingBox.x, pt.y - boundingBox.y));
-            }
-
-            // Draw contour onto mask
-            cv::drawContours(plantMask, shiftedContours, -1, cv::Scalar(255), cv::FILLED);
+            cv::Mat contourGroup = groupPoints(group);
+            Candidate candidate;
 
-            plant.mask = plantMask;
+            // Compute bounding box, within image boundaries
+            candidate.boundingBox = cv::boundingRect(contourGroup) & cv::Rect(0, 0, image.cols, image.rows);
 
             // Compute center
             cv::Moments m = cv::moments(contourGroup);
-            cv::Point2f center;
             if (m.m00 != 0)
             {
-                center = cv::Point2f(static_cast<float>(m.m10 / m.m00), static_cast<float>(m.m01 / m.m00));
-                plant.center = cv::Vec2d(center.x, center.y);
+                candidate.center = cv::Point2f(static_cast<float>(m.m10 / m.m00), static_cast<float>(m.m01 / m.m00));
             }
             else
             {
-                center = cv::Point2f(boundingBox.x + boundingBox.width / 2.0f,
-                                     boundingBox.y + boundingBox.height / 2.0f);
-                plant.center = cv::Vec2d(center.x, center.y);
+                candidate.center = cv::Point2f(candidate.boundingBox.x + candidate.boundingBox.width / 2.0f,
+                                               candidate.boundingBox.y + candidate.boundingBox.height / 2.0f);
             }
 
-            plant.position = cv::Vec2d(static_cast<double>(boundingBox.x),
-                                       static_cast<double>(boundingBox.y));
-
-            plant.plantSpecies = Species::advantis;
-
-            // Compute area (optional)
-            plant.area = cv::contourArea(contourGroup);
-
-            plants.push_back(plant);
+            // Compute area
+            candidate.area = static_cast<float>(cv::contourArea(contourGroup) * pixelArea);
+            candidate.score = static_cast<float>(group.score);
+            candidates.push_back(candidate);
         }
 
-        // **Separate plants into wheat and advantis plants**
-        std::vector<Plant> wheatPlants;
-        std::vector<Plant> advantisPlants;
-
-        for (const auto& plant : plants)
+        // **Third pass: Remove advantis plants near the centers of wheat plants**
+        thread_local std::vector<cv::Point2f> plantAdvantisCenters;
+        plantAdvantisCenters.clear();
+        float maxRadius = 0.0f;
+        for (size_t i = 0; i < candidates.size(); ++i)
         {
-            if (plant.plantSpecies == Species::wheat)
+            if (i < nbWheat)
             {
-                wheatPlants.push_back(plant);
+                maxRadius = std::max(maxRadius, candidates[i].boundingBox.width / 3.0f / 2.0f);
             }
-            else if (plant.plantSpecies == Species::advantis)
+            else
             {
-                advantisPlants.push_back(plant);
+                plantAdvantisCenters.push_back(candidates[i].center);
             }
         }
 
-        // **Third pass: Remove advantis plants near the centers of wheat plants**
-        std::vector<bool> advantisPlantToRemove(advantisPlants.size(), false);
-
-        for (const auto& wheatPlant : wheatPlants)
+        thread_local PointGrid plantAdvantisGrid;
+        thread_local std::vector<bool> plantToRemove;
+        plantAdvantisGrid.build(plantAdvantisCenters, maxRadius);
+        plantToRemove.assign(candidates.size(), false);
+        for (size_t w = 0; w < nbWheat; ++w)
         {
-            cv::Point2f wheatCenter(wheatPlant.center[0], wheatPlant.center[1]);
+            const cv::Point2f& wheatCenter = candidates[w].center;
 
             // Diameter is a third of the wheat plant's bounding box width
-            float diameter = wheatPlant.boundingBox.width / 3.0f;
+            float diameter = candidates[w].boundingBox.width / 3.0f;
             float radius = diameter / 2.0f;
 
             // Store the circle for debugging
             wheatCircles.push_back({wheatCenter, radius});
 
-            for (size_t i = 0; i < advantisPlants.size(); ++i)
+            plantAdvantisGrid.visit(wheatCenter, radius, [&](int i)
             {
-                const Plant& advantisPlant = advantisPlants[i];
-
-                cv::Point2f advantisCenter(advantisPlant.center[0], advantisPlant.center[1]);
-
                 // Compute distance between centers
-                float distance = cv::norm(wheatCenter - advantisCenter);
-
+                float distance = cv::norm(wheatCenter - plantAdvantisCenters[i]);
                 if (distance <= radius)
                 {
                     // Mark advantisPlant for removal
-                    advantisPlantToRemove[i] = true;
+                    plantToRemove[nbWheat + i] = true;
                 }
-            }
+                return false;
+            });
         }
 
-        // Remove marked advantis plants
-        std::vector<Plant> filteredAdvantisPlants;
-        for (size_t i = 0; i < advantisPlants.size(); ++i)
+        // **Final pass: Remove plants whose bounding boxes do not overlap with the edge mask**
+        // The edge pixels are summed once, each bounding box is then counted from its corners
+        thread_local MaskIntegral edgeIntegral;
+        thread_local std::vector<size_t> kept;
+        edgeIntegral.build(edgeMask);
+        kept.clear();
+        int maskSize = 0;
+        for (size_t i = 0; i < candidates.size(); ++i)
         {
-            if (!advantisPlantToRemove[i])
+            // Check if there are any positive pixels in the edge region, also discard plants that are too big
+            if (!plantToRemove[i] && edgeIntegral.any(candidates[i].boundingBox) && candidates[i].area < 100000)
             {
-                filteredAdvantisPlants.push_back(advantisPlants[i]);
+                kept.push_back(i);
+                maskSize += candidates[i].boundingBox.area();
             }
         }
 
-        // Combine wheat and filtered advantis plants
-        plants.clear();
-        plants.insert(plants.end(), wheatPlants.begin(), wheatPlants.end());
-        plants.insert(plants.end(), filteredAdvantisPlants.begin(), filteredAdvantisPlants.end());
+        // **Create Plant Objects for the kept candidates only**
+        // Their masks share a single buffer
+        std::vector<Plant> plants(kept.size());
+        cv::Mat masks;
+        if (maskSize > 0)
+        {
+            masks = cv::Mat::zeros(1, maskSize, CV_8UC1);
+        }
+        thread_local std::vector<cv::Mat> drawnContours(1);
+        int maskOffset = 0;
+        for (size_t k = 0; k < kept.size(); ++k)
+        {
+            const Candidate& candidate = candidates[kept[k]];
+            const cv::Rect& boundingBox = candidate.boundingBox;
+            Plant& plant = plants[k];
 
-        // **Final pass: Remove plants whose bounding boxes do not overlap with the edge mask**
-        std::vector<Plant> finalPlants;
+            plant.boundingBox = boundingBox;
+
+            // Extract plant image and mask
+            plant.plantImg = image(boundingBox);
+            plant.mask = masks.colRange(maskOffset, maskOffset + boundingBox.area()).reshape(1, boundingBox.height);
+            maskOffset += boundingBox.area();
+
+            // Draw contour onto mask, in ROI coordinates
+            drawnContours[0] = groupPoints(groups[kept[k]]);
+            cv::drawContours(plant.mask, drawnContours, 0, cv::Scalar(255), cv::FILLED, cv::LINE_8, cv::noArray(), INT_MAX, -boundingBox.tl());
+
+            plant.center = cv::Vec2d(candidate.center.x, candidate.center.y);
+            plant.position = cv::Vec2d(static_cast<double>(boundingBox.x),
+                                       static_cast<double>(boundingBox.y));
+            plant.plantSpecies = kept[k] < nbWheat ? Species::wheat : Species::advantis;
+            plant.area = static_cast<float>(candidate.area / pixelArea);   // image pixels, as the center and the box
+            plant.score = candidate.score;
+        }
+
+        return plants;
+    }
+
+    /**
+     * @brief Bring the plants detected on a reduced image back to the full resolution. The bounding boxes are scaled 
+     *        and each mask is rebuilt from the full resolution plant colors lying inside the upsampled coarse mask.
+     *        The colors are segmented once, on the union of the boxes grown by a margin covering the reach of the
+     *        filters, and the L channel is equalized with the table of the whole coarse frame: the masks do not
+     *        depend on the extent of their box. The segmentation still differs slightly from a full resolution
+     *        detection, the equalization being computed on the reduced frame.
+     * 
+     * @param plants The plants detected on the reduced image, updated in place
+     * @param image The full resolution image
+     * @param downscale The reduction factor of the image the plants have been detected on
+     * @param reduction The reduction factor the full resolution image has been decoded with
+     * @param equalization The equalization of the L channel applied to the reduced frame
+     */
+    void refinePlants(std::vector<Plant>& plants, const cv::Mat& image, int downscale, int reduction, const cv::Mat& equalization)
+    {
+        PerfCounters::Scope scope("refinePlants");
+
+        const cv::Rect imageRect(0, 0, image.cols, image.rows);
+        // Larger than the reach of the color removal (dilation and inpainting) and of the morphology
+        const int margin = std::max(8, 64 / reduction);
+
+        cv::Rect area;
         for (const auto& plant : plants)
         {
-            // Extract the edge mask region corresponding to the plant's bounding box
-            cv::Rect bbox = plant.boundingBox & cv::Rect(0, 0, edgeMask.cols, edgeMask.rows);
-            cv::Mat edgeRegion = edgeMask(bbox);
+            const cv::Rect& box = plant.boundingBox;
+            cv::Rect scaledBox(box.x * downscale - margin, box.y * downscale - margin,
+                               box.width * downscale + 2 * margin, box.height * downscale + 2 * margin);
+            area = area.empty() ? scaledBox : (area | scaledBox);
+        }
+        area &= imageRect;
+        if (area.empty())
+        {
+            return;
+        }
 
-            // Check if there are any positive pixels in the edge region, also discard plants that are too big
-            int nonZeroCount = cv::countNonZero(edgeRegion);
-            if (nonZeroCount > 0 && plant.area < 100000)
+        // Full resolution plant colors, once for every plant
+        int elimSize = scaleKernelSize(5, reduction);
+        cv::Mat masked = ElimColor<ElimRange>(image(area), elimSize, elimSize);
+        cv::Mat frameEqualization = equalization;   // applied as is, computed on the area if missing
+        cv::Mat colors;
+        cv::bitwise_or(detectAdvantis(masked, scaleParams(defaultAdvantisParams, reduction)), 
+                       detectWheat(masked, scaleParams(defaultWheatParams, reduction), frameEqualization), colors);
+
+        std::vector<std::vector<cv::Point>> contours;
+        for (auto& plant : plants)
+        {
+            const cv::Rect& coarseBox = plant.boundingBox;
+            cv::Rect scaledBox(coarseBox.x * downscale, coarseBox.y * downscale,
+                               coarseBox.width * downscale, coarseBox.height * downscale);
+            cv::Rect boundingBox = scaledBox & imageRect;
+            if (boundingBox.empty())
+            {
+                continue;
+            }
+
+            // Upsampled coarse mask, grown by one coarse pixel to recover the boundary
+            cv::Mat region;
+            cv::resize(plant.mask, region, scaledBox.size(), 0, 0, cv::INTER_NEAREST);
+            morphology::dilate(region, region, morphology::Shape::rect, cv::Size(2 * downscale + 1, 2 * downscale + 1));
+            region = region(boundingBox - scaledBox.tl());
+
+            cv::Mat plantColors;
+            cv::bitwise_and(colors(boundingBox - area.tl()), region, plantColors);
+
+            // Fill the refined blobs, as the masks built from contours
+            contours.clear();
+            cv::findContours(plantColors, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+            double plantArea = 0.0;
+            if (contours.empty())
             {
-                // Keep the plant
-                finalPlants.push_back(plant);
+                // Nothing left at full resolution, keep the coarse shape
+                plantColors = region;
+                plantArea = cv::countNonZero(region);
             }
             else
             {
-                // Discard the plant (it does not overlap with any edges)
+                plantColors = cv::Mat::zeros(boundingBox.size(), CV_8UC1);
+                cv::drawContours(plantColors, contours, -1, cv::Scalar(255), cv::FILLED);
+                for (const auto& contour : contours)
+                {
+                    plantArea += cv::contourArea(contour);
+                }
             }
-        }
 
-        return finalPlants;
+            plant.boundingBox = boundingBox;
+            plant.mask = plantColors;
+            plant.plantImg = image(boundingBox);
+            plant.position = cv::Vec2d(boundingBox.x, boundingBox.y);
+            plant.area = static_cast<float>(plantArea);
+
+            cv::Moments m = cv::moments(plantColors, true);
+            if (m.m00 != 0)
+            {
+                plant.center = cv::Vec2d(boundingBox.x + m.m10 / m.m00, boundingBox.y + m.m01 / m.m00);
+            }
+            else
+            {
+                plant.center *= static_cast<double>(downscale);
+            }
+        }
     }
 
     /**
@@ -594,25 +907,37 @@ namespace idl
      * 
      * @param img the input image
      * @param enableSliders whether or not you want the debug filtering sliders to appear, useful to fiddle with the values in real time
+     * @param tracker the plant tracker of the image sequence, nullptr to classify every plant
+     * @param area the area of the image to analyze
+     * @param downscale the reduction factor of the image for the segmentation and grouping (coarse-to-fine), 1 for full resolution
+     * @param reduction the reduction factor the image has been decoded with, 1 for full resolution
      * @return std::vector<Plant> The detected plants
      */
-    std::vector<Plant> PlantDetector::detectPlants(const cv::Mat& img, bool enableSliders)
+    std::vector<Plant> detectPlantsInImage(const cv::Mat& img, bool enableSliders, PlantTracker* tracker, const cv::Rect& area, int downscale, int reduction)
     {
-        const double wheatScoreThreshold = 4.0;
-        cv::Mat image = img.clone();
+        const double wheatScoreThreshold = defaultWheatScoreThreshold;
+        cv::Mat image = img(area).clone();
+
+        // Coarse-to-fine: the segmentation and grouping run on the reduced image
+        cv::Mat coarse = image;
+        if (downscale > 1)
+        {
+            cv::resize(image, coarse, cv::Size(), 1.0 / downscale, 1.0 / downscale, cv::INTER_AREA);
+        }
+
+        // Size of a coarse pixel in original image pixels, the filter settings are given at full resolution
+        const int pixelScale = downscale * reduction;
 
         // Remove the laser line
-        cv::Mat masked = ElimColor(image, cv::Scalar(80, 80, 80), cv::Scalar(100, 255, 255), 5, 5);
+        int elimSize = scaleKernelSize(5, pixelScale);
+        cv::Mat masked = ElimColor<ElimRange>(coarse, elimSize, elimSize);
 
         // Initialize default parameters
-        AdvantisParams advantisParams = {96, 0, 0, 179, 253, 109, 2, 2, 50.0, 0.0};
-        WheatParams wheatParams = {0, 82, 123, 240, 131, 134, 3, 2, 500.0, 0.2, 5.0, 50.0};
+        AdvantisParams advantisParams = scaleParams(defaultAdvantisParams, pixelScale);
+        WheatParams wheatParams = scaleParams(defaultWheatParams, pixelScale);
 
         // Edge detection parameters
-        int lowThreshold = 22;
-        int highThreshold = 64;
-        int edgeDilateSize = 13;
-        int edgeErodeSize = 16; // Erosion size parameter
+        EdgeParams edgeParams = scaleParams(defaultEdgeParams, pixelScale);
 
         if (enableSliders)
         {
@@ -650,10 +975,10 @@ namespace idl
             cv::createTrackbar("Wheat Group Max Distance", "Wheat Mask", (int*)&wheatParams.groupMaxDistance, 100);
 
             // Create trackbars for edge detection parameters
-            cv::createTrackbar("Edge Low Threshold", "Edge Mask", &lowThreshold, 255);
-            cv::createTrackbar("Edge High Threshold", "Edge Mask", &highThreshold, 255);
-            cv::createTrackbar("Edge Dilate Size", "Edge Mask", &edgeDilateSize, 20);
-            cv::createTrackbar("Edge Erode Size", "Edge Mask", &edgeErodeSize, 20); // Erosion slider
+            cv::createTrackbar("Edge Low Threshold", "Edge Mask", &edgeParams.lowThreshold, 255);
+            cv::createTrackbar("Edge High Threshold", "Edge Mask", &edgeParams.highThreshold, 255);
+            cv::createTrackbar("Edge Dilate Size", "Edge Mask", &edgeParams.dilateSize, 20);
+            cv::createTrackbar("Edge Erode Size", "Edge Mask", &edgeParams.erodeSize, 20); // Erosion slider
 
             while (true)
             {
@@ -662,33 +987,23 @@ namespace idl
                 wheatParams.aspectRatioMax = cv::getTrackbarPos("Wheat Aspect Ratio Max x100", "Wheat Mask") / 100.0;
 
                 // Update edge detection parameters from trackbars
-                lowThreshold = cv::getTrackbarPos("Edge Low Threshold", "Edge Mask");
-                highThreshold = cv::getTrackbarPos("Edge High Threshold", "Edge Mask");
-                edgeDilateSize = cv::getTrackbarPos("Edge Dilate Size", "Edge Mask");
-                if (edgeDilateSize < 1) edgeDilateSize = 1; // Ensure it's at least 1
+                edgeParams.lowThreshold = cv::getTrackbarPos("Edge Low Threshold", "Edge Mask");
+                edgeParams.highThreshold = cv::getTrackbarPos("Edge High Threshold", "Edge Mask");
+                edgeParams.dilateSize = cv::getTrackbarPos("Edge Dilate Size", "Edge Mask");
+                if (edgeParams.dilateSize < 1) edgeParams.dilateSize = 1; // Ensure it's at least 1
 
-                edgeErodeSize = cv::getTrackbarPos("Edge Erode Size", "Edge Mask");
-                if (edgeErodeSize < 1) edgeErodeSize = 1; // Ensure it's at least 1
+                edgeParams.erodeSize = cv::getTrackbarPos("Edge Erode Size", "Edge Mask");
+                if (edgeParams.erodeSize < 1) edgeParams.erodeSize = 1; // Ensure it's at least 1
 
                 // Perform edge detection
-                cv::Mat grayMasked;
-                cv::cvtColor(masked, grayMasked, cv::COLOR_BGR2GRAY);
-                cv::Mat edges;
-                cv::Canny(grayMasked, edges, lowThreshold, highThreshold);
-
-                // Dilate the edges
-                cv::Mat edgeKernelDilate = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(edgeDilateSize, edgeDilateSize));
-                cv::dilate(edges, edges, edgeKernelDilate);
-
-                // Erode the edges
-                cv::Mat edgeKernelErode = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(edgeErodeSize, edgeErodeSize));
-                cv::erode(edges, edges, edgeKernelErode);
+                cv::Mat edges = detectEdges(masked, edgeParams);
 
                 cv::imshow("Edge Mask", edges);
 
                 // Detect advantis and wheat plants
                 cv::Mat cleanedMask_advantis = detectAdvantis(masked, advantisParams);
-                cv::Mat cleanedMask_wheat = detectWheat(masked, wheatParams);
+                cv::Mat equalization;
+                cv::Mat cleanedMask_wheat = detectWheat(masked, wheatParams, equalization);
 
                 cv::Mat combinedMask;
                 cv::bitwise_or(cleanedMask_advantis, cleanedMask_wheat, combinedMask);
@@ -700,9 +1015,10 @@ namespace idl
                 // Prepare vector to hold wheat circles for debugging
                 std::vector<Circle> wheatCircles;
 
-                std::vector<Plant> plants = processCombinedMask(combinedMask, image, edges, wheatScoreThreshold, wheatCircles);
+                std::vector<Plant> plants = processCombinedMask(combinedMask, coarse, edges, wheatScoreThreshold, wheatCircles, nullptr,
+                                                                img.size() / downscale, area.tl() / downscale, pixelScale);
 
-                cv::Mat resultImage = image.clone();
+                cv::Mat resultImage = coarse.clone();
                 for (const auto& plant : plants)
                 {
                     cv::rectangle(resultImage, plant.boundingBox, (plant.plantSpecies == Species::wheat) ? cv::Scalar(0, 255, 0) : cv::Scalar(0, 0, 255), 2);
@@ -727,22 +1043,12 @@ namespace idl
         else
         {
             // Perform edge detection without sliders
-            cv::Mat grayMasked;
-            cv::cvtColor(masked, grayMasked, cv::COLOR_BGR2GRAY);
-            cv::Mat edges;
-            cv::Canny(grayMasked, edges, lowThreshold, highThreshold);
-
-            // Dilate the edges
-            cv::Mat edgeKernelDilate = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(edgeDilateSize, edgeDilateSize));
-            cv::dilate(edges, edges, edgeKernelDilate);
-
-            // Erode the edges
-            cv::Mat edgeKernelErode = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(edgeErodeSize, edgeErodeSize));
-            cv::erode(edges, edges, edgeKernelErode);
+            cv::Mat edges = detectEdges(masked, edgeParams);
 
             // Detect advantis and wheat plants
             cv::Mat cleanedMask_advantis = detectAdvantis(masked, advantisParams);
-            cv::Mat cleanedMask_wheat = detectWheat(masked, wheatParams);
+            cv::Mat equalization;
+            cv::Mat cleanedMask_wheat = detectWheat(masked, wheatParams, equalization);
 
             cv::Mat combinedMask;
             cv::bitwise_or(cleanedMask_advantis, cleanedMask_wheat, combinedMask);
@@ -750,7 +1056,26 @@ namespace idl
             // Prepare vector to hold wheat circles (not used in non-interactive mode)
             std::vector<Circle> wheatCircles;
 
-            std::vector<Plant> plants = processCombinedMask(combinedMask, image, edges, wheatScoreThreshold, wheatCircles);
+            std::vector<Plant> plants = processCombinedMask(combinedMask, coarse, edges, wheatScoreThreshold, wheatCircles, tracker,
+                                                            img.size() / downscale, area.tl() / downscale, pixelScale);
+
+            // Refine the plants at full resolution
+            if (downscale > 1 && !plants.empty())
+            {
+                refinePlants(plants, image, downscale, reduction, equalization);
+            }
+
+            // Move the plants back to the whole image coordinates
+            if (area.tl() != cv::Point(0, 0))
+            {
+                for (auto& plant : plants)
+                {
+                    plant.boundingBox += area.tl();
+                    plant.center += cv::Vec2d(area.x, area.y);
+                    plant.position += cv::Vec2d(area.x, area.y);
+                    plant.plantImg = img(plant.boundingBox);
+                }
+            }
 
             return plants;
         }
@@ -758,4 +1083,44 @@ namespace idl
         // Return an empty vector if sliders were enabled (as processing is interactive)
         return std::vector<Plant>();
     }
+
+    uint64_t PlantDetector::parametersHash(int downscale, int reduction)
+    {
+        const AdvantisParams& adv = defaultAdvantisParams;
+        const WheatParams& wheat = defaultWheatParams;
+        const EdgeParams& edge = defaultEdgeParams;
+
+        uint64_t oHash = hash::value(plantDetectorVersion);
+        for (int param : {downscale, reduction,
+                          adv.inRangeMinH, adv.inRangeMinS, adv.inRangeMinV, adv.inRangeMaxH, adv.inRangeMaxS, adv.inRangeMaxV,
+                          adv.morphOpenSize, adv.dilateIterations,
+                          wheat.min_L, wheat.min_a, wheat.min_b, wheat.max_L, wheat.max_a, wheat.max_b,
+                          wheat.morphKernelSize, wheat.morphIterations,
+                          edge.lowThreshold, edge.highThreshold, edge.dilateSize, edge.erodeSize})
+        {
+            oHash = hash::value(param, oHash);
+        }
+        for (double param : {adv.areaThreshold, adv.groupMaxDistance,
+                             wheat.areaThreshold, wheat.aspectRatioMin, wheat.aspectRatioMax, wheat.groupMaxDistance,
+                             defaultWheatScoreThreshold})
+        {
+            oHash = hash::value(param, oHash);
+        }
+        return oHash;
+    }
+
+    std::vector<Plant> PlantDetector::detectPlants(const cv::Mat& img, bool enableSliders)
+    {
+        return detectPlantsInImage(img, enableSliders, nullptr, cv::Rect(0, 0, img.cols, img.rows), 1, 1);
+    }
+
+    std::vector<Plant> PlantDetector::detectPlants(const cv::Mat& img, PlantTracker& tracker, int downscale, int reduction)
+    {
+        return detectPlantsInImage(img, false, &tracker, cv::Rect(0, 0, img.cols, img.rows), downscale, reduction);
+    }
+
+    std::vector<Plant> PlantDetector::detectPlants(const cv::Mat& img, const cv::Rect& area, int downscale, int reduction)
+    {
+        return detectPlantsInImage(img, false, nullptr, area & cv::Rect(0, 0, img.cols, img.rows), downscale, reduction);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include "PlantTracker.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace idl
+{
+    PlantTracker::PlantTracker(double iMinOverlap, double iMaxAreaChange):
+        _minOverlap(iMinOverlap), _maxAreaChange(iMaxAreaChange)
+    {
+    }
+
+    const PlantTracker::Track* PlantTracker::match(const cv::Rect& iBoundingBox, double iArea)
+    {
+        const Track* oTrack = nullptr;
+        double bestOverlap = _minOverlap;
+        size_t bestIndex = 0;
+
+        for (size_t i = 0; i < _tracks.size(); ++i)
+        {
+            if (_isMatched[i])
+            {
+                continue;
+            }
+
+            const Track& track = _tracks[i];
+
+            // Intersection over union of the bounding boxes
+            double intersection = (track.boundingBox & iBoundingBox).area();
+            double unionArea = track.boundingBox.area() + iBoundingBox.area() - intersection;
+            double overlap = unionArea > 0 ? intersection / unionArea : 0.0;
+
+            // The blob must not have changed significantly
+            double areaChange = std::abs(iArea - track.area) / std::max(track.area, 1.0);
+
+            if (overlap >= bestOverlap && areaChange <= _maxAreaChange)
+            {
+                bestOverlap = overlap;
+                bestIndex = i;
+                oTrack = &track;
+            }
+        }
+
+        if (oTrack)
+        {
+            _isMatched[bestIndex] = true;
+            _nbReused++;
+        }
+        else
+        {
+            _nbClassified++;
+        }
+
+        return oTrack;
+    }
+
+    void PlantTracker::update(std::vector<Track>&& iTracks)
+    {
+        _tracks = std::move(iTracks);
+        _isMatched.assign(_tracks.size(), false);
+    }
+
+    void PlantTracker::reset()
+    {
+        _tracks.clear();
+        _isMatched.clear();
+    }
+}
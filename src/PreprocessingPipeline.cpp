@@ -0,0 +1,481 @@
+#include "PreprocessingPipeline.hpp"
+#include "ImagePreProcessor.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+namespace idl
+{
+    // Fixed point weights of cv::cvtColor(COLOR_BGR2GRAY) on 8-bit images
+    constexpr int grayShift = 14;
+    constexpr int grayB = 1868;
+    constexpr int grayG = 9617;
+    constexpr int grayR = 4899;
+
+    /**
+     * @return the lookup table leaving the values unchanged
+     */
+    PreprocessingPipeline::Table identityTable()
+    {
+        PreprocessingPipeline::Table table;
+        for (int i = 0; i < 256; ++i)
+        {
+            table[i] = static_cast<uint8_t>(i);
+        }
+        return table;
+    }
+
+    /**
+     * Apply a lookup table to each channel of an image, in one pass over the rows.
+     * @param iSrc the 8-bit input image
+     * @param oDst the image after, allocated if needed
+     * @param iToGray convert a BGR image to grayscale before the lookup
+     * @param iTables a lookup table per channel of the image after
+     */
+    void applyTables(const cv::Mat& iSrc, cv::Mat& oDst, bool iToGray, const PreprocessingPipeline::Table* iTables)
+    {
+        int channels = iToGray ? 1 : iSrc.channels();
+        oDst.create(iSrc.rows, iSrc.cols, CV_8UC(channels));
+
+        cv::parallel_for_(cv::Range(0, iSrc.rows), [&](const cv::Range& iRows)
+        {
+            for (int y = iRows.start; y < iRows.end; ++y)
+            {
+                const uint8_t* in = iSrc.ptr<uint8_t>(y);
+                uint8_t* out = oDst.ptr<uint8_t>(y);
+                if (iToGray)
+                {
+                    const uint8_t* table = iTables[0].data();
+                    for (int x = 0; x < iSrc.cols; ++x, in += 3)
+                    {
+                        int gray = (in[0] * grayB + in[1] * grayG + in[2] * grayR + (1 << (grayShift - 1))) >> grayShift;
+                        out[x] = table[gray];
+                    }
+                }
+                else if (1 == channels)
+                {
+                    const uint8_t* table = iTables[0].data();
+                    for (int x = 0; x < iSrc.cols; ++x)
+                    {
+                        out[x] = table[in[x]];
+                    }
+                }
+                else
+                {
+                    for (int x = 0; x < iSrc.cols; ++x)
+                    {
+                        for (int c = 0; c < channels; ++c, ++in, ++out)
+                        {
+                            *out = iTables[c][*in];
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    /**
+     * Compute the equalization table of each channel of an image, as cv::equalizeHist.
+     * @param iSrc the 8-bit input image
+     * @param oTables a table per channel
+     */
+    void equalizationTables(const cv::Mat& iSrc, PreprocessingPipeline::Table* oTables)
+    {
+        int channels = iSrc.channels();
+        std::vector<int> hist(256 * channels, 0);
+        for (int y = 0; y < iSrc.rows; ++y)
+        {
+            const uint8_t* in = iSrc.ptr<uint8_t>(y);
+            for (int x = 0; x < iSrc.cols; ++x)
+            {
+                for (int c = 0; c < channels; ++c, ++in)
+                {
+                    hist[*in * channels + c]++;
+                }
+            }
+        }
+
+        int total = iSrc.rows * iSrc.cols;
+        for (int c = 0; c < channels; ++c)
+        {
+            PreprocessingPipeline::Table& table = oTables[c];
+            table.fill(0);
+
+            int i = 0;
+            while (i < 255 && 0 == hist[i * channels + c])
+            {
+                ++i;
+            }
+
+            // A single value is kept as it is
+            if (hist[i * channels + c] == total)
+            {
+                table.fill(static_cast<uint8_t>(i));
+                continue;
+            }
+
+            float scale = 255.f / (total - hist[i * channels + c]);
+            int sum = 0;
+            for (++i; i < 256; ++i)
+            {
+                sum += hist[i * channels + c];
+                table[i] = cv::saturate_cast<uint8_t>(sum * scale);
+            }
+        }
+    }
+
+    PreprocessingPipeline& PreprocessingPipeline::grayscale()
+    {
+        Step step;
+        step.type = StepType::grayscale;
+        _steps.push_back(step);
+        return *this;
+    }
+
+    PreprocessingPipeline& PreprocessingPipeline::threshold(double iThresh, double iMaxVal)
+    {
+        // Binary thresholding of 8-bit images, as cv::threshold
+        Step step;
+        step.type   = StepType::threshold;
+        step.thresh = iThresh;
+        step.maxVal = iMaxVal;
+        int thresh = cvFloor(iThresh);
+        uint8_t maxVal = cv::saturate_cast<uint8_t>(iMaxVal);
+        for (int i = 0; i < 256; ++i)
+        {
+            step.table[i] = i > thresh ? maxVal : 0;
+        }
+        _steps.push_back(step);
+        return *this;
+    }
+
+    PreprocessingPipeline& PreprocessingPipeline::lut(const Table& iTable)
+    {
+        Step step;
+        step.type  = StepType::lut;
+        step.table = iTable;
+        _steps.push_back(step);
+        return *this;
+    }
+
+    PreprocessingPipeline& PreprocessingPipeline::medianBlur(int iKernelSize)
+    {
+        Step step;
+        step.type       = StepType::median;
+        step.kernelSize = iKernelSize;
+        _steps.push_back(step);
+        return *this;
+    }
+
+    PreprocessingPipeline& PreprocessingPipeline::gaussianBlur(int iKernelSize, double iSigma)
+    {
+        Step step;
+        step.type       = StepType::gaussian;
+        step.kernelSize = iKernelSize;
+        step.sigma      = iSigma;
+        _steps.push_back(step);
+        return *this;
+    }
+
+    PreprocessingPipeline& PreprocessingPipeline::equalize()
+    {
+        Step step;
+        step.type = StepType::equalize;
+        _steps.push_back(step);
+        return *this;
+    }
+
+    bool PreprocessingPipeline::parse(const std::string& iConfig, PreprocessingPipeline& oPipeline)
+    {
+        oPipeline = PreprocessingPipeline();
+
+        std::stringstream steps(iConfig);
+        std::string token;
+        while (std::getline(steps, token, ','))
+        {
+            // name:arg:arg
+            std::stringstream fields(token);
+            std::string name, field;
+            std::getline(fields, name, ':');
+            std::vector<double> args;
+            bool isValid = true;
+            while (std::getline(fields, field, ':'))
+            {
+                char* end = nullptr;
+                args.push_back(std::strtod(field.c_str(), &end));
+                isValid = isValid && !field.empty() && '\0' == *end;
+            }
+
+            if (isValid && name == "gray" && args.empty())
+            {
+                oPipeline.grayscale();
+            }
+            else if (isValid && name == "threshold" && !args.empty() && args.size() <= 2)
+            {
+                oPipeline.threshold(args[0], args.size() > 1 ? args[1] : 255.0);
+            }
+            else if (isValid && name == "invert" && args.empty())
+            {
+                Table table;
+                for (int i = 0; i < 256; ++i)
+                {
+                    table[i] = static_cast<uint8_t>(255 - i);
+                }
+                oPipeline.lut(table);
+            }
+            else if (isValid && name == "gamma" && 1 == args.size() && args[0] > 0.0)
+            {
+                Table table;
+                for (int i = 0; i < 256; ++i)
+                {
+                    table[i] = cv::saturate_cast<uint8_t>(255.0 * std::pow(i / 255.0, args[0]));
+                }
+                oPipeline.lut(table);
+            }
+            else if (isValid && name == "median" && 1 == args.size())
+            {
+                oPipeline.medianBlur(static_cast<int>(args[0]));
+            }
+            else if (isValid && name == "gaussian" && !args.empty() && args.size() <= 2)
+            {
+                oPipeline.gaussianBlur(static_cast<int>(args[0]), args.size() > 1 ? args[1] : 0.0);
+            }
+            else if (isValid && name == "equalize" && args.empty())
+            {
+                oPipeline.equalize();
+            }
+            else
+            {
+                std::cerr << "Error: Unknown preprocessing step '" << token << "'" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void PreprocessingPipeline::plan(int iChannels, std::vector<Pass>& oPasses) const
+    {
+        oPasses.clear();
+
+        // The pointwise steps are gathered in an open pass until a neighbourhood step
+        const Table identity = identityTable();
+        int channels = iChannels;
+        Pass open;
+        bool isOpen = false;
+
+        auto close = [&]()
+        {
+            bool isNoop = PassType::pointwise == open.type && !open.toGray && open.table == identity;
+            if (isOpen && !isNoop)
+            {
+                oPasses.push_back(open);
+            }
+            isOpen = false;
+        };
+        auto start = [&](PassType iType, bool iToGray)
+        {
+            close();
+            open = Pass();
+            open.type   = iType;
+            open.toGray = iToGray;
+            open.table  = identity;
+            isOpen = true;
+        };
+        auto toGray = [&]()
+        {
+            if (3 != channels)
+            {
+                return;
+            }
+            // The conversion comes first in its pass
+            if (isOpen && PassType::pointwise == open.type && !open.toGray && open.table == identity)
+            {
+                open.toGray = true;
+            }
+            else
+            {
+                start(PassType::pointwise, true);
+            }
+            channels = 1;
+        };
+        auto compose = [&](const Table& iTable)
+        {
+            if (!isOpen)
+            {
+                start(PassType::pointwise, false);
+            }
+            for (int i = 0; i < 256; ++i)
+            {
+                open.table[i] = iTable[open.table[i]];
+            }
+        };
+
+        for (const Step& step : _steps)
+        {
+            switch (step.type)
+            {
+                case StepType::grayscale:
+                    toGray();
+                    break;
+                case StepType::threshold:
+                    toGray();
+                    compose(step.table);
+                    break;
+                case StepType::lut:
+                    compose(step.table);
+                    break;
+                case StepType::median:
+                case StepType::gaussian:
+                    if (step.kernelSize % 2 == 1 && step.kernelSize >= 1)
+                    {
+                        close();
+                        Pass pass;
+                        pass.type       = StepType::median == step.type ? PassType::median : PassType::gaussian;
+                        pass.kernelSize = step.kernelSize;
+                        pass.sigma      = step.sigma;
+                        oPasses.push_back(pass);
+                    }
+                    break;
+                case StepType::equalize:
+                    if (1 == channels || 3 == channels)
+                    {
+                        start(PassType::equalized, false);
+                    }
+                    break;
+            }
+        }
+        close();
+    }
+
+    void PreprocessingPipeline::apply(const cv::Mat& iImg, cv::Mat& oImg)
+    {
+        // The output may share the input pixels (apply(img, img)): the input is held by its own header 
+        // and the output reallocated, so that no pass reads pixels it has already written
+        cv::Mat input = iImg;
+        if (oImg.data && oImg.datastart < input.dataend && input.datastart < oImg.dataend)
+        {
+            oImg.release();
+        }
+
+        if (input.empty() || CV_8U != input.depth())
+        {
+            std::cerr << "Error: The preprocessing needs an 8-bit image" << std::endl;
+            oImg = input;
+            return;
+        }
+
+        plan(input.channels(), _passes);
+        if (_passes.empty())
+        {
+            input.copyTo(oImg);
+            return;
+        }
+
+        Table tables[4];
+        const cv::Mat* src = &input;
+        for (size_t p = 0; p < _passes.size(); ++p)
+        {
+            const Pass& pass = _passes[p];
+
+            // The intermediate images alternate between the buffers, the last one is the output
+            cv::Mat& dst = (p + 1 == _passes.size()) ? oImg : _buffers[p % 2];
+            switch (pass.type)
+            {
+                case PassType::pointwise:
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        tables[c] = pass.table;
+                    }
+                    applyTables(*src, dst, pass.toGray, tables);
+                    break;
+                case PassType::equalized:
+                    equalizationTables(*src, tables);
+                    for (int c = 0; c < src->channels(); ++c)
+                    {
+                        for (int i = 0; i < 256; ++i)
+                        {
+                            tables[c][i] = pass.table[tables[c][i]];
+                        }
+                    }
+                    applyTables(*src, dst, false, tables);
+                    break;
+                case PassType::median:
+                    cv::medianBlur(*src, dst, pass.kernelSize);
+                    break;
+                case PassType::gaussian:
+                    cv::GaussianBlur(*src, dst, cv::Size(pass.kernelSize, pass.kernelSize), pass.sigma);
+                    break;
+            }
+            src = &dst;
+        }
+    }
+
+    cv::Mat PreprocessingPipeline::applyStepByStep(const cv::Mat& iImg) const
+    {
+        cv::Mat img = iImg;
+        for (const Step& step : _steps)
+        {
+            switch (step.type)
+            {
+                case StepType::grayscale:
+                    img = ImagePreProcessor::applyGrayscale(img);
+                    break;
+                case StepType::threshold:
+                    img = ImagePreProcessor::applyThresholding(img, step.thresh, step.maxVal);
+                    break;
+                case StepType::lut:
+                {
+                    cv::Mat output;
+                    cv::LUT(img, cv::Mat(1, 256, CV_8U, const_cast<uint8_t*>(step.table.data())), output);
+                    img = output;
+                    break;
+                }
+                case StepType::median:
+                    img = ImagePreProcessor::applyMedianBlur(img, step.kernelSize);
+                    break;
+                case StepType::gaussian:
+                    img = ImagePreProcessor::applyGaussianBlur(img, step.kernelSize, step.sigma);
+                    break;
+                case StepType::equalize:
+                    img = ImagePreProcessor::applyHistogramEqualization(img);
+                    break;
+            }
+        }
+        return img;
+    }
+
+    std::string PreprocessingPipeline::describe(int iChannels) const
+    {
+        std::vector<Pass> passes;
+        plan(iChannels, passes);
+
+        const Table identity = identityTable();
+        std::string description;
+        for (const Pass& pass : passes)
+        {
+            if (!description.empty())
+            {
+                description += " | ";
+            }
+            switch (pass.type)
+            {
+                case PassType::pointwise:
+                    description += pass.toGray ? "gray" : "";
+                    description += (pass.toGray && pass.table != identity) ? "+" : "";
+                    description += pass.table != identity ? "lut" : "";
+                    break;
+                case PassType::equalized:
+                    description += pass.table != identity ? "equalize+lut" : "equalize";
+                    break;
+                case PassType::median:
+                    description += "median" + std::to_string(pass.kernelSize);
+                    break;
+                case PassType::gaussian:
+                    description += "gaussian" + std::to_string(pass.kernelSize);
+                    break;
+            }
+        }
+        return description.empty() ? "copy" : description;
+    }
+}
@@ -1,19 +1,62 @@
 #include "ProcessingFactory.hpp"
+#include "Hash.hpp"
+#include "Metrics.hpp"
+#include "PerfCounters.hpp"
+#include "ResultSink.hpp"
+#include <algorithm>
 
 namespace idl
 {
-    ProcessingFactory::ImageProcessing::ImageProcessing(cv::Mat&& iImage, std::string&& nImage)
-        :   _nameImg(std::move(nImage)), _img(std::move(iImage)), _plants(PlantDetector::detectPlants(_img)), 
-            _lineDetector(new LineDetector(_img)), 
-            _jetChecker(new JetPositionChecker(_plants, *_lineDetector))
+    ProcessingFactory::ImageProcessing::ImageProcessing(cv::Mat&& iImage, std::string&& nImage,
+        std::vector<Plant>&& iPlants, LaserLocator iLocator, LaserTracker* iTracker, int iReduction)
+        :   _nameImg(std::move(nImage)), _img(std::move(iImage)), _plants(std::move(iPlants)), 
+            _locator(iLocator), _reduction(iReduction)
     {
+        // Only search around the predicted laser position when tracking
+        cv::Rect searchArea;
+        if (iTracker)
+        {
+            searchArea = iTracker->getSearchArea(_img.size());
+        }
+        _lineDetector = new LineDetector(_img, _locator, searchArea, _reduction);
+
+        if (iTracker)
+        {
+            // Laser lost in the search window, fall back to the whole image
+            if (!searchArea.empty() && !iTracker->isReliable(*_lineDetector))
+            {
+                delete _lineDetector;
+                _lineDetector = new LineDetector(_img, _locator, cv::Rect(), _reduction);
+            }
+            iTracker->update(*_lineDetector);
+        }
+
+        _jetChecker = new JetPositionChecker(_plants, *_lineDetector);
     }
 
     ProcessingFactory::ImageProcessing::ImageProcessing(const ImageProcessing& iOther)
         : _nameImg(iOther._nameImg), _img(iOther._img.clone()), _plants(iOther._plants), 
-          _lineDetector(new LineDetector(_img)),
+          _locator(iOther._locator), _reduction(iOther._reduction),
+          _lineDetector(new LineDetector(_img, _locator, iOther._lineDetector->getSearchArea(), _reduction)),
           _jetChecker(new JetPositionChecker(_plants, *_lineDetector))
     {
+        // Same image, the laser does not need to be detected again
+        if (iOther._lineDetector->_isComputed)
+        {
+            _lineDetector->setResults(iOther._lineDetector->getResults());
+        }
+    }
+
+    ProcessingFactory::ImageProcessing::ImageProcessing(ImageProcessing&& iOther)
+        : _nameImg(std::move(iOther._nameImg)), _img(std::move(iOther._img)), _plants(std::move(iOther._plants)), 
+          _locator(iOther._locator), _reduction(iOther._reduction),
+          _lineDetector(new LineDetector(_img, _locator, iOther._lineDetector->getSearchArea(), _reduction)),
+          _jetChecker(new JetPositionChecker(_plants, *_lineDetector))
+    {
+        if (iOther._lineDetector->_isComputed)
+        {
+            _lineDetector->setResults(iOther._lineDetector->getResults());
+        }
     }
 
     ProcessingFactory::ImageProcessing::~ImageProcessing()
@@ -22,59 +65,29 @@ namespace idl
         delete _jetChecker;
     }
 
-    /**
-     * Format a vector of 2D positions into a string
-     * like "(x1; y1)/ (x2; y2)/"
-     * @param vector of plant
-     * @return string representing 2D positions
-     */
-    std::string formatPositions(const std::vector<Plant>& plants) 
+    cv::Point ProcessingFactory::ImageProcessing::getIntersection() const
     {
-        std::stringstream ssAdventis;
-        std::stringstream ssWheat;
-        for (const auto& p : plants) {
-            std::stringstream ss;
-            ss << "(" << p.center[0] << "; " << p.center[1] << ")/ ";
-
-            if(p.plantSpecies == Species::advantis)
-            {
-                ssAdventis << ss.str();
-            }
-            else if (p.plantSpecies == Species::wheat)
-            {
-                ssWheat << ss.str();
-            }
+        cv::Point intersectionLaser = _lineDetector->getIntersection();
+        if (_lineDetector->hasIntersection())
+        {
+            // Back to the original image coordinates, (-1, -1) is kept when not found
+            intersectionLaser *= _reduction;
         }
-        std::string result = ssAdventis.str() + ", " + ssWheat.str();
-
-        return result;
+        return intersectionLaser;
     }
 
     void ProcessingFactory::ImageProcessing::write(std::ostream& csvFile) const 
     {
-        std::string plantPosStr = formatPositions(_plants);
+        std::string row;
+        ResultSink::appendCsv(*this, row);
+        csvFile << row;
+    }
 
-        //type of beahvior the laser 
-        std::string laserOnStr = "Unknown";
-        switch (_jetChecker->computeState()) {
-            case LaserBehavior::onNothing:
-                laserOnStr = "onNothing";
-                break;
-            case LaserBehavior::onAdventis:
-                laserOnStr = "onAdventis";
-                break;
-            case LaserBehavior::onWheat:
-                laserOnStr = "onWheat";
-                break;
-            default:
-                laserOnStr = "No laser";
-                break;
-        }
-        cv::Point intersectionLaser = _lineDetector->getIntersection();
-        csvFile << _nameImg << ", ("
-                << intersectionLaser.x << "; " << intersectionLaser.y << "), "
-                << laserOnStr << ", "
-                << "\"" << plantPosStr << "\"\n";
+    void ProcessingFactory::ImageProcessing::writeJson(std::ostream& jsonStream) const
+    {
+        std::string row;
+        ResultSink::appendJson(*this, row);
+        jsonStream << row;
     }
 
     cv::Mat ProcessingFactory::ImageProcessing::getImage() const 
@@ -146,14 +159,61 @@ namespace idl
         return _jetChecker->computeState();
     }
 
-    ProcessingFactory::ProcessingFactory(const std::string& iImgDirectory)
+    ProcessingFactory::ProcessingFactory(const ProcessingOptions& iOptions)
+        : _options(iOptions)
+    {
+        if (!_options.cacheDirectory.empty())
+        {
+            _cache.open(_options.cacheDirectory);
+        }
+
+        if (cv::IMREAD_COLOR == ImageDecoder::readFlags(_options.decodeReduction))
+        {
+            _options.decodeReduction = 1;
+        }
+        _laserTracker = LaserTracker(512 / _options.decodeReduction); // same window as at full resolution
+    }
+
+    ProcessingFactory::ProcessingFactory(const std::string& iImgDirectory, const ProcessingOptions& iOptions,
+        const std::function<void(const ImageProcessing&)>& iOnProcessed)
+        : ProcessingFactory(iOptions)
     {
+        // Recorded frames: mapped views, no decoding nor copy
+        if (FrameArchive::isArchive(iImgDirectory))
+        {
+            if (!_archive.open(iImgDirectory))
+            {
+                return;
+            }
+            _options.decodeReduction = _archive.getReduction();
+            _laserTracker = LaserTracker(512 / _options.decodeReduction); // same window as at full resolution
+
+            _listOfProcess.reserve(_archive.size());
+            for (size_t i = 0; i < _archive.size(); ++i)
+            {
+                PerfCounters::FrameScope frame(_archive.getName(i));
+                processImage(_archive.getFrame(i), _archive.getName(i));
+                if (iOnProcessed)
+                {
+                    iOnProcessed(_listOfProcess.back());
+                }
+            }
+            return;
+        }
+
         cv::String path = iImgDirectory + "/*.png";
         std::vector<cv::String> dataFileNames;
         cv::glob(path, dataFileNames, false);
-        for (const auto& fileName : dataFileNames)
+
+        _listOfProcess.reserve(dataFileNames.size());
+
+        // PNG are decoded straight to BGR (the alpha channel is stripped by the decoder, without copy)
+        ImageDecoder decoder(std::move(dataFileNames), _options.decodeReduction, _options.decodeThreads);
+
+        cv::Mat img;
+        cv::String fileName;
+        while (decoder.next(img, fileName))
         {
-            auto img = cv::imread(fileName, cv::IMREAD_COLOR);
             if (img.empty()) 
             {
                 std::cerr << "Error: Could not load image " << fileName << std::endl;
@@ -161,9 +221,137 @@ namespace idl
             }
             //img = ImagePreProcessor::process(img);
             std::string fileNameStr = fileName.substr(fileName.find_last_of("/") + 1);;
-            ImageProcessing imgProce = ImageProcessing {std::move(img), std::move(fileNameStr)};
-            _listOfProcess.emplace_back(imgProce);
+            PerfCounters::FrameScope frame(fileNameStr);
+            processImage(std::move(img), std::move(fileNameStr));
+            if (iOnProcessed)
+            {
+                iOnProcessed(_listOfProcess.back());
+            }
+        }
+    }
+
+    const ProcessingFactory::ImageProcessing* ProcessingFactory::process(const std::string& iFileName)
+    {
+        cv::Mat img;
+        {
+            PerfCounters::Scope scope("decode");
+            Metrics::StageTimer timer(Metrics::Stage::decode);
+            img = cv::imread(iFileName, ImageDecoder::readFlags(_options.decodeReduction));
+        }
+        if (img.empty())
+        {
+            std::cerr << "Error: Could not load image " << iFileName << std::endl;
+            return nullptr;
+        }
+
+        processImage(std::move(img), iFileName.substr(iFileName.find_last_of("/") + 1));
+        return &_listOfProcess.back();
+    }
+
+    const ProcessingFactory::ImageProcessing* ProcessingFactory::process(const cv::Mat& iImage, const std::string& iName)
+    {
+        if (iImage.empty())
+        {
+            return nullptr;
+        }
+
+        processImage(cv::Mat(iImage), std::string(iName));
+        return &_listOfProcess.back();
+    }
+
+    void ProcessingFactory::clear()
+    {
+        _listOfProcess.clear();
+    }
+
+    std::vector<ProcessingFactory::ImageProcessing> ProcessingFactory::takeProcessing()
+    {
+        std::vector<ImageProcessing> oList;
+        oList.swap(_listOfProcess);
+        return oList;
+    }
+
+    void ProcessingFactory::processImage(cv::Mat&& iImage, std::string&& iName)
+    {
+        PerfCounters::FrameScope frame(iName);
+        PerfCounters::Scope scope("processImage");
+
+        // Results depending on the previous images cannot be cached
+        bool cachePlants = _cache.isOpen() && !_options.trackPlants && !_options.stripMode;
+        bool cacheLaser  = _cache.isOpen() && !_options.trackLaser;
+
+        uint64_t imageHash = (cachePlants || cacheLaser) ? hash::image(iImage) : 0;
+        uint64_t plantsKey = hash::combine(imageHash, PlantDetector::parametersHash(_options.plantDownscale, _options.decodeReduction));
+        uint64_t laserKey  = hash::combine(imageHash, LineDetector::parametersHash(_options.laserLocator, _options.decodeReduction));
+
+        std::vector<Plant> plants;
+        if (!cachePlants || !_cache.loadPlants(plantsKey, iImage, plants))
+        {
+            {
+                PerfCounters::Scope detectScope("detectPlants");
+                Metrics::StageTimer timer(Metrics::Stage::detect);
+                plants = detectPlants(iImage);
+            }
+            if (cachePlants)
+            {
+                _cache.storePlants(plantsKey, plants);
+            }
+        }
+
+        if (Metrics::isEnabled())
+        {
+            int nbPlants[3] = {0, 0, 0};
+            for (const auto& plant : plants)
+            {
+                nbPlants[static_cast<int>(plant.plantSpecies)]++;
+            }
+            Metrics::addFrame(nbPlants);
+        }
+
+        // The laser is counted once per frame, from the final detector: after the fallback
+        // of the tracking or as restored from the cache
+        Metrics::StageTimer laserTimer(Metrics::Stage::laser);
+        ImageProcessing imgProce = ImageProcessing {std::move(iImage), std::move(iName), std::move(plants),
+            _options.laserLocator, _options.trackLaser ? &_laserTracker : nullptr, _options.decodeReduction};
+
+        if (cacheLaser)
+        {
+            LineDetector::Results results;
+            if (_cache.loadLaser(laserKey, results))
+            {
+                imgProce._lineDetector->setResults(results);
+            }
+            else
+            {
+                _cache.storeLaser(laserKey, imgProce._lineDetector->getResults());
+            }
+        }
+
+        if (Metrics::isEnabled())
+        {
+            Metrics::addLaser(imgProce._lineDetector->hasIntersection());
+        }
+
+        _listOfProcess.emplace_back(std::move(imgProce));
+    }
+
+    std::vector<Plant> ProcessingFactory::detectPlants(const cv::Mat& iImage)
+    {
+        // The strip mode supersedes the plant tracking, both rely on the previous image
+        if (_options.stripMode)
+        {
+            return _stripDetector.detectPlants(iImage, _options.plantDownscale, _options.decodeReduction);
+        }
+        if (_options.trackPlants)
+        {
+            return PlantDetector::detectPlants(iImage, _plantTracker, _options.plantDownscale, _options.decodeReduction);
+        }
+        if (_options.plantDownscale > 1 || _options.decodeReduction > 1)
+        {
+            return PlantDetector::detectPlants(iImage, cv::Rect(0, 0, iImage.cols, iImage.rows), 
+                _options.plantDownscale, _options.decodeReduction);
         }
+        return PlantDetector::detectPlants(iImage);
     }
 
     const ProcessingFactory::ImageProcessing& ProcessingFactory::operator[](size_t iIndex) const 
@@ -0,0 +1,363 @@
+#include "ProcessingPipeline.hpp"
+#include "BoundedQueue.hpp"
+#include "FrameArchive.hpp"
+#include "ImageDecoder.hpp"
+#include "Metrics.hpp"
+#include "PerfCounters.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace idl
+{
+    using PipelineClock = std::chrono::steady_clock;
+
+    /**
+     * A frame going through the stages.
+     */
+    struct PipelineFrame
+    {
+        size_t index = 0;   //< position of the image in the input
+        std::string name;
+        cv::Mat image;      //< decoded image, handed over to the processing
+        std::unique_ptr<ProcessingFactory::ImageProcessing> processing; //< nullptr if the image cannot be decoded
+        cv::Mat overlays[2];    //< details and masks overlays
+    };
+
+    using FrameQueue = BoundedQueue<PipelineFrame>;
+
+    /**
+     * Activity of a stage, updated by its threads.
+     */
+    struct StageCounters
+    {
+        std::atomic<uint64_t> nbFrames {0};
+        std::atomic<int64_t> busyNs {0};
+        std::atomic<int64_t> starvedNs {0};
+        std::atomic<int64_t> blockedNs {0};
+        std::atomic<uint64_t> depthSum {0};
+        std::atomic<size_t> maxDepth {0};
+        std::atomic<int> nbRunning {0};    //< threads still running, the last one closes the output queue
+    };
+
+    /**
+     * @param iStart the beginning of the measure
+     * @return the time elapsed since the beginning, in ns
+     */
+    int64_t elapsedNs(PipelineClock::time_point iStart)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(PipelineClock::now() - iStart).count();
+    }
+
+    /**
+     * Wait before the next attempt on a full or empty queue: yield a few times, then sleep.
+     * @param ioAttempts the number of attempts so far
+     */
+    void backoff(int& ioAttempts)
+    {
+        if (++ioAttempts < 16)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    /**
+     * Wait for the next frame of a queue.
+     * @param iQueue the input queue of the stage
+     * @param oFrame the frame
+     * @param ioCounters the activity of the stage
+     * @param iQueueId the queue in the metrics
+     * @return false once the queue is closed and empty
+     */
+    bool popFrame(FrameQueue& iQueue, PipelineFrame& oFrame, StageCounters& ioCounters, Metrics::Queue iQueueId)
+    {
+        size_t depth = iQueue.size();
+        Metrics::setQueueDepth(iQueueId, depth);
+        auto start = PipelineClock::now();
+
+        bool isPopped = true;
+        int attempts = 0;
+        while (!iQueue.tryPop(oFrame))
+        {
+            // Every frame pushed before the closing is visible once the closing is
+            if (iQueue.isClosed())
+            {
+                isPopped = iQueue.tryPop(oFrame);
+                break;
+            }
+            backoff(attempts);
+        }
+        ioCounters.starvedNs += elapsedNs(start);
+
+        if (isPopped)
+        {
+            ioCounters.nbFrames++;
+            ioCounters.depthSum += depth;
+            size_t maxDepth = ioCounters.maxDepth.load(std::memory_order_relaxed);
+            while (depth > maxDepth && !ioCounters.maxDepth.compare_exchange_weak(maxDepth, depth))
+            {
+            }
+        }
+        return isPopped;
+    }
+
+    /**
+     * Wait for room in a queue and push a frame.
+     * @param oQueue the output queue of the stage
+     * @param ioFrame the frame, moved into the queue
+     * @param ioCounters the activity of the stage
+     */
+    void pushFrame(FrameQueue& oQueue, PipelineFrame& ioFrame, StageCounters& ioCounters)
+    {
+        auto start = PipelineClock::now();
+        int attempts = 0;
+        while (!oQueue.tryPush(ioFrame))
+        {
+            backoff(attempts);
+        }
+        ioCounters.blockedNs += elapsedNs(start);
+    }
+
+    /**
+     * Stop a thread of a stage. The last one tells the next stage that no frame will come.
+     * @param ioCounters the activity of the stage
+     * @param oQueue the output queue of the stage, nullptr for the last stage
+     */
+    void leaveStage(StageCounters& ioCounters, FrameQueue* oQueue)
+    {
+        if (1 == ioCounters.nbRunning.fetch_sub(1) && oQueue)
+        {
+            oQueue->close();
+        }
+    }
+
+    ProcessingPipeline::ProcessingPipeline(const ProcessingOptions& iOptions, const Settings& iSettings):
+        _options(iOptions), _settings(iSettings)
+    {
+    }
+
+    int ProcessingPipeline::run(const std::string& iImgDirectory, const std::string& iOutputDirectory, ResultSink& oSink)
+    {
+        ProcessingOptions options = _options;
+
+        // Recorded frames are mapped views, png files are decoded
+        FrameArchive archive;
+        std::vector<cv::String> fileNames;
+        bool isArchive = FrameArchive::isArchive(iImgDirectory);
+        if (isArchive)
+        {
+            if (!archive.open(iImgDirectory))
+            {
+                return -1;
+            }
+            options.decodeReduction = archive.getReduction();
+        }
+        else
+        {
+            cv::glob(iImgDirectory + "/*.png", fileNames, false);
+        }
+        size_t nbImages = isArchive ? archive.size() : fileNames.size();
+        int flags = ImageDecoder::readFlags(options.decodeReduction);
+
+        // A detection depending on the previous image needs the images one at a time, in order
+        bool isSequential = options.trackLaser || options.trackPlants || options.stripMode;
+        if (isSequential && _settings.detectThreads > 1)
+        {
+            std::cerr << "Warning: The tracking needs the images in order, the detection runs on a single thread" << std::endl;
+        }
+
+        const char* names[4] = {"decode", "detect", "render", "write"};
+        int nbThreads[4] = {std::max(1, _settings.decodeThreads),
+                            isSequential ? 1 : std::max(1, _settings.detectThreads),
+                            std::max(1, _settings.renderThreads),
+                            std::max(1, _settings.writeThreads)};
+
+        StageCounters counters[4];
+        for (int s = 0; s < 4; ++s)
+        {
+            counters[s].nbRunning = nbThreads[s];
+        }
+
+        FrameQueue decoded(_settings.queueCapacity);
+        FrameQueue detected(_settings.queueCapacity);
+        FrameQueue rendered(_settings.queueCapacity);
+
+        // Decode: the images are shared between the threads as they become free
+        std::atomic<size_t> nextImage {0};
+        auto decode = [&]()
+        {
+            PipelineFrame frame;
+            for (size_t i = nextImage++; i < nbImages; i = nextImage++)
+            {
+                auto start = PipelineClock::now();
+                frame.index = i;
+                if (isArchive)
+                {
+                    frame.image = archive.getFrame(i);
+                    frame.name  = archive.getName(i);
+                }
+                else
+                {
+                    PerfCounters::Scope scope("decode");
+                    Metrics::StageTimer timer(Metrics::Stage::decode);
+                    frame.image = cv::imread(fileNames[i], flags);
+                    frame.name  = fileNames[i].substr(fileNames[i].find_last_of("/") + 1);
+                    if (frame.image.empty())
+                    {
+                        std::cerr << "Error: Could not load image " << fileNames[i] << std::endl;
+                    }
+                }
+                counters[0].busyNs += elapsedNs(start);
+                counters[0].nbFrames++;
+
+                // Undecodable images go through as well, the next stages keep the order
+                pushFrame(decoded, frame, counters[0]);
+            }
+            leaveStage(counters[0], &decoded);
+        };
+
+        // Detect: one factory per thread, holding the state of the sequence
+        auto detect = [&]()
+        {
+            ProcessingFactory factory(options);
+            auto process = [&](PipelineFrame& ioFrame)
+            {
+                auto start = PipelineClock::now();
+                if (factory.process(ioFrame.image, ioFrame.name))
+                {
+                    ioFrame.processing.reset(new ProcessingFactory::ImageProcessing(
+                        std::move(factory.takeProcessing().back())));
+                }
+                ioFrame.image.release(); // kept by the processing
+                counters[1].busyNs += elapsedNs(start);
+                pushFrame(detected, ioFrame, counters[1]);
+            };
+
+            PipelineFrame frame;
+            std::map<size_t, PipelineFrame> pending;   //< images decoded ahead of the next one, in sequence
+            size_t nextIndex = 0;
+            while (popFrame(decoded, frame, counters[1], Metrics::Queue::decoded))
+            {
+                if (!isSequential)
+                {
+                    process(frame);
+                    continue;
+                }
+
+                pending.emplace(frame.index, std::move(frame));
+                for (auto it = pending.find(nextIndex); it != pending.end(); it = pending.find(nextIndex))
+                {
+                    process(it->second);
+                    pending.erase(it);
+                    nextIndex++;
+                }
+            }
+            leaveStage(counters[1], &detected);
+        };
+
+        // Render: draw the overlays
+        auto render = [&]()
+        {
+            PipelineFrame frame;
+            while (popFrame(detected, frame, counters[2], Metrics::Queue::detected))
+            {
+                auto start = PipelineClock::now();
+                if (frame.processing)
+                {
+                    PerfCounters::FrameScope frameScope(frame.name);
+                    PerfCounters::Scope scope("render");
+                    frame.overlays[0] = frame.processing->getImageWithDetails();
+                    frame.overlays[1] = frame.processing->getImageWithMasks();
+                }
+                counters[2].busyNs += elapsedNs(start);
+                pushFrame(rendered, frame, counters[2]);
+            }
+            leaveStage(counters[2], &rendered);
+        };
+
+        // Write: encode the overlays and format the rows in parallel, the rows are written in order
+        std::mutex sinkMutex;
+        std::map<size_t, std::string> rows;    //< rows of the images completed ahead of the next one
+        size_t nextRow = 0;
+        std::atomic<int> nbProcessed {0};
+        auto write = [&]()
+        {
+            PipelineFrame frame;
+            while (popFrame(rendered, frame, counters[3], Metrics::Queue::rendered))
+            {
+                auto start = PipelineClock::now();
+                std::string row;
+                if (frame.processing)
+                {
+                    PerfCounters::FrameScope frameScope(frame.name);
+                    PerfCounters::Scope scope("write");
+                    Metrics::StageTimer timer(Metrics::Stage::write);
+                    std::string basePath = iOutputDirectory + "/" + frame.name;
+                    if (!cv::imwrite(basePath + "_details.png", frame.overlays[0]))
+                    {
+                        std::cerr << "Error: Failed to save image for '" << frame.name << "'" << std::endl;
+                    }
+                    if (!cv::imwrite(basePath + "_mask.png", frame.overlays[1]))
+                    {
+                        std::cerr << "Error: Failed to save image for '" << frame.name << "'" << std::endl;
+                    }
+
+                    oSink.format(*frame.processing, row);
+                    nbProcessed++;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(sinkMutex);
+                    rows.emplace(frame.index, std::move(row));
+                    for (auto it = rows.find(nextRow); it != rows.end(); it = rows.find(nextRow))
+                    {
+                        oSink.writeRow(it->second);
+                        rows.erase(it);
+                        nextRow++;
+                    }
+                }
+                counters[3].busyNs += elapsedNs(start);
+            }
+            leaveStage(counters[3], nullptr);
+        };
+
+        std::vector<std::thread> threads;
+        std::function<void()> stages[4] = {decode, detect, render, write};
+        for (int s = 0; s < 4; ++s)
+        {
+            for (int i = 0; i < nbThreads[s]; ++i)
+            {
+                threads.emplace_back(stages[s]);
+            }
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        _stats.assign(4, StageStats());
+        for (int s = 0; s < 4; ++s)
+        {
+            StageStats& stats = _stats[s];
+            stats.name      = names[s];
+            stats.nbThreads = nbThreads[s];
+            stats.nbFrames  = counters[s].nbFrames;
+            stats.busyMs    = counters[s].busyNs / 1e6;
+            stats.starvedMs = counters[s].starvedNs / 1e6;
+            stats.blockedMs = counters[s].blockedNs / 1e6;
+            stats.meanDepth = (s > 0 && stats.nbFrames > 0) ? static_cast<double>(counters[s].depthSum) / stats.nbFrames : 0.0;
+            stats.maxDepth  = counters[s].maxDepth;
+        }
+        return nbProcessed;
+    }
+}
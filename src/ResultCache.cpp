@@ -0,0 +1,258 @@
+#include "ResultCache.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+// POSIX
+#include <sys/stat.h>
+
+namespace idl
+{
+    namespace
+    {
+        const uint32_t cacheMagic   = 0x43444c49; // "IDLC"
+        const uint32_t cacheVersion = 2;   // 2: plant score set, plant area in image pixels
+
+        template<typename T>
+        void writeValue(std::ostream& oStream, const T& iValue)
+        {
+            oStream.write(reinterpret_cast<const char*>(&iValue), sizeof(T));
+        }
+
+        template<typename T>
+        bool readValue(std::istream& iStream, T& oValue)
+        {
+            return static_cast<bool>(iStream.read(reinterpret_cast<char*>(&oValue), sizeof(T)));
+        }
+
+        /**
+         * Write the header of an entry.
+         */
+        void writeHeader(std::ostream& oStream, uint64_t iKey)
+        {
+            writeValue(oStream, cacheMagic);
+            writeValue(oStream, cacheVersion);
+            writeValue(oStream, iKey);
+        }
+
+        /**
+         * Check the header of an entry, a file from another version is ignored.
+         */
+        bool readHeader(std::istream& iStream, uint64_t iKey)
+        {
+            uint32_t magic = 0, version = 0;
+            uint64_t key = 0;
+            return readValue(iStream, magic) && readValue(iStream, version) && readValue(iStream, key)
+                && cacheMagic == magic && cacheVersion == version && iKey == key;
+        }
+
+        /**
+         * @return the number of bytes left to read in a stream, 0 if unknown
+         */
+        uint64_t remainingBytes(std::istream& iStream)
+        {
+            std::streampos position = iStream.tellg();
+            if (position < 0 || !iStream.seekg(0, std::ios::end))
+            {
+                return 0;
+            }
+            std::streampos end = iStream.tellg();
+            iStream.seekg(position);
+            return end > position ? static_cast<uint64_t>(end - position) : 0;
+        }
+
+        /**
+         * Write an entry to a temporary file then rename it, so that an interrupted run 
+         * never leaves a truncated entry.
+         */
+        template<typename Writer>
+        void writeEntry(const std::string& iPath, Writer iWriter)
+        {
+            std::string tmpPath = iPath + ".tmp";
+            {
+                std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+                if (!file.is_open())
+                {
+                    std::cerr << "Error: Unable to write the cache entry " << iPath << std::endl;
+                    return;
+                }
+                iWriter(file);
+                if (!file.good())
+                {
+                    std::cerr << "Error: Failed to write the cache entry " << iPath << std::endl;
+                    file.close();
+                    std::remove(tmpPath.c_str());
+                    return;
+                }
+            }
+            std::rename(tmpPath.c_str(), iPath.c_str());
+        }
+    }
+
+    bool ResultCache::open(const std::string& iDirectory)
+    {
+        if (mkdir(iDirectory.c_str(), 0755) != 0 && errno != EEXIST)
+        {
+            std::cerr << "Error: Unable to create the cache directory " << iDirectory << std::endl;
+            return false;
+        }
+        _directory = iDirectory;
+        return true;
+    }
+
+    std::string ResultCache::entryPath(uint64_t iKey, const char* iKind) const
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(iKey));
+        return _directory + "/" + name + "." + iKind;
+    }
+
+    bool ResultCache::loadPlants(uint64_t iKey, const cv::Mat& iImage, std::vector<Plant>& oPlants)
+    {
+        std::ifstream file(entryPath(iKey, "plants"), std::ios::binary);
+        uint32_t nbPlants = 0;
+        bool isValid = file.is_open() && readHeader(file, iKey) && readValue(file, nbPlants);
+
+        // The count is checked against the size of the file before any allocation: 
+        // each plant takes its fixed fields and a mask of at least one byte
+        const uint64_t minPlantSize = sizeof(cv::Vec2d) * 2 + sizeof(int32_t) * 5 + sizeof(float) * 2 + sizeof(uint32_t) + 1;
+        isValid = isValid && nbPlants <= remainingBytes(file) / minPlantSize;
+
+        std::vector<Plant> plants(isValid ? nbPlants : 0);
+        std::vector<uchar> buffer;
+        for (auto& plant : plants)
+        {
+            int32_t box[4], species = 0;
+            uint32_t maskSize = 0;
+            isValid = readValue(file, plant.center) && readValue(file, plant.position) && readValue(file, box)
+                   && readValue(file, species) && readValue(file, plant.area) && readValue(file, plant.score)
+                   && readValue(file, maskSize);
+            if (!isValid)
+            {
+                break;
+            }
+
+            // The species indexes the per species counters, the mask is bounded by the file
+            isValid = species >= static_cast<int32_t>(Species::unknown) && species <= static_cast<int32_t>(Species::advantis)
+                   && maskSize > 0 && maskSize <= remainingBytes(file);
+            if (!isValid)
+            {
+                break;
+            }
+
+            buffer.resize(maskSize);
+            isValid = static_cast<bool>(file.read(reinterpret_cast<char*>(buffer.data()), maskSize));
+            if (!isValid)
+            {
+                break;
+            }
+
+            plant.boundingBox  = cv::Rect(box[0], box[1], box[2], box[3]);
+            plant.plantSpecies = static_cast<Species>(species);
+            plant.mask         = cv::imdecode(buffer, cv::IMREAD_GRAYSCALE);
+
+            // The plant must fit the image it is restored for, its mask covering its box from its position
+            isValid = (plant.boundingBox & cv::Rect(0, 0, iImage.cols, iImage.rows)) == plant.boundingBox
+                   && !plant.mask.empty() && plant.mask.size() == plant.boundingBox.size()
+                   && plant.position == cv::Vec2d(plant.boundingBox.x, plant.boundingBox.y);
+            if (!isValid)
+            {
+                break;
+            }
+            plant.plantImg = iImage(plant.boundingBox);
+        }
+
+        if (!isValid)
+        {
+            _nbMisses++;
+            return false;
+        }
+
+        _nbHits++;
+        oPlants = std::move(plants);
+        return true;
+    }
+
+    void ResultCache::storePlants(uint64_t iKey, const std::vector<Plant>& iPlants) const
+    {
+        writeEntry(entryPath(iKey, "plants"), [&](std::ostream& oFile)
+        {
+            writeHeader(oFile, iKey);
+            writeValue(oFile, static_cast<uint32_t>(iPlants.size()));
+
+            std::vector<uchar> buffer;
+            for (const auto& plant : iPlants)
+            {
+                const cv::Rect& bbox = plant.boundingBox;
+                int32_t box[4] = {bbox.x, bbox.y, bbox.width, bbox.height};
+
+                // Binary masks compress very well with png
+                cv::imencode(".png", plant.mask, buffer);
+
+                writeValue(oFile, plant.center);
+                writeValue(oFile, plant.position);
+                writeValue(oFile, box);
+                writeValue(oFile, static_cast<int32_t>(plant.plantSpecies));
+                writeValue(oFile, plant.area);
+                writeValue(oFile, plant.score);
+                writeValue(oFile, static_cast<uint32_t>(buffer.size()));
+                oFile.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+            }
+        });
+    }
+
+    bool ResultCache::loadLaser(uint64_t iKey, LineDetector::Results& oResults)
+    {
+        std::ifstream file(entryPath(iKey, "laser"), std::ios::binary);
+        uint32_t nbLines = 0, nbIntersections = 0;
+        bool isValid = file.is_open() && readHeader(file, iKey) && readValue(file, nbLines);
+
+        LineDetector::Results results;
+        isValid = isValid && nbLines <= remainingBytes(file) / sizeof(results.lines[0]);
+        results.lines.resize(isValid ? nbLines : 0);
+        for (auto& line : results.lines)
+        {
+            isValid = isValid && readValue(file, line);
+        }
+
+        isValid = isValid && readValue(file, nbIntersections)
+               && nbIntersections <= remainingBytes(file) / sizeof(results.intersections[0]);
+        results.intersections.resize(isValid ? nbIntersections : 0);
+        for (auto& point : results.intersections)
+        {
+            isValid = isValid && readValue(file, point);
+        }
+
+        isValid = isValid && readValue(file, results.intersection) && readValue(file, results.confidence);
+
+        if (!isValid)
+        {
+            _nbMisses++;
+            return false;
+        }
+
+        _nbHits++;
+        oResults = std::move(results);
+        return true;
+    }
+
+    void ResultCache::storeLaser(uint64_t iKey, const LineDetector::Results& iResults) const
+    {
+        writeEntry(entryPath(iKey, "laser"), [&](std::ostream& oFile)
+        {
+            writeHeader(oFile, iKey);
+            writeValue(oFile, static_cast<uint32_t>(iResults.lines.size()));
+            for (const auto& line : iResults.lines)
+            {
+                writeValue(oFile, line);
+            }
+            writeValue(oFile, static_cast<uint32_t>(iResults.intersections.size()));
+            for (const auto& point : iResults.intersections)
+            {
+                writeValue(oFile, point);
+            }
+            writeValue(oFile, iResults.intersection);
+            writeValue(oFile, iResults.confidence);
+        });
+    }
+}
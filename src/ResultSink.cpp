@@ -0,0 +1,262 @@
+#include "ResultSink.hpp"
+#include "Metrics.hpp"
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace idl
+{
+    const char* const ResultSink::csvHeader = 
+        "Image Name, Laser Intersection (X; Y), LaserOn, Advantis Positions (X; Y), Weed Positions\n";
+
+    /**
+     * @param state a laser behavior
+     * @return the name of the laser behavior in the results
+     */
+    const char* laserStateName(LaserBehavior state)
+    {
+        switch (state) {
+            case LaserBehavior::onNothing:
+                return "onNothing";
+            case LaserBehavior::onAdventis:
+                return "onAdventis";
+            case LaserBehavior::onWheat:
+                return "onWheat";
+            default:
+                return "No laser";
+        }
+    }
+
+    /**
+     * Append an integer to a row, without allocation if the row capacity suffices.
+     */
+    void appendNumber(std::string& ioRow, int iValue)
+    {
+        char digits[16];
+        auto result = std::to_chars(digits, digits + sizeof(digits), iValue);
+        ioRow.append(digits, result.ptr);
+    }
+
+    /**
+     * Append a real to a row, with the digits of the default stream formatting (%g).
+     */
+    void appendNumber(std::string& ioRow, double iValue)
+    {
+        char digits[32];
+        auto result = std::to_chars(digits, digits + sizeof(digits), iValue, std::chars_format::general, 6);
+        ioRow.append(digits, result.ptr);
+    }
+
+    /**
+     * Append a real to a JSON row, null if it is not finite.
+     */
+    void appendJsonNumber(std::string& ioRow, double iValue)
+    {
+        if (std::isfinite(iValue))
+        {
+            appendNumber(ioRow, iValue);
+        }
+        else
+        {
+            ioRow += "null";
+        }
+    }
+
+    /**
+     * Append a string to a JSON row, escaping quotes, backslashes and control characters.
+     */
+    void appendJsonString(std::string& ioRow, const std::string& iValue)
+    {
+        static const char hexDigits[] = "0123456789abcdef";
+        for (char c : iValue)
+        {
+            const unsigned char byte = static_cast<unsigned char>(c);
+            if ('"' == c || '\\' == c)
+            {
+                ioRow += '\\';
+                ioRow += c;
+            }
+            else if ('\n' == c)
+            {
+                ioRow += "\\n";
+            }
+            else if ('\r' == c)
+            {
+                ioRow += "\\r";
+            }
+            else if ('\t' == c)
+            {
+                ioRow += "\\t";
+            }
+            else if (byte < 0x20)
+            {
+                ioRow += "\\u00";
+                ioRow += hexDigits[byte >> 4];
+                ioRow += hexDigits[byte & 0xf];
+            }
+            else
+            {
+                ioRow += c;
+            }
+        }
+    }
+
+    ResultSink::~ResultSink()
+    {
+        if (_fd >= 0)
+        {
+            ::close(_fd);
+        }
+    }
+
+    bool ResultSink::open(const std::string& iPath, ResultFormat iFormat)
+    {
+        // Appended rows go straight to the system, no user space buffer to lose
+        _fd = ::open(iPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (_fd < 0)
+        {
+            std::cerr << "Error: Unable to open or create the results file " << iPath << std::endl;
+            return false;
+        }
+        _format = iFormat;
+
+        struct stat status;
+        if (ResultFormat::csv == _format && 0 == ::fstat(_fd, &status) && 0 == status.st_size 
+            && !writeRow(csvHeader))
+        {
+            return false;
+        }
+        _nbRows = 0;
+        return true;
+    }
+
+    bool ResultSink::write(const ProcessingFactory::ImageProcessing& iProcessing)
+    {
+        Metrics::StageTimer timer(Metrics::Stage::write);
+        format(iProcessing, _buffer);
+        return writeRow(_buffer);
+    }
+
+    void ResultSink::format(const ProcessingFactory::ImageProcessing& iProcessing, std::string& oRow) const
+    {
+        oRow.clear();
+        if (ResultFormat::jsonl == _format)
+        {
+            appendJson(iProcessing, oRow);
+        }
+        else
+        {
+            appendCsv(iProcessing, oRow);
+        }
+    }
+
+    bool ResultSink::writeRow(const std::string& iRow)
+    {
+        const char* data = iRow.data();
+        size_t remaining = iRow.size();
+        while (remaining > 0)
+        {
+            ssize_t written = ::write(_fd, data, remaining);
+            if (written < 0)
+            {
+                if (EINTR == errno)
+                {
+                    continue;
+                }
+                std::cerr << "Error: Unable to write the results file" << std::endl;
+                return false;
+            }
+            data += written;
+            remaining -= static_cast<size_t>(written);
+        }
+        _nbRows++;
+        return true;
+    }
+
+    void ResultSink::appendCsv(const ProcessingFactory::ImageProcessing& iProcessing, std::string& ioRow)
+    {
+        const int scale = iProcessing.getReduction();
+        const cv::Point intersection = iProcessing.getIntersection();
+
+        ioRow += iProcessing.getImageName();
+        ioRow += ", (";
+        appendNumber(ioRow, intersection.x);
+        ioRow += "; ";
+        appendNumber(ioRow, intersection.y);
+        ioRow += "), ";
+        ioRow += laserStateName(iProcessing.getLaserBehavior());
+        ioRow += ", \"";
+
+        // Advantis positions then wheat positions
+        for (Species species : {Species::advantis, Species::wheat})
+        {
+            if (Species::wheat == species)
+            {
+                ioRow += ", ";
+            }
+            for (const auto& plant : iProcessing.getPlants())
+            {
+                if (plant.plantSpecies == species)
+                {
+                    ioRow += '(';
+                    appendNumber(ioRow, plant.center[0] * scale);
+                    ioRow += "; ";
+                    appendNumber(ioRow, plant.center[1] * scale);
+                    ioRow += ")/ ";
+                }
+            }
+        }
+        ioRow += "\"\n";
+    }
+
+    void ResultSink::appendJson(const ProcessingFactory::ImageProcessing& iProcessing, std::string& ioRow)
+    {
+        const int scale = iProcessing.getReduction();
+        const cv::Point intersection = iProcessing.getIntersection();
+
+        // Image names come from file names, which may hold any byte but '/' and NUL
+        ioRow += "{\"image\":\"";
+        appendJsonString(ioRow, iProcessing.getImageName());
+
+        ioRow += "\",\"laser\":\"";
+        ioRow += laserStateName(iProcessing.getLaserBehavior());
+        ioRow += "\",\"intersection\":[";
+        appendNumber(ioRow, intersection.x);
+        ioRow += ',';
+        appendNumber(ioRow, intersection.y);
+        ioRow += "],\"plants\":[";
+
+        bool isFirst = true;
+        for (const auto& plant : iProcessing.getPlants())
+        {
+            const cv::Rect& box = plant.boundingBox;
+            ioRow += isFirst ? "{\"species\":\"" : ",{\"species\":\"";
+            ioRow += Species::wheat == plant.plantSpecies ? "wheat" : 
+                     Species::advantis == plant.plantSpecies ? "advantis" : "unknown";
+            ioRow += "\",\"center\":[";
+            appendNumber(ioRow, plant.center[0] * scale);
+            ioRow += ',';
+            appendNumber(ioRow, plant.center[1] * scale);
+            ioRow += "],\"box\":[";
+            appendNumber(ioRow, box.x * scale);
+            ioRow += ',';
+            appendNumber(ioRow, box.y * scale);
+            ioRow += ',';
+            appendNumber(ioRow, box.width * scale);
+            ioRow += ',';
+            appendNumber(ioRow, box.height * scale);
+            ioRow += "],\"area\":";
+            appendJsonNumber(ioRow, plant.area * scale * scale);
+            ioRow += ",\"score\":";
+            appendJsonNumber(ioRow, plant.score);
+            ioRow += '}';
+            isFirst = false;
+        }
+        ioRow += "]}\n";
+    }
+}
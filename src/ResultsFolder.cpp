@@ -0,0 +1,89 @@
+#include "ResultsFolder.hpp"
+#include "PerfCounters.hpp"
+#include <ctime>
+#include <iostream>
+
+namespace idl
+{
+    std::string getCurrentDateTime() 
+    {
+        time_t now = time(0);
+        struct tm tstruct;
+        char buf[80];
+        tstruct = *localtime(&now);
+        strftime(buf, sizeof(buf), "%Y-%m-%d_%H-%M-%S", &tstruct); //YYYY-MM-DD_HH-MM-SS
+        return std::string(buf);
+    }
+
+    bool openResults(ResultSink& results, const fs::path& pathFolder, ResultFormat format)
+    {
+        //check if the folder exists
+        if (!fs::exists(pathFolder)) 
+        {
+            std::cerr << "Error: The directory '" << pathFolder << "' does not exist." << std::endl;
+            return false;
+        }
+
+        //The name of file
+        std::string filename = getCurrentDateTime() + "_plantCheck" 
+                             + (ResultFormat::jsonl == format ? ".jsonl" : ".csv");
+        fs::path fullFilePath = pathFolder / filename;
+
+        if (PerfCounters::isEnabled() 
+            && !PerfCounters::openFrames((pathFolder / "perf_counters.csv").string()))
+        {
+            return false;
+        }
+        return results.open(fullFilePath.string(), format);
+    }
+
+    fs::path createResultsFolder()
+    {
+        //create a new folder
+        std::string directoryPath = "./" + getCurrentDateTime() + "WeedProj_Results";
+
+        if (!fs::exists(directoryPath)) {
+            //if doesn't exist create the folder
+            if (!fs::create_directory(directoryPath)) {
+                std::cerr << "Error : for create folder" << std::endl;
+                return fs::path();
+            }
+        }
+        return fs::absolute(directoryPath);
+    }
+
+    void reportPerfCounters(const fs::path& savedPath)
+    {
+        if (!PerfCounters::isEnabled())
+        {
+            return;
+        }
+        PerfCounters::printReport(std::cout);
+        fs::path framesPath = savedPath / "perf_counters.csv";
+        if (PerfCounters::closeFrames())
+        {
+            std::cout << "Counters of each frame written to " << framesPath.string() << std::endl;
+        }
+    }
+
+    void saveOverlays(const ProcessingFactory::ImageProcessing& processing, const fs::path& savedPath, cv::Mat imgs[2])
+    {
+        imgs[0] = processing.getImageWithDetails();
+        imgs[1] = processing.getImageWithMasks();
+        std::string baseImageName = processing.getImageName(); //name of img
+
+        // path file img
+        fs::path imgDetailsPath = savedPath / (baseImageName + "_details.png");
+        fs::path imgMaskPath = savedPath / (baseImageName + "_mask.png");
+
+        // save img
+        if (!cv::imwrite(imgDetailsPath.string(), imgs[0])) 
+        {
+            std::cerr << "Error: Failed to save image for '" << baseImageName << "'" << std::endl;
+        }
+        if (!cv::imwrite(imgMaskPath.string(), imgs[1])) 
+        {
+            std::cerr << "Error: Failed to save image for '" << baseImageName << "'" << std::endl;
+        }
+    }
+}
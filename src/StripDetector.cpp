@@ -0,0 +1,142 @@
+#include "StripDetector.hpp"
+#include "PlantDetector.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace idl
+{
+    StripDetector::StripDetector(int iMargin, double iScale, double iMinResponse, int iRefreshPeriod):
+        _margin(iMargin), _scale(iScale), _minResponse(iMinResponse), _refreshPeriod(iRefreshPeriod)
+    {
+    }
+
+    bool StripDetector::shiftPlant(const Plant& iPlant, const cv::Point& iShift, const cv::Mat& iImage, Plant& oPlant)
+    {
+        cv::Rect moved   = iPlant.boundingBox + iShift;
+        cv::Rect visible = moved & cv::Rect(0, 0, iImage.cols, iImage.rows);
+
+        if (visible.empty())
+        {
+            // The plant has left the frame
+            return false;
+        }
+
+        oPlant = iPlant;
+        oPlant.boundingBox = visible;
+        oPlant.center   += cv::Vec2d(iShift.x, iShift.y);
+        oPlant.position  = cv::Vec2d(visible.x, visible.y);
+        oPlant.plantImg  = iImage(visible);
+
+        // Keep the visible part of the mask, relative to the moved bounding box
+        oPlant.mask = iPlant.mask(visible - moved.tl());
+
+        return true;
+    }
+
+    std::vector<Plant> StripDetector::detectPlants(const cv::Mat& iImage, int iDownscale, int iReduction)
+    {
+        // Downsampled gray frame for the shift estimation
+        cv::Mat gray, small;
+        cv::cvtColor(iImage, gray, cv::COLOR_BGR2GRAY);
+        cv::resize(gray, small, cv::Size(), _scale, _scale, cv::INTER_AREA);
+        small.convertTo(small, CV_32F);
+
+        bool isReliable = false;
+        if (!_prevGray.empty() && _prevGray.size() == small.size())
+        {
+            if (_window.size() != small.size())
+            {
+                cv::createHanningWindow(_window, small.size(), CV_32F);
+            }
+
+            double response = 0.0;
+            cv::Point2d shift = cv::phaseCorrelate(_prevGray, small, _window, &response);
+
+            _shift = cv::Point(cvRound(shift.x / _scale), cvRound(shift.y / _scale));
+            isReliable = response >= _minResponse;
+        }
+        _prevGray = small;
+
+        // The travel direction is the dominant axis of the shift
+        bool isHorizontal = std::abs(_shift.x) >= std::abs(_shift.y);
+        int shift      = isHorizontal ? _shift.x : _shift.y;
+        int crossShift = isHorizontal ? _shift.y : _shift.x;
+        int length     = isHorizontal ? iImage.cols : iImage.rows;
+
+        _nbFrames++;
+        bool isRefresh = _refreshPeriod > 0 && _nbFrames >= _refreshPeriod;
+
+        // The margin is given at full resolution
+        int margin = _margin / std::max(1, iReduction);
+
+        // Unknown, too large or sideways motion: process the whole frame
+        if (!isReliable || isRefresh 
+            || std::abs(shift) + margin >= length 
+            || std::abs(crossShift) > margin / 2)
+        {
+            _area     = cv::Rect(0, 0, iImage.cols, iImage.rows);
+            _plants   = PlantDetector::detectPlants(iImage, _area, iDownscale, iReduction);
+            _nbFrames = 0;
+            return _plants;
+        }
+
+        // Newly exposed strip plus margin, and the cut between moved and detected plants
+        int begin, end, cut;
+        if (shift >= 0)
+        {
+            begin = 0;
+            end   = shift + margin;
+            cut   = shift + margin / 2;
+        }
+        else
+        {
+            begin = length + shift - margin;
+            end   = length;
+            cut   = length + shift - margin / 2;
+        }
+
+        _area = isHorizontal 
+            ? cv::Rect(begin, 0, end - begin, iImage.rows) 
+            : cv::Rect(0, begin, iImage.cols, end - begin);
+
+        // A plant belongs to the new strip if its center is before the cut
+        auto isInStrip = [&](const Plant& iPlant)
+        {
+            double center = isHorizontal ? iPlant.center[0] : iPlant.center[1];
+            return shift >= 0 ? center < cut : center >= cut;
+        };
+
+        std::vector<Plant> oPlants;
+
+        // Plants of the overlap, already known from the previous frame
+        for (const auto& plant : _plants)
+        {
+            Plant moved;
+            if (shiftPlant(plant, _shift, iImage, moved) && !isInStrip(moved))
+            {
+                oPlants.push_back(std::move(moved));
+            }
+        }
+
+        // Plants of the new strip
+        for (auto& plant : PlantDetector::detectPlants(iImage, _area, iDownscale, iReduction))
+        {
+            if (isInStrip(plant))
+            {
+                oPlants.push_back(std::move(plant));
+            }
+        }
+
+        _plants = oPlants;
+        return oPlants;
+    }
+
+    void StripDetector::reset()
+    {
+        _prevGray.release();
+        _plants.clear();
+        _shift    = cv::Point {0, 0};
+        _area     = cv::Rect();
+        _nbFrames = 0;
+    }
+}
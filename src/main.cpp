@@ -1,84 +1,47 @@
 #include <iostream>
 #include <opencv2/opencv.hpp>
-#include <LineDetector.hpp>
-#include <Plant.hpp>
-#include <PlantDetector.hpp>
-#include <JetPositionChecker.hpp>
-#include <ImagePreProcessor.hpp>
-#include <LaserBehavior.hpp>
-#include <ProcessingFactory.hpp>
+#include <Benchmarks.hpp>
+#include <FrameStream.hpp>
+#include <Kernels.hpp>
+#include <LaserLocator.hpp>
+#include <MetricsExporter.hpp>
+#include <Modes.hpp>
+#include <PerfCounters.hpp>
+#include <PreprocessingPipeline.hpp>
+#include <ProcessingOptions.hpp>
+#include <ProcessingPipeline.hpp>
 
-#include <fstream>
-#include <vector>
 #include <string>
-#include <ctime>  // To generate the current date and time
-#include <sstream> // For formatting the filename
-
-
-#include <filesystem>  // Utilisation correcte du header filesystem
-
-#ifdef __APPLE__
-    namespace fs = std::__fs::filesystem;  // Sur macOS, utilisez __fs::filesystem
-#else
-    namespace fs = std::filesystem;  // Sur les autres systèmes, utilisez std::filesystem
-#endif
-
-     /**Get the current date and time as a formatted string
-     * The date and time format is: YYYY-MM-DD_HH-MM-SS
-     * @return string representing date and time
-     */
-    std::string getCurrentDateTime() 
-    {
-        time_t now = time(0);
-        struct tm tstruct;
-        char buf[80];
-        tstruct = *localtime(&now);
-        strftime(buf, sizeof(buf), "%Y-%m-%d_%H-%M-%S", &tstruct); //YYYY-MM-DD_HH-MM-SS
-        return std::string(buf);
-    }
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
 
+namespace
+{
     /**
-     * Generates and writes data to a CSV file with the name format
-     * "YYYY-MM-DD_HH-MM-SS_plantCheck.csv". It records the image name, laser intersection point,
-     * laser state, plant positions, and advantis positions
-     * @param factory containing data for each image and path for save file
+     * Modes of the command line, a run has a single one.
      */
-
-    void generateCSV(const idl::ProcessingFactory& factory, const fs::path pathFolder) {
-
-        //check if the folder exists
-        if (!fs::exists(pathFolder)) 
-        {
-            std::cerr << "Error: The directory '" << pathFolder << "' does not exist." << std::endl;
-            return;
-        }
-
-        //The name of file
-        std::string filename = getCurrentDateTime() + "_plantCheck.csv";
-        fs::path fullFilePath = pathFolder / filename;
-
-        //create folder
-        std::ofstream csvFile;
-        csvFile.open(fullFilePath, std::ios::app);
-        if (!csvFile.is_open()) {
-            std::cerr << "Error: Unable to open or create the CSV file." << std::endl;
-            return;
-        }
-
-        // Write the header
-        csvFile << "Image Name, Laser Intersection (X; Y), LaserOn, Advantis Positions (X; Y), Weed Positions\n";
-
-        //write all data
-        for(const auto& ImageProc : factory.listProcessing())
-        {
-            ImageProc.write(csvFile);
-        }
-
-        csvFile.close();
-        std::cout << "CSV file successfully created and updated!" << std::endl;
-        
-    }
-
+    enum class Mode
+    {
+        process,            //< process a directory and display the results (default)
+        convert,            //< --convert
+        serve,              //< --serve
+        ring,               //< --ring
+        stream,             //< --stream
+        produce,            //< --produce
+        request,            //< --request
+        benchServe,         //< --bench-serve
+        watch,              //< --watch
+        checkKernels,       //< --check-kernels
+        benchLaser,         //< --bench-laser
+        benchPyramid,       //< --bench-pyramid
+        benchAllocations,   //< --bench-allocations
+        benchMorphology,    //< --bench-morphology
+        benchDenoise,       //< --bench-denoise
+        benchPreprocess,    //< --bench-preprocess
+        pipeline            //< --pipeline
+    };
+}
 
 int main(int argc, char* argv[])
 {
@@ -88,62 +51,378 @@ int main(int argc, char* argv[])
     }
     std::string imageDirectory = argv[1];
 
-    idl::ProcessingFactory factory(imageDirectory);
-    std::cout << "Found " << factory.listProcessing().size() << " image(s)!" << std::endl;
-
-    cv::namedWindow("Image", cv::WINDOW_AUTOSIZE);
+    // Optional settings
+    idl::ProcessingOptions options;
+    Mode mode = Mode::process;
+    std::string modeOption;
+    idl::PreprocessingPipeline benchPreprocess;
+    bool perfCounters = false;
+    int metricsPort = 0;
+    std::string metricsFile;
+    double metricsInterval = 10.0;
+    std::string requestFile;
+    std::string produceRing;
+    uint32_t ringSlots = 4;
+    double fps = 0.0;
+    idl::DropPolicy dropPolicy = idl::DropPolicy::latestWins;
+    int everyN = 2;
+    double deadlineMs = 0.0;
+    idl::ProcessingPipeline::Settings pipelineSettings;
+    std::string benchServeDirectory;
+    size_t watchQueue = 8;
+    std::string archivePath;
 
-    //create a new folder
-    std::string directoryPath = "./" + getCurrentDateTime() + "WeedProj_Results";
-
-    if (!fs::exists(directoryPath)) {
-        //if doesn't exist create the folder
-        if (!fs::create_directory(directoryPath)) {
-            std::cerr << "Error : for create folder" << std::endl;
-            return 1;
+    // Select the mode of an option, a second mode is an error
+    auto selectMode = [&mode, &modeOption](Mode iMode, const std::string& iOption)
+    {
+        if (!modeOption.empty() && modeOption != iOption)
+        {
+            std::cerr << "Error: The options '" << modeOption << "' and '" << iOption << "' cannot be combined" << std::endl;
+            return false;
         }
-    }
-    fs::path savedPath = fs::absolute(directoryPath);
-
-    for(int i = 0; i < factory.listProcessing().size(); ++i)
-    {   
-         
-        cv::Mat imgs[2] = {
-            factory[i].getImageWithDetails(),
-            factory[i].getImageWithMasks()
-        };
-        std::string baseImageName = factory[i].getImageName(); //name of img
+        mode = iMode;
+        modeOption = iOption;
+        return true;
+    };
 
-        // path file img
-        fs::path imgDetailsPath = savedPath / (baseImageName + "_details.png");
-        fs::path imgMaskPath = savedPath / (baseImageName + "_mask.png");
-
-        // save img
-        if (!cv::imwrite(imgDetailsPath.string(), imgs[0])) 
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        if (option == "--laser" && i + 1 < argc)
         {
-            std::cerr << "Error: Failed to save image for '" << baseImageName << "'" << std::endl;
+            std::string value = argv[++i];
+            if (value == "hough")
+            {
+                options.laserLocator = idl::LaserLocator::hough;
+            }
+            else if (value == "projection")
+            {
+                options.laserLocator = idl::LaserLocator::projection;
+            }
+            else
+            {
+                std::cerr << "Error: Unknown laser locator '" << value << "' (hough, projection)" << std::endl;
+                return -1;
+            }
         }
-        if (!cv::imwrite(imgMaskPath.string(), imgs[1])) 
+        else if (option == "--track-laser")
         {
-            std::cerr << "Error: Failed to save image for '" << baseImageName << "'" << std::endl;
+            options.trackLaser = true;
         }
-
-        // display picture
-        for (auto img : imgs)
+        else if (option == "--track-plants")
+        {
+            options.trackPlants = true;
+        }
+        else if (option == "--strip")
+        {
+            options.stripMode = true;
+        }
+        else if (option == "--pyramid" && i + 1 < argc)
+        {
+            options.plantDownscale = std::atoi(argv[++i]);
+            if (options.plantDownscale != 1 && options.plantDownscale != 2 && options.plantDownscale != 4)
+            {
+                std::cerr << "Error: Unsupported pyramid downscale '" << argv[i] << "' (1, 2, 4)" << std::endl;
+                return -1;
+            }
+        }
+        else if (option == "--decode-reduction" && i + 1 < argc)
+        {
+            options.decodeReduction = std::atoi(argv[++i]);
+            int reduction = options.decodeReduction;
+            if (reduction != 1 && reduction != 2 && reduction != 4 && reduction != 8)
+            {
+                std::cerr << "Error: Unsupported decode reduction '" << argv[i] << "' (1, 2, 4, 8)" << std::endl;
+                return -1;
+            }
+        }
+        else if (option == "--decode-threads" && i + 1 < argc)
+        {
+            options.decodeThreads = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (option == "--cache" && i + 1 < argc)
+        {
+            options.cacheDirectory = argv[++i];
+        }
+        else if (option == "--format" && i + 1 < argc)
+        {
+            std::string value = argv[++i];
+            if (value == "csv")
+            {
+                options.resultFormat = idl::ResultFormat::csv;
+            }
+            else if (value == "jsonl")
+            {
+                options.resultFormat = idl::ResultFormat::jsonl;
+            }
+            else
+            {
+                std::cerr << "Error: Unknown result format '" << value << "' (csv, jsonl)" << std::endl;
+                return -1;
+            }
+        }
+        else if (option == "--watch")
+        {
+            if (!selectMode(Mode::watch, option))
+            {
+                return -1;
+            }
+        }
+        else if (option == "--watch-queue" && i + 1 < argc)
+        {
+            watchQueue = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (option == "--serve")
+        {
+            if (!selectMode(Mode::serve, option))
+            {
+                return -1;
+            }
+        }
+        else if (option == "--request" && i + 1 < argc)
+        {
+            if (!selectMode(Mode::request, option))
+            {
+                return -1;
+            }
+            requestFile = argv[++i];
+        }
+        else if (option == "--bench-serve" && i + 1 < argc)
+        {
+            if (!selectMode(Mode::benchServe, option))
+            {
+                return -1;
+            }
+            benchServeDirectory = argv[++i];
+        }
+        else if (option == "--ring")
+        {
+            if (!selectMode(Mode::ring, option))
+            {
+                return -1;
+            }
+        }
+        else if (option == "--produce" && i + 1 < argc)
         {
-            char windowTitle[60];
-            std::snprintf(windowTitle, 60, "Image #%d", i);
-            cv::imshow("Image", img);
-            if(cv::waitKey(200) == 27){
-                return 0;
+            if (!selectMode(Mode::produce, option))
+            {
+                return -1;
             }
+            produceRing = argv[++i];
+        }
+        else if (option == "--ring-slots" && i + 1 < argc)
+        {
+            ringSlots = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (option == "--fps" && i + 1 < argc)
+        {
+            fps = std::max(0.1, std::atof(argv[++i]));
+        }
+        else if (option == "--stream")
+        {
+            if (!selectMode(Mode::stream, option))
+            {
+                return -1;
+            }
+        }
+        else if (option == "--drop-policy" && i + 1 < argc)
+        {
+            std::string value = argv[++i];
+            if (value == "latest")
+            {
+                dropPolicy = idl::DropPolicy::latestWins;
+            }
+            else if (value == "nth")
+            {
+                dropPolicy = idl::DropPolicy::everyNth;
+            }
+            else
+            {
+                std::cerr << "Error: Unknown drop policy '" << value << "' (latest, nth)" << std::endl;
+                return -1;
+            }
+        }
+        else if (option == "--every" && i + 1 < argc)
+        {
+            everyN = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (option == "--deadline" && i + 1 < argc)
+        {
+            deadlineMs = std::atof(argv[++i]);
+        }
+        else if (option == "--pipeline" && i + 1 < argc)
+        {
+            if (!selectMode(Mode::pipeline, option))
+            {
+                return -1;
+            }
+            auto& s = pipelineSettings;
+            if (4 != std::sscanf(argv[++i], "%d,%d,%d,%d", &s.decodeThreads, &s.detectThreads, 
+                                 &s.renderThreads, &s.writeThreads))
+            {
+                std::cerr << "Error: Expected the threads of each stage '" << argv[i] 
+                          << "' (decode,detect,render,write)" << std::endl;
+                return -1;
+            }
+        }
+        else if (option == "--queue-capacity" && i + 1 < argc)
+        {
+            pipelineSettings.queueCapacity = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (option == "--convert" && i + 1 < argc)
+        {
+            if (!selectMode(Mode::convert, option))
+            {
+                return -1;
+            }
+            archivePath = argv[++i];
+        }
+        else if (option == "--bench-laser")
+        {
+            if (!selectMode(Mode::benchLaser, option))
+            {
+                return -1;
+            }
+        }
+        else if (option == "--bench-pyramid")
+        {
+            if (!selectMode(Mode::benchPyramid, option))
+            {
+                return -1;
+            }
+        }
+        else if (option == "--bench-preprocess" && i + 1 < argc)
+        {
+            if (!selectMode(Mode::benchPreprocess, option) 
+                || !idl::PreprocessingPipeline::parse(argv[++i], benchPreprocess))
+            {
+                return -1;
+            }
+        }
+        else if (option == "--metrics-port" && i + 1 < argc)
+        {
+            metricsPort = std::atoi(argv[++i]);
+            if (metricsPort <= 0 || metricsPort > 65535)
+            {
+                std::cerr << "Error: Invalid metrics port '" << argv[i] << "'" << std::endl;
+                return -1;
+            }
+        }
+        else if (option == "--metrics-file" && i + 1 < argc)
+        {
+            metricsFile = argv[++i];
+        }
+        else if (option == "--metrics-interval" && i + 1 < argc)
+        {
+            metricsInterval = std::atof(argv[++i]);
+        }
+        else if (option == "--perf-counters")
+        {
+            perfCounters = true;
+        }
+        else if (option == "--bench-allocations")
+        {
+            if (!selectMode(Mode::benchAllocations, option))
+            {
+                return -1;
+            }
+        }
+        else if (option == "--bench-morphology")
+        {
+            if (!selectMode(Mode::benchMorphology, option))
+            {
+                return -1;
+            }
+        }
+        else if (option == "--bench-denoise")
+        {
+            if (!selectMode(Mode::benchDenoise, option))
+            {
+                return -1;
+            }
+        }
+        else if (option == "--isa" && i + 1 < argc)
+        {
+            idl::kernels::Isa isa;
+            if (!idl::kernels::parseIsa(argv[++i], isa))
+            {
+                std::cerr << "Error: Unknown instruction set '" << argv[i] << "' (scalar, sse4, avx2, avx512)" << std::endl;
+                return -1;
+            }
+            if (!idl::kernels::setIsa(isa))
+            {
+                return -1;
+            }
+        }
+        else if (option == "--check-kernels")
+        {
+            if (!selectMode(Mode::checkKernels, option))
+            {
+                return -1;
+            }
+        }
+        else
+        {
+            std::cerr << "Error: Unknown option '" << option << "'" << std::endl;
+            return -1;
         }
     }
 
-    //generate CSV
-    generateCSV(factory, savedPath);
-
-    return 0;
-}
+    if (perfCounters && !idl::PerfCounters::enable())
+    {
+        return -1;
+    }
 
+    // Exported until the end of main, whatever the mode
+    idl::MetricsExporter metrics;
+    if ((metricsPort > 0 && !metrics.listen(metricsPort)) 
+        || (!metricsFile.empty() && !metrics.writeFile(metricsFile, metricsInterval)))
+    {
+        return -1;
+    }
 
+    // The path is the one of the socket for the daemon and the requests, the name of the shared 
+    // memory ring for the ring modes, and the video file or device for the stream mode
+    switch (mode)
+    {
+        case Mode::convert:
+            return idl::convertFrames(imageDirectory, archivePath, options.decodeReduction);
+        case Mode::serve:
+            return idl::serve(imageDirectory, options);
+        case Mode::ring:
+            return idl::consumeFrames(imageDirectory, options);
+        case Mode::stream:
+            return idl::streamVideo(imageDirectory, options, dropPolicy, everyN, deadlineMs, fps);
+        case Mode::produce:
+            return idl::produceFrames(imageDirectory, produceRing, ringSlots, fps > 0.0 ? fps : 10.0);
+        case Mode::request:
+            return idl::requestAnalysis(imageDirectory, requestFile);
+        case Mode::benchServe:
+            return idl::benchmarkServer(imageDirectory, benchServeDirectory, 5);
+        case Mode::watch:
+            return idl::watchDirectory(imageDirectory, options, watchQueue);
+        case Mode::checkKernels:
+            return idl::checkKernels();
+        case Mode::benchLaser:
+            idl::benchmarkLaserLocators(imageDirectory);
+            return 0;
+        case Mode::benchPyramid:
+            idl::benchmarkPyramid(imageDirectory);
+            return 0;
+        case Mode::benchAllocations:
+            return idl::benchmarkAllocations(imageDirectory);
+        case Mode::benchMorphology:
+            return idl::benchmarkMorphology();
+        case Mode::benchDenoise:
+            idl::benchmarkDenoise(imageDirectory);
+            return 0;
+        case Mode::benchPreprocess:
+            idl::benchmarkPreprocessing(imageDirectory, benchPreprocess);
+            return 0;
+        case Mode::pipeline:
+            return idl::runPipeline(imageDirectory, options, pipelineSettings);
+        case Mode::process:
+        default:
+            return idl::processDirectory(imageDirectory, options);
+    }
+}